@@ -0,0 +1,140 @@
+#include "Asset_pack.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+#include "logs.hpp"
+
+using asset_pack::Entry;
+using asset_pack::File_header;
+
+namespace {
+    // everything the header and table point at lies inside the file
+    auto valid(const uint8_t* map, size_t size) -> bool
+    {
+        if (size < sizeof(File_header)) {
+            return false;
+        }
+        File_header header {};
+        memcpy(&header, map, sizeof(header));
+        if (memcmp(header.magic, asset_pack::file_magic, sizeof(header.magic))
+                != 0
+            || header.version != asset_pack::file_version
+            || header.size != size
+            || header.toc_offset % alignof(Entry) != 0
+            || header.toc_offset > size
+            || header.count > (size - header.toc_offset) / sizeof(Entry)) {
+            return false;
+        }
+
+        const auto* toc {reinterpret_cast<const Entry*>(map + header.toc_offset)};
+        for (uint32_t i {0}; i < header.count; ++i) {
+            const Entry& e {toc[i]};
+            if (e.offset > size || e.size > size - e.offset
+                || e.name_offset > size || e.name_size > size - e.name_offset) {
+                return false;
+            }
+        }
+        return true;
+    }
+} // namespace
+
+Asset_pack::Asset_pack(const std::string& path)
+: map{nullptr}
+, map_size{0}
+, toc{nullptr}
+, toc_size{0}
+{
+#ifdef __linux__
+    const int fd {open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fd == -1) {
+        logs::err("can not open asset pack ", path, " (", strerror(errno), ")");
+        return;
+    }
+    struct stat st {};
+    if (fstat(fd, &st) == -1 || st.st_size <= 0) {
+        logs::err("can not stat asset pack ", path);
+        close(fd);
+        return;
+    }
+
+    // shared, so the pages are the page cache's and not a private copy
+    void* map {mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0)};
+    close(fd); // the mapping keeps the file
+    if (map == MAP_FAILED) {
+        logs::err("can not map asset pack ", path, " (", strerror(errno), ")");
+        return;
+    }
+    this->map = static_cast<const uint8_t*>(map);
+    this->map_size = static_cast<size_t>(st.st_size);
+
+    if (!valid(this->map, this->map_size)) {
+        logs::err(path, " is not an asset pack (or has an unknown version)");
+        munmap(map, this->map_size);
+        this->map = nullptr;
+        this->map_size = 0;
+        return;
+    }
+
+    File_header header {};
+    memcpy(&header, this->map, sizeof(header));
+    this->toc = reinterpret_cast<const Entry*>(this->map + header.toc_offset);
+    this->toc_size = header.count;
+    logs::info(
+        "asset pack ", path, ": ", this->toc_size, " files, ",
+        this->map_size / 1024, "KiB mapped");
+#else
+    logs::info("asset packs need mmap, not loading ", path);
+#endif
+}
+
+Asset_pack::~Asset_pack()
+{
+#ifdef __linux__
+    if (this->map != nullptr) {
+        munmap(const_cast<uint8_t*>(this->map), this->map_size);
+    }
+#endif
+}
+
+auto Asset_pack::is_open() const -> bool
+{
+    return this->map != nullptr;
+}
+
+auto Asset_pack::count() const -> size_t
+{
+    return this->toc_size;
+}
+
+auto Asset_pack::find(std::string_view name, std::string_view& data) const
+    -> bool
+{
+    const Entry* end {this->toc + this->toc_size};
+    const Entry* it {std::lower_bound(
+        this->toc, end, name,
+        [this](const Entry& e, std::string_view n) {
+            return this->name(e) < n;
+        })};
+    if (it == end || this->name(*it) != name) {
+        return false;
+    }
+    data = std::string_view(
+        reinterpret_cast<const char*>(this->map + it->offset), it->size);
+    return true;
+}
+
+auto Asset_pack::name(const Entry& entry) const -> std::string_view
+{
+    return std::string_view(
+        reinterpret_cast<const char*>(this->map + entry.name_offset),
+        entry.name_size);
+}
@@ -0,0 +1,50 @@
+#ifndef SRC_ASSET_PACK_HPP_
+#define SRC_ASSET_PACK_HPP_
+
+/*******************************************************************************
+ * Read-only, memory mapped asset pack (see asset_pack_format.hpp, built with
+ * tools/pack_assets).
+ *
+ * Opening a pack is one open() and one mmap() however many files it holds.
+ * Lookups binary search the table of contents inside the mapping and hand out
+ * views of the mapped contents, nothing is read or copied up front: pages are
+ * faulted in when they are first touched (usually by the upload) and stay in
+ * the page cache, shared with every other process that maps the same pack.
+ *
+ * Views stay valid as long as the pack is open. On systems without mmap the
+ * pack never opens.
+ ******************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "asset_pack_format.hpp"
+
+class Asset_pack final {
+ public:
+    // maps the pack, check is_open() for the outcome (failures are logged)
+    explicit Asset_pack(const std::string& path);
+    ~Asset_pack();
+    Asset_pack(const Asset_pack&) = delete;
+    auto operator=(const Asset_pack&) -> Asset_pack& = delete;
+
+    auto is_open() const -> bool;
+
+    // files in the pack
+    auto count() const -> size_t;
+
+    // contents of the file stored as `name`, false if there is none
+    auto find(std::string_view name, std::string_view& data) const -> bool;
+
+ private:
+    auto name(const asset_pack::Entry& entry) const -> std::string_view;
+
+    const uint8_t* map;
+    size_t map_size;
+    const asset_pack::Entry* toc;
+    size_t toc_size;
+};
+
+#endif // SRC_ASSET_PACK_HPP_
@@ -0,0 +1,226 @@
+#include "Atlas.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#include "logs.hpp"
+
+namespace {
+    auto power_of_two_from(unsigned n) -> unsigned
+    {
+        unsigned power {1};
+        while (power < n) {
+            power *= 2;
+        }
+        return power;
+    }
+} // namespace
+
+Atlas::Atlas(unsigned page_size, unsigned gutter)
+: size{page_size}
+, gutter{gutter}
+, step{power_of_two_from(gutter)}
+, page_list{}
+, skylines{}
+, regions{}
+, names{}
+, by_name{}
+{}
+
+auto Atlas::add(
+    const std::string& name, const unsigned char* rgba, unsigned width,
+    unsigned height, Handle& handle) -> bool
+{
+    if (this->find(name, handle)) {
+        return true;
+    }
+
+    // the skylines count in steps, which keeps the slots aligned
+    const unsigned step {this->step};
+    const auto slot {[&](unsigned n) {
+        return (n + 2 * this->gutter + step - 1) / step;
+    }};
+    const unsigned steps {this->size / step};
+    if (width == 0 || height == 0 || slot(width) > steps
+        || slot(height) > steps) {
+        logs::err(
+            "atlas: ", name, " (", width, "x", height,
+            ") does not fit a page");
+        return false;
+    }
+
+    unsigned x {0};
+    unsigned y {0};
+    size_t page {0};
+    while (page < this->skylines.size()
+           && !this->skylines[page].insert(slot(width), slot(height), x, y)) {
+        ++page;
+    }
+    if (page == this->skylines.size()) {
+        this->skylines.emplace_back(steps, steps);
+        this->page_list.push_back(
+            Page{"", std::vector<unsigned char>(
+                         size_t{this->size} * this->size * 4)});
+        // an empty page fits anything that fits a page
+        this->skylines.back().insert(slot(width), slot(height), x, y);
+        DBG(2, "atlas: page ", page, " opened for ", name);
+    }
+
+    const float scale {1.0f / static_cast<float>(this->size)};
+    const Region region {
+        .page = static_cast<unsigned>(page),
+        .x = x * step + this->gutter,
+        .y = y * step + this->gutter,
+        .width = width,
+        .height = height,
+        .u0 = static_cast<float>(x * step + this->gutter) * scale,
+        .v0 = static_cast<float>(y * step + this->gutter) * scale,
+        .u1 = static_cast<float>(x * step + this->gutter + width) * scale,
+        .v1 = static_cast<float>(y * step + this->gutter + height) * scale,
+    };
+    this->place(region, rgba);
+
+    handle = Handle{static_cast<unsigned>(this->regions.size())};
+    this->regions.push_back(region);
+    this->names.push_back(name);
+    this->by_name.emplace(name, handle.id);
+    return true;
+}
+
+auto Atlas::find(const std::string& name, Handle& handle) const -> bool
+{
+    const auto it {this->by_name.find(name)};
+    if (it == this->by_name.end()) {
+        return false;
+    }
+    handle = Handle{it->second};
+    return true;
+}
+
+auto Atlas::region(Handle handle) const -> const Region&
+{
+    return this->regions[handle.id];
+}
+
+auto Atlas::page_size() const -> unsigned
+{
+    return this->size;
+}
+
+auto Atlas::pages() const -> const std::vector<Page>&
+{
+    return this->page_list;
+}
+
+auto Atlas::mipmap_options() const -> mipmaps::Options
+{
+    // level n averages aligned blocks of 2^n x 2^n pixels, which stay inside
+    // the slot while 2^n is no more than the gutter
+    unsigned levels {1};
+    while ((2u << (levels - 1)) <= this->gutter) {
+        ++levels;
+    }
+    return mipmaps::Options{mipmaps::Filter::box, true, 0.0f, levels};
+}
+
+auto Atlas::index(const std::vector<std::string>& page_files) const
+    -> std::string
+{
+    std::ostringstream out;
+    out << "atlas " << this->size << ' ' << this->gutter << '\n';
+    for (const std::string& file : page_files) {
+        out << "page " << file << '\n';
+    }
+    for (size_t i {0}; i < this->regions.size(); ++i) {
+        const Region& r {this->regions[i]};
+        out << "image " << this->names[i] << ' ' << r.page << ' ' << r.x << ' '
+            << r.y << ' ' << r.width << ' ' << r.height << '\n';
+    }
+    return out.str();
+}
+
+auto Atlas::load_index(const std::string& name, std::string_view text) -> bool
+{
+    std::istringstream in {std::string{text}};
+    std::string line;
+    std::string word;
+    unsigned size {0};
+    unsigned gutter {0};
+    if (!std::getline(in, line)
+        || !(std::istringstream{line} >> word >> size >> gutter)
+        || word != "atlas" || size == 0) {
+        logs::err(name, " is not an atlas index");
+        return false;
+    }
+
+    Atlas atlas {size, gutter};
+    const float scale {1.0f / static_cast<float>(size)};
+    for (unsigned number {2}; std::getline(in, line); ++number) {
+        std::istringstream fields {line};
+        if (!(fields >> word)) {
+            continue;
+        }
+        if (word == "page") {
+            std::string file;
+            if (!(fields >> file)) {
+                logs::err(name, ":", number, ": page without a file");
+                return false;
+            }
+            atlas.page_list.push_back(Page{file, {}});
+            continue;
+        }
+
+        std::string image;
+        Region r {};
+        if (word != "image"
+            || !(fields >> image >> r.page >> r.x >> r.y >> r.width
+                 >> r.height)
+            || r.page >= atlas.page_list.size() || r.x > size
+            || r.width > size - r.x || r.y > size || r.height > size - r.y) {
+            logs::err(name, ":", number, ": not a page or image line");
+            return false;
+        }
+        r.u0 = static_cast<float>(r.x) * scale;
+        r.v0 = static_cast<float>(r.y) * scale;
+        r.u1 = static_cast<float>(r.x + r.width) * scale;
+        r.v1 = static_cast<float>(r.y + r.height) * scale;
+        atlas.by_name.emplace(
+            image, static_cast<unsigned>(atlas.regions.size()));
+        atlas.regions.push_back(r);
+        atlas.names.push_back(image);
+    }
+
+    *this = std::move(atlas);
+    DBG(2, name, ": atlas of ", this->regions.size(), " images on ",
+        this->page_list.size(), " pages");
+    return true;
+}
+
+auto Atlas::place(const Region& region, const unsigned char* rgba) -> void
+{
+    // every row, the gutter ones repeating the first or last, with its ends
+    // repeated into the gutter
+    unsigned char* page {this->page_list[region.page].rgba.data()};
+    const int g {static_cast<int>(this->gutter)};
+    const auto height {static_cast<int>(region.height)};
+    const size_t row_bytes {size_t{region.width} * 4};
+    for (int py {-g}; py < height + g; ++py) {
+        const unsigned char* from {
+            rgba + static_cast<size_t>(std::clamp(py, 0, height - 1))
+                * row_bytes};
+        unsigned char* to {
+            page
+            + ((static_cast<size_t>(static_cast<int>(region.y) + py))
+                   * this->size
+               + region.x - this->gutter) * 4};
+        for (unsigned i {0}; i < this->gutter; ++i, to += 4) {
+            std::memcpy(to, from, 4);
+        }
+        std::memcpy(to, from, row_bytes);
+        to += row_bytes;
+        for (unsigned i {0}; i < this->gutter; ++i, to += 4) {
+            std::memcpy(to, from + row_bytes - 4, 4);
+        }
+    }
+}
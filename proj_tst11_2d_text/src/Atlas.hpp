@@ -0,0 +1,104 @@
+#ifndef SRC_ATLAS_HPP_
+#define SRC_ATLAS_HPP_
+
+/*******************************************************************************
+ * Many small images packed into a few shared pages, so that sprites, icons
+ * and glyphs from all of them draw with one texture bind (and so one batch,
+ * see printText2D() and drawSprite2D()).
+ *
+ * add() copies an RGBA image into the first page with room for it (placed by
+ * a Skyline), opening a new page when none has. region() gives the image's
+ * place by handle: its page and its UV rectangle. The pages are plain RGBA8
+ * pixels without any OpenGL, they become textures through
+ * Texture_manager::add() (at runtime) or are written out by pack_atlas
+ * (offline), whose index load_index() reads back: the regions then refer to
+ * the page files, loaded like any texture (add() after that packs into new
+ * pages).
+ *
+ * Every image sits in a slot `gutter` pixels wider on each side, filled with
+ * its edge pixels so that linear filtering at the border samples the image
+ * and not its neighbour. The slots start at multiples of the gutter (rounded
+ * up to a power of two), so the first 1 + log2(gutter) mipmap levels of a
+ * page, box filtered, never mix two images either; mipmap_options() makes
+ * just those (a 4 pixel gutter gives levels down to a quarter size). Regions
+ * are in pixels from the top left of the page, rows top to bottom like a .png
+ * or .dds.
+ ******************************************************************************/
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Skyline.hpp"
+#include "mipmaps.hpp"
+
+class Atlas final {
+ public:
+    struct Handle {
+        unsigned id;
+    };
+
+    struct Region {
+        unsigned page;
+        unsigned x; // the image, without the gutter
+        unsigned y;
+        unsigned width;
+        unsigned height;
+        float u0; // top left
+        float v0;
+        float u1; // bottom right
+        float v1;
+    };
+
+    struct Page {
+        std::string file; // of a loaded index, empty for a packed page
+        std::vector<unsigned char> rgba; // of a packed page
+    };
+
+    static constexpr unsigned default_page_size {1024};
+    static constexpr unsigned default_gutter {4};
+
+    explicit Atlas(
+        unsigned page_size = default_page_size,
+        unsigned gutter = default_gutter);
+
+    // pack a copy of `width` x `height` RGBA pixels (rows top to bottom) as
+    // `name`, the same handle if it is there already; false (and an error
+    // logged) if it is larger than a page
+    auto add(
+        const std::string& name, const unsigned char* rgba, unsigned width,
+        unsigned height, Handle& handle) -> bool;
+
+    auto find(const std::string& name, Handle& handle) const -> bool;
+    auto region(Handle handle) const -> const Region&;
+
+    auto page_size() const -> unsigned;
+    auto pages() const -> const std::vector<Page>&;
+
+    // box filtered and only the levels the gutters keep apart
+    auto mipmap_options() const -> mipmaps::Options;
+
+    // what pack_atlas writes next to the pages: their files and every region
+    auto index(const std::vector<std::string>& page_files) const
+        -> std::string;
+
+    // replace the atlas with the one an index describes, false (and an
+    // error about `name` logged) if it is not one
+    auto load_index(const std::string& name, std::string_view text) -> bool;
+
+ private:
+    auto place(const Region& region, const unsigned char* rgba) -> void;
+
+    unsigned size;
+    unsigned gutter;
+    unsigned step; // the slot alignment
+    std::vector<Page> page_list;
+    std::vector<Skyline> skylines;
+    std::vector<Region> regions;
+    std::vector<std::string> names; // of the regions
+    std::unordered_map<std::string, unsigned> by_name;
+};
+
+#endif // SRC_ATLAS_HPP_
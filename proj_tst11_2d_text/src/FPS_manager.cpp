@@ -1,5 +1,6 @@
 #include "FPS_manager.hpp"
 
+#include <algorithm>
 #include <chrono>
 using std::chrono::nanoseconds;
 using std::chrono::seconds;
@@ -17,6 +18,9 @@ FPS_manager::FPS_manager()
 , real_dur{1}
 , prev_end{Clock::now()}
 , end{Clock::now()}
+, history{}
+, history_len{0}
+, history_pos{0}
 {
     this->set_fps(default_fps);
 }
@@ -34,6 +38,23 @@ auto FPS_manager::get_delta_seconds() -> double
         this->real_dur.count());
 }
 
+auto FPS_manager::get_median_seconds() -> double
+{
+    if (this->history_len == 0) {
+        return this->get_delta_seconds();
+    }
+
+    auto sorted {this->history};
+    auto mid {sorted.begin() + this->history_len / 2};
+    std::nth_element(sorted.begin(), mid, sorted.begin() + this->history_len);
+
+    return std::chrono::duration<double>(*mid).count();
+}
+
+auto FPS_manager::has_full_history() -> bool
+{
+    return this->history_len == history_size;
+}
 
 auto FPS_manager::set_fps(unsigned fps) -> void
 {
@@ -54,6 +75,10 @@ auto FPS_manager::end_frame() -> void
         this->real_dur = Clock::now() - this->prev_end;
     }
 
+    this->history[this->history_pos] = this->real_dur;
+    this->history_pos = (this->history_pos + 1) % history_size;
+    this->history_len = std::min(this->history_len + 1, history_size);
+
     this->prev_end = Clock::now();
 }
 
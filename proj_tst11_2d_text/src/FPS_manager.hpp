@@ -1,6 +1,7 @@
 #ifndef SRC_FPS_MANAGER_HPP_
 #define SRC_FPS_MANAGER_HPP_
 
+#include <array>
 #include <chrono>
 
 class FPS_manager final {
@@ -10,6 +11,10 @@ class FPS_manager final {
     // get actual fps
     auto get_fps() -> unsigned;
     auto get_delta_seconds() -> double;
+    // median duration of the last `history_size` frames
+    auto get_median_seconds() -> double;
+    // true once enough frames were seen for the median to be meaningful
+    auto has_full_history() -> bool;
     // what fps to aim for if frame cap is on
     auto set_fps(unsigned fps) -> void;
 
@@ -18,12 +23,18 @@ class FPS_manager final {
     auto toggle_frame_cap() -> void;
 
  private:
+    static constexpr unsigned history_size {64};
+
     bool cap_frames;
     unsigned count; // frames since last update
     std::chrono::nanoseconds tgt_dur; // target duration of one frame
     std::chrono::nanoseconds real_dur; // real duration of last frame
     std::chrono::high_resolution_clock::time_point prev_end;
     std::chrono::high_resolution_clock::time_point end;
+    // ring of recent frame durations
+    std::array<std::chrono::nanoseconds, history_size> history;
+    unsigned history_len;
+    unsigned history_pos;
 };
 
 #endif // SRC_FPS_MANAGER_HPP_
@@ -0,0 +1,150 @@
+#include "File_watcher.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#   include <poll.h>
+#   include <sys/inotify.h>
+#   include <unistd.h>
+#endif
+
+#include "logs.hpp"
+
+namespace {
+    auto dir_of(const std::string& path) -> std::string
+    {
+        const size_t slash {path.find_last_of('/')};
+        return slash == std::string::npos ? "." : path.substr(0, slash);
+    }
+
+    // "./a" and "a" are the same file as far as we are concerned
+    auto strip_dot(const std::string& path) -> std::string
+    {
+        return path.rfind("./", 0) == 0 ? path.substr(2) : path;
+    }
+} // namespace
+
+File_watcher::File_watcher()
+: inotify_fd{-1}
+, wake_fds{-1, -1}
+{
+#ifdef __linux__
+    this->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (this->inotify_fd == -1) {
+        logs::err("inotify not available (", strerror(errno), ")");
+        return;
+    }
+    if (pipe(this->wake_fds) == -1) {
+        logs::err("could not create a pipe (", strerror(errno), ")");
+        close(this->inotify_fd);
+        this->inotify_fd = -1;
+        return;
+    }
+
+    this->thread = std::thread(&File_watcher::run, this);
+#else
+    logs::info("file watching is Linux only");
+#endif
+}
+
+File_watcher::~File_watcher()
+{
+#ifdef __linux__
+    if (this->thread.joinable()) {
+        const char stop {0};
+        static_cast<void>(write(this->wake_fds[1], &stop, 1));
+        this->thread.join();
+    }
+    for (int fd : {this->inotify_fd, this->wake_fds[0], this->wake_fds[1]}) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+auto File_watcher::add(const std::string& path) -> bool
+{
+#ifdef __linux__
+    if (this->inotify_fd == -1) {
+        return false;
+    }
+
+    const std::string file {strip_dot(path)};
+    const std::string dir {dir_of(file)};
+    // watching a directory twice gives back the same descriptor
+    const int wd {inotify_add_watch(
+        this->inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO)};
+    if (wd == -1) {
+        logs::err("can not watch ", dir, " (", strerror(errno), ")");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->dirs[wd] = dir;
+    this->files[file] = path;
+    DBG(2, "watching ", file);
+    return true;
+#else
+    static_cast<void>(path);
+    return false;
+#endif
+}
+
+auto File_watcher::changed() -> std::vector<std::string>
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::vector<std::string> paths(this->pending.begin(), this->pending.end());
+    this->pending.clear();
+    return paths;
+}
+
+auto File_watcher::run() -> void
+{
+#ifdef __linux__
+    // big enough for a bunch of events with names up to NAME_MAX
+    alignas(inotify_event) char buf[16 * 1024];
+
+    while (true) {
+        pollfd fds[2] {
+            {this->inotify_fd, POLLIN, 0},
+            {this->wake_fds[0], POLLIN, 0},
+        };
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            logs::err("file watcher poll failed (", strerror(errno), ")");
+            return;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+
+        const ssize_t len {read(this->inotify_fd, buf, sizeof(buf))};
+        if (len <= 0) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (ssize_t pos {0}; pos < len;) {
+            const auto* event {reinterpret_cast<const inotify_event*>(buf + pos)};
+            pos += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+            const auto dir {this->dirs.find(event->wd)};
+            if (event->len == 0 || dir == this->dirs.end()) {
+                continue;
+            }
+            std::string file {dir->second + "/" + event->name};
+            if (dir->second == ".") {
+                file = event->name;
+            }
+            const auto watched {this->files.find(file)};
+            if (watched != this->files.end()) {
+                this->pending.insert(watched->second);
+            }
+        }
+    }
+#endif
+}
@@ -0,0 +1,51 @@
+#ifndef SRC_FILE_WATCHER_HPP_
+#define SRC_FILE_WATCHER_HPP_
+
+/*******************************************************************************
+ * Notices when files are rewritten (Linux inotify, on a background thread).
+ *
+ * The directories of the watched files are watched rather than the files
+ * themselves, as most editors save by writing a new file and renaming it over
+ * the old one, which would silently end a watch on the file. Changes are
+ * collected until the owner asks for them with changed(), so the main loop
+ * never waits on the watcher.
+ *
+ * On other systems, or if inotify can not be set up, nothing is ever reported.
+ ******************************************************************************/
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+class File_watcher final {
+ public:
+    File_watcher();
+    ~File_watcher();
+    File_watcher(const File_watcher&) = delete;
+    auto operator=(const File_watcher&) -> File_watcher& = delete;
+
+    // start watching `path`, false if that is not possible
+    auto add(const std::string& path) -> bool;
+
+    // watched files that changed since the last call, each one once and
+    // spelled as it was passed to add()
+    auto changed() -> std::vector<std::string>;
+
+ private:
+    auto run() -> void;
+
+    int inotify_fd;
+    int wake_fds[2]; // pipe, written to stop the thread
+
+    std::mutex mutex; // guards everything below
+    std::map<int, std::string> dirs; // watch descriptor -> directory
+    std::map<std::string, std::string> files; // normalised -> as added
+    std::set<std::string> pending;
+
+    std::thread thread;
+};
+
+#endif // SRC_FILE_WATCHER_HPP_
@@ -0,0 +1,249 @@
+#include "Flight_recorder.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "logs.hpp"
+
+using std::chrono::microseconds;
+using Clock = std::chrono::steady_clock;
+
+std::atomic<Flight_recorder*> Flight_recorder::active {nullptr};
+std::atomic<unsigned> Flight_recorder::in_log {0};
+
+namespace {
+    auto write_escaped(std::ostream& out, const char* text) -> void
+    {
+        for (const char* c {text}; *c != '\0'; ++c) {
+            switch (*c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(*c) >= 0x20) {
+                    out << *c;
+                }
+                break;
+            }
+        }
+    }
+} // namespace
+
+Flight_recorder::Flight_recorder(std::string prefix, double threshold)
+: prefix{std::move(prefix)}
+, threshold{threshold}
+, start{Clock::now()}
+, frames{}
+, frame_count{0}
+, frame_pos{0}
+, frame_number{0}
+, cooldown{0}
+, hitch_count{0}
+, logs{}
+, log_count{0}
+, log_pos{0}
+, dump{}
+, dump_busy{false}
+{
+    this->frames[0].phase_begin_us.fill(-1);
+
+    active = this;
+    logs::set_sink(on_log);
+    logs::info(
+        "flight recorder on, frames over ", threshold,
+        "x the median frame time are dumped to ", this->prefix,
+        "<frame>.json");
+}
+
+Flight_recorder::~Flight_recorder()
+{
+    logs::set_sink(nullptr);
+    active = nullptr;
+    // a worker may be in on_log() with this recorder still
+    while (in_log != 0) {
+        std::this_thread::yield();
+    }
+
+    if (this->writer.joinable()) {
+        this->writer.join();
+    }
+}
+
+auto Flight_recorder::enter(Frame_phase phase) -> void
+{
+    Frame& frame {this->frames[this->frame_pos]};
+    frame.phase_begin_us[static_cast<size_t>(phase)] = this->now_us();
+}
+
+auto Flight_recorder::end_frame(
+    double seconds, double median_seconds, bool valid_median) -> void
+{
+    Frame& frame {this->frames[this->frame_pos]};
+    frame.number = this->frame_number;
+    frame.end_us = this->now_us();
+#ifdef GL_STATS
+    frame.gl = gl_stats::last_frame();
+#endif
+    this->frame_count = std::min(this->frame_count + 1, frame_window);
+
+    if (this->cooldown > 0) {
+        --this->cooldown;
+    } else if (valid_median && seconds > this->threshold * median_seconds) {
+        logs::info(
+            "hitch: frame ", this->frame_number, " took ", seconds * 1000.0,
+            "ms (median ", median_seconds * 1000.0, "ms)");
+        this->trigger(median_seconds);
+    }
+
+    // start recording the next frame over the oldest one
+    this->frame_pos = (this->frame_pos + 1) % frame_window;
+    ++this->frame_number;
+
+    Frame& next {this->frames[this->frame_pos]};
+    next.begin_us = frame.end_us;
+    next.phase_begin_us.fill(-1);
+    next.gl = gl_stats::Counters{};
+}
+
+auto Flight_recorder::hitches() const -> unsigned
+{
+    return this->hitch_count;
+}
+
+auto Flight_recorder::on_log(const std::string& line) -> void
+{
+    ++in_log;
+    Flight_recorder* rec {active};
+    if (rec != nullptr) {
+        std::lock_guard<std::mutex> lock(rec->log_mutex);
+        Log_line& log {rec->logs[rec->log_pos]};
+        log.time_us = rec->now_us();
+        const size_t len {std::min(line.size(), log_line_size - 1)};
+        memcpy(log.text, line.data(), len);
+        log.text[len] = '\0';
+
+        rec->log_pos = (rec->log_pos + 1) % log_window;
+        rec->log_count = std::min(rec->log_count + 1, log_window);
+    }
+    --in_log;
+}
+
+auto Flight_recorder::now_us() const -> int64_t
+{
+    return std::chrono::duration_cast<microseconds>(
+        Clock::now() - this->start).count();
+}
+
+auto Flight_recorder::trigger(double median_seconds) -> void
+{
+    if (this->dump_busy) {
+        logs::info("previous hitch dump still being written, skipping");
+        return;
+    }
+    if (this->writer.joinable()) {
+        this->writer.join();
+    }
+
+    this->dump.hitch_frame = this->frame_number;
+    this->dump.median_seconds = median_seconds;
+
+    // oldest first, the current frame is the newest one
+    this->dump.frame_count = this->frame_count;
+    const unsigned first_frame {
+        (this->frame_pos + 1 + frame_window - this->frame_count) % frame_window};
+    for (unsigned i {0}; i < this->frame_count; ++i) {
+        this->dump.frames[i] = this->frames[(first_frame + i) % frame_window];
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->log_mutex);
+        this->dump.log_count = this->log_count;
+        const unsigned first_log {
+            (this->log_pos + log_window - this->log_count) % log_window};
+        for (unsigned i {0}; i < this->log_count; ++i) {
+            this->dump.logs[i] = this->logs[(first_log + i) % log_window];
+        }
+    }
+
+    this->cooldown = frame_window;
+    ++this->hitch_count;
+    this->dump_busy = true;
+    this->writer = std::thread(&Flight_recorder::write_dump, this);
+}
+
+auto Flight_recorder::write_dump() -> void
+{
+    const std::string path {
+        this->prefix + std::to_string(this->dump.hitch_frame) + ".json"};
+    std::ofstream out(path, std::ios::out);
+    if (!out.is_open()) {
+        logs::err("can not open ", path, " for writing");
+        this->dump_busy = false;
+        return;
+    }
+
+    // Chrome trace event format, tid 1: frames, 2: phases, 3: log
+    out << "{\"traceEvents\": [\n"
+        << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1,"
+           " \"args\": {\"name\": \"frames\"}},\n"
+        << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2,"
+           " \"args\": {\"name\": \"phases\"}},\n"
+        << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 3,"
+           " \"args\": {\"name\": \"log\"}}";
+
+    for (unsigned i {0}; i < this->dump.frame_count; ++i) {
+        const Frame& frame {this->dump.frames[i]};
+        out << ",\n{\"name\": \"frame " << frame.number << "\", \"ph\": \"X\","
+            << " \"pid\": 1, \"tid\": 1, \"ts\": " << frame.begin_us
+            << ", \"dur\": " << frame.end_us - frame.begin_us << "}";
+
+        // a phase lasts until the next phase seen in this frame begins
+        for (size_t p {0}; p < frame_phase_count; ++p) {
+            const int64_t begin {frame.phase_begin_us[p]};
+            if (begin < 0) {
+                continue;
+            }
+            int64_t end {frame.end_us};
+            for (size_t q {p + 1}; q < frame_phase_count; ++q) {
+                if (frame.phase_begin_us[q] >= 0) {
+                    end = frame.phase_begin_us[q];
+                    break;
+                }
+            }
+            out << ",\n{\"name\": \"" << phase_name(static_cast<Frame_phase>(p))
+                << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": 2, \"ts\": "
+                << begin << ", \"dur\": " << end - begin << "}";
+        }
+
+#ifdef GL_STATS
+        out << ",\n{\"name\": \"gl\", \"ph\": \"C\", \"pid\": 1, \"ts\": "
+            << frame.begin_us << ", \"args\": {";
+        for (size_t c {0}; c < frame.gl.calls.size(); ++c) {
+            out << "\"" << gl_stats::name(static_cast<gl_stats::Call>(c))
+                << "\": " << frame.gl.calls[c] << ", ";
+        }
+        out << "\"redundant\": " << frame.gl.redundant
+            << ", \"upload_kib\": " << frame.gl.upload_bytes / 1024.0 << "}}";
+#endif
+    }
+
+    for (unsigned i {0}; i < this->dump.log_count; ++i) {
+        const Log_line& log {this->dump.logs[i]};
+        out << ",\n{\"name\": \"log\", \"ph\": \"i\", \"s\": \"t\", \"pid\": 1,"
+            << " \"tid\": 3, \"ts\": " << log.time_us << ", \"args\": {\"msg\": \"";
+        write_escaped(out, log.text);
+        out << "\"}}";
+    }
+
+    out << "\n],\n\"otherData\": {\"hitch_frame\": " << this->dump.hitch_frame
+        << ", \"median_ms\": " << this->dump.median_seconds * 1000.0 << "}}\n";
+    out.close();
+
+    logs::info("hitch trace written to ", path);
+    this->dump_busy = false;
+}
@@ -0,0 +1,105 @@
+#ifndef SRC_FLIGHT_RECORDER_HPP_
+#define SRC_FLIGHT_RECORDER_HPP_
+
+/*******************************************************************************
+ * Hitch flight recorder.
+ *
+ * Keeps the last `frame_window` frames (phase timings and GL counters) and the
+ * last `log_window` log lines in fixed size rings. When a frame takes longer
+ * than `threshold` times the rolling median frame time, the whole window is
+ * written out as a Chrome trace (load it in chrome://tracing or Perfetto).
+ *
+ * Memory use is constant and nothing touches the disk until a hitch triggers,
+ * the dump itself is written by a background thread from a preallocated copy.
+ * Only one recorder can be active at a time (it hooks into `logs`).
+ ******************************************************************************/
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "frame_phase.hpp"
+#include "gl_stats.hpp"
+
+class Flight_recorder final {
+ public:
+    static constexpr unsigned frame_window {120};
+    static constexpr unsigned log_window {256};
+    static constexpr size_t log_line_size {192};
+
+    // dumps go to `<prefix><frame number>.json`
+    explicit Flight_recorder(std::string prefix, double threshold = 2.0);
+    ~Flight_recorder();
+    Flight_recorder(const Flight_recorder&) = delete;
+    auto operator=(const Flight_recorder&) -> Flight_recorder& = delete;
+
+    // mark the start of a phase of the current frame
+    auto enter(Frame_phase phase) -> void;
+
+    // `seconds` is the duration of the frame that just ended, `median_seconds`
+    // the rolling median (pass `valid_median` false while it is warming up)
+    auto end_frame(double seconds, double median_seconds, bool valid_median)
+        -> void;
+
+    auto hitches() const -> unsigned;
+
+ private:
+    struct Frame {
+        uint64_t number;
+        int64_t begin_us;
+        int64_t end_us;
+        std::array<int64_t, frame_phase_count> phase_begin_us; // -1: not seen
+        gl_stats::Counters gl;
+    };
+
+    struct Log_line {
+        int64_t time_us;
+        char text[log_line_size];
+    };
+
+    // a frozen copy of the window, owned by the writer thread while in flight
+    struct Dump {
+        uint64_t hitch_frame;
+        double median_seconds;
+        unsigned frame_count;
+        unsigned log_count;
+        std::array<Frame, frame_window> frames;
+        std::array<Log_line, log_window> logs;
+    };
+
+    static auto on_log(const std::string& line) -> void;
+    auto now_us() const -> int64_t;
+    auto trigger(double median_seconds) -> void;
+    auto write_dump() -> void;
+
+    // the log hook runs on any thread: `active` is only read by on_log()
+    // calls counted in `in_log`, which the destructor waits out
+    static std::atomic<Flight_recorder*> active;
+    static std::atomic<unsigned> in_log;
+
+    const std::string prefix;
+    double threshold;
+    std::chrono::steady_clock::time_point start;
+
+    std::array<Frame, frame_window> frames;
+    unsigned frame_count; // frames recorded so far (saturates at window)
+    unsigned frame_pos; // slot of the current frame
+    uint64_t frame_number;
+    unsigned cooldown; // frames left before another dump may trigger
+    unsigned hitch_count;
+
+    std::mutex log_mutex;
+    std::array<Log_line, log_window> logs;
+    unsigned log_count;
+    unsigned log_pos;
+
+    Dump dump;
+    std::atomic<bool> dump_busy;
+    std::thread writer;
+};
+
+#endif // SRC_FLIGHT_RECORDER_HPP_
@@ -0,0 +1,165 @@
+#include "Init_graph.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <utility>
+
+#include "bench.hpp"
+#include "logs.hpp"
+
+namespace {
+    auto ms(std::chrono::steady_clock::duration d) -> double
+    {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+} // namespace
+
+auto Init_graph::add(
+    std::string name,
+    Thread thread,
+    std::vector<Step> needs,
+    std::function<bool()> job) -> Step
+{
+    this->nodes.push_back(Node{
+        .name = std::move(name),
+        .thread = thread,
+        .needs = std::move(needs),
+        .job = std::move(job),
+        .state = State::waiting,
+        .start = {},
+        .end = {},
+    });
+    return static_cast<Step>(this->nodes.size() - 1);
+}
+
+auto Init_graph::run(Thread_pool& pool) -> bool
+{
+    // what a worker hands back, the nodes themselves are only touched here
+    struct Result {
+        Step step;
+        bool ok;
+        std::exception_ptr error; // what the job threw, if it did
+        Clock::time_point start;
+        Clock::time_point end;
+    };
+    std::mutex mutex; // guards results
+    std::condition_variable finished_one;
+    std::vector<Result> results;
+
+    std::deque<Step> context_ready;
+    size_t remaining {this->nodes.size()};
+    bool ok {true};
+    std::exception_ptr error;
+
+    // a throwing job fails its step like returning false, the exception is
+    // rethrown once no worker is left using the locals here
+    auto run_job = [this](Step i) {
+        Result result {i, false, nullptr, Clock::now(), {}};
+        try {
+            result.ok = this->nodes[i].job();
+        } catch (...) {
+            result.error = std::current_exception();
+        }
+        result.end = Clock::now();
+        return result;
+    };
+
+    auto finish = [&](const Result& result) {
+        Node& node {this->nodes[result.step]};
+        node.state = result.ok ? State::done : State::failed;
+        node.start = result.start;
+        node.end = result.end;
+        if (!result.ok) {
+            logs::err("startup step failed: ", node.name);
+            ok = false;
+        }
+        if (result.error && !error) {
+            error = result.error;
+        }
+        --remaining;
+    };
+
+    this->began = Clock::now();
+    while (remaining > 0) {
+        // steps only need earlier ones, so one pass settles all it can
+        for (Step i {0}; i < this->nodes.size(); ++i) {
+            Node& node {this->nodes[i]};
+            if (node.state != State::waiting) {
+                continue;
+            }
+            bool ready {true};
+            bool blocked {false};
+            for (Step need : node.needs) {
+                const State s {this->nodes[need].state};
+                ready = ready && s == State::done;
+                blocked = blocked || s == State::failed || s == State::skipped;
+            }
+            if (blocked) {
+                DBG(1, "startup step skipped: ", node.name);
+                node.state = State::skipped;
+                --remaining;
+                continue;
+            }
+            if (!ready) {
+                continue;
+            }
+
+            node.state = State::queued;
+            if (node.thread == Thread::context) {
+                context_ready.push_back(i);
+                continue;
+            }
+            pool.submit([&, i] {
+                const Result result {run_job(i)};
+                // notified under the lock, run() may return right after
+                std::lock_guard<std::mutex> lock(mutex);
+                results.push_back(result);
+                finished_one.notify_one();
+            });
+        }
+
+        if (!context_ready.empty()) {
+            const Step i {context_ready.front()};
+            context_ready.pop_front();
+            finish(run_job(i));
+            continue;
+        }
+        if (remaining == 0) {
+            break;
+        }
+
+        // nothing to do here until a worker is done
+        std::vector<Result> done;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished_one.wait(lock, [&] { return !results.empty(); });
+            done.swap(results);
+        }
+        for (const Result& result : done) {
+            finish(result);
+        }
+    }
+    this->finished = Clock::now();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return ok;
+}
+
+auto Init_graph::report() const -> void
+{
+    for (const Node& node : this->nodes) {
+        if (node.state != State::done && node.state != State::failed) {
+            continue;
+        }
+        DBG(1, "startup step ", node.name, ": ", ms(node.start - this->began),
+            " - ", ms(node.end - this->began), "ms on the ",
+            node.thread == Thread::context ? "context thread" : "workers");
+        bench::set("startup", node.name + "_ms", ms(node.end - node.start));
+    }
+    logs::info(
+        "startup steps done in ", ms(this->finished - this->began), "ms");
+    bench::set("startup", "steps_ms", ms(this->finished - this->began));
+}
@@ -0,0 +1,75 @@
+#ifndef SRC_INIT_GRAPH_HPP_
+#define SRC_INIT_GRAPH_HPP_
+
+/*******************************************************************************
+ * Startup work as a dependency graph.
+ *
+ * Each step says which steps it needs and where it has to run: CPU-only work
+ * (file reads, parsing, preprocessing, mesh generation) goes to the worker
+ * threads as soon as its dependencies are done, anything touching GL runs on
+ * the thread that called run() (the one the context is current on, or becomes
+ * current on in one of the steps). So the disk and the CPU are busy while the
+ * window and the context are still being created.
+ *
+ * A step returns false when it failed, the steps depending on it are then
+ * skipped and run() returns false. A step that throws fails the same way, and
+ * run() rethrows the first exception once every other step is settled.
+ * report() logs when each step ran and adds the durations to the benchmark
+ * summary ("startup" section).
+ ******************************************************************************/
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Thread_pool.hpp"
+
+class Init_graph final {
+ public:
+    using Step = unsigned;
+
+    enum class Thread {
+        worker,
+        context
+    };
+
+    // `needs` must have been added before
+    auto add(
+        std::string name,
+        Thread thread,
+        std::vector<Step> needs,
+        std::function<bool()> job) -> Step;
+
+    // run every step, blocks until all are done (or skipped)
+    auto run(Thread_pool& pool) -> bool;
+
+    auto report() const -> void;
+
+ private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State {
+        waiting,
+        queued,
+        done,
+        failed,
+        skipped
+    };
+
+    struct Node {
+        std::string name;
+        Thread thread;
+        std::vector<Step> needs;
+        std::function<bool()> job;
+        State state;
+        Clock::time_point start;
+        Clock::time_point end;
+    };
+
+    std::vector<Node> nodes;
+    Clock::time_point began;
+    Clock::time_point finished;
+};
+
+#endif // SRC_INIT_GRAPH_HPP_
@@ -0,0 +1,252 @@
+#include "Input_latency.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "logs.hpp"
+
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+
+Input_latency* Input_latency::active {nullptr};
+
+namespace {
+    constexpr const char* stage_names[Input_latency::stage_count] {
+        "submit", "swap", "gpu"};
+
+    // partially sorts [begin, end)
+    auto percentile(float* begin, float* end, double p) -> double
+    {
+        if (begin == end) {
+            return 0.0;
+        }
+        const auto n {static_cast<ptrdiff_t>(p * (end - begin - 1))};
+        std::nth_element(begin, begin + n, end);
+        return begin[n];
+    }
+
+} // namespace
+
+Input_latency::Input_latency(GLFWwindow* window)
+: window{window}
+, pending{false}
+, pending_time{}
+, has_input{false}
+, cur{}
+, frames{}
+, queries{}
+, frame_count{0}
+, frame_pos{0}
+, start{Clock::now()}
+, gpu_offset_ns{0}
+, calibrated{}
+, input_frames{0}
+, samples{}
+, recent{}
+, scratch{}
+{
+    glGenQueries(in_flight, this->queries.data());
+    this->calibrate();
+
+    active = this;
+    glfwSetKeyCallback(window, on_key);
+    glfwSetMouseButtonCallback(window, on_button);
+    glfwSetCursorPosCallback(window, on_cursor);
+    logs::info("input latency measurement on");
+}
+
+Input_latency::~Input_latency()
+{
+    glfwSetKeyCallback(this->window, nullptr);
+    glfwSetMouseButtonCallback(this->window, nullptr);
+    glfwSetCursorPosCallback(this->window, nullptr);
+    active = nullptr;
+
+    for (unsigned i {0}; i < this->frame_count; ++i) {
+        glDeleteSync(this->frames[(this->frame_pos + i) % in_flight].fence);
+    }
+    glDeleteQueries(in_flight, this->queries.data());
+}
+
+auto Input_latency::begin_frame() -> void
+{
+    this->poll(false);
+
+    this->has_input = this->pending;
+    if (this->pending) {
+        this->cur.input = this->pending_time;
+        this->pending = false;
+    }
+}
+
+auto Input_latency::submitted() -> void
+{
+    if (this->has_input) {
+        this->cur.submit = Clock::now();
+    }
+}
+
+auto Input_latency::swapped() -> void
+{
+    if (Clock::now() - this->calibrated > std::chrono::seconds(1)) {
+        this->calibrate();
+    }
+
+    if (!this->has_input) {
+        this->poll(false);
+        return;
+    }
+
+    this->cur.swap = Clock::now();
+    this->add(submit, this->cur.input, this->cur.submit);
+    this->add(swap, this->cur.input, this->cur.swap);
+
+    // the GPU is never this many frames behind, if it is anyway just wait
+    if (this->frame_count == in_flight) {
+        this->poll(true);
+    }
+
+    const unsigned slot {(this->frame_pos + this->frame_count) % in_flight};
+    this->cur.query = this->queries[slot];
+    glQueryCounter(this->cur.query, GL_TIMESTAMP);
+    this->cur.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    this->frames[slot] = this->cur;
+    ++this->frame_count;
+
+    this->has_input = false;
+    this->poll(false);
+}
+
+auto Input_latency::recent_ms(Stage stage, double p) const -> double
+{
+    // the HUD asks every frame, so no allocation here
+    const Ring<recent_size>& ring {this->recent[stage]};
+    std::copy_n(ring.values.begin(), ring.len, this->scratch.begin());
+    return percentile(
+        this->scratch.data(), this->scratch.data() + ring.len, p);
+}
+
+auto Input_latency::report() const -> void
+{
+    logs::info(
+        "input latency over the last ", this->samples[submit].len, " of ",
+        this->input_frames, " frames with input:");
+
+    for (size_t s {0}; s < stage_count; ++s) {
+        const Ring<report_size>& ring {this->samples[s]};
+        std::vector<float> values(
+            ring.values.begin(), ring.values.begin() + ring.len);
+        float* const begin {values.data()};
+        float* const end {begin + values.size()};
+        const double p50 {percentile(begin, end, 0.5)};
+        const double p90 {percentile(begin, end, 0.9)};
+        const double p99 {percentile(begin, end, 0.99)};
+
+        logs::info(
+            "    input to ", stage_names[s], " ms: p50 ", p50, " p90 ", p90,
+            " p99 ", p99);
+
+        const std::string key {stage_names[s]};
+        bench::set("input_latency", key + "_p50_ms", p50);
+        bench::set("input_latency", key + "_p90_ms", p90);
+        bench::set("input_latency", key + "_p99_ms", p99);
+    }
+    bench::set("input_latency", "frames", this->input_frames);
+}
+
+auto Input_latency::on_key(
+    GLFWwindow* /*window*/, int /*key*/, int /*code*/, int /*action*/,
+    int /*mods*/) -> void
+{
+    if (active != nullptr) {
+        active->arrived();
+    }
+}
+
+auto Input_latency::on_button(
+    GLFWwindow* /*window*/, int /*button*/, int /*action*/, int /*mods*/)
+    -> void
+{
+    if (active != nullptr) {
+        active->arrived();
+    }
+}
+
+auto Input_latency::on_cursor(
+    GLFWwindow* /*window*/, double /*x*/, double /*y*/) -> void
+{
+    if (active != nullptr) {
+        active->arrived();
+    }
+}
+
+auto Input_latency::arrived() -> void
+{
+    // keep the oldest, that is the one that waited the longest
+    if (!this->pending) {
+        this->pending = true;
+        this->pending_time = Clock::now();
+    }
+}
+
+auto Input_latency::calibrate() -> void
+{
+    // GL_TIMESTAMP is read without waiting for the GPU to catch up
+    GLint64 gpu_ns {0};
+    glGetInteger64v(GL_TIMESTAMP, &gpu_ns);
+    const auto now {Clock::now()};
+
+    this->gpu_offset_ns =
+        duration_cast<nanoseconds>(now - this->start).count() - gpu_ns;
+    this->calibrated = now;
+}
+
+auto Input_latency::poll(bool block) -> void
+{
+    while (this->frame_count > 0) {
+        Frame& frame {this->frames[this->frame_pos]};
+
+        // block only for the oldest one, that frees a slot
+        const GLenum status {glClientWaitSync(
+            frame.fence,
+            block ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+            block ? 100'000'000 : 0)}; // 100ms
+        block = false;
+        if (status == GL_TIMEOUT_EXPIRED) {
+            break;
+        }
+        if (status == GL_WAIT_FAILED) {
+            logs::err("waiting for a latency fence failed, frame dropped");
+        } else {
+            // the fence signaled so the query result is there already
+            GLuint64 gpu_ns {0};
+            glGetQueryObjectui64v(frame.query, GL_QUERY_RESULT, &gpu_ns);
+            const Clock::time_point done {
+                this->start + duration_cast<Clock::duration>(nanoseconds(
+                    static_cast<int64_t>(gpu_ns) + this->gpu_offset_ns))};
+            // calibration jitter can not put it before the submit
+            this->add(gpu, frame.input, std::max(done, frame.submit));
+        }
+
+        glDeleteSync(frame.fence);
+        this->frame_pos = (this->frame_pos + 1) % in_flight;
+        --this->frame_count;
+    }
+}
+
+auto Input_latency::add(
+    Stage stage, Clock::time_point input, Clock::time_point end) -> void
+{
+    const auto ms {static_cast<float>(
+        duration<double, std::milli>(end - input).count())};
+
+    if (stage == submit) {
+        ++this->input_frames;
+    }
+    this->samples[stage].push(ms);
+    this->recent[stage].push(ms);
+}
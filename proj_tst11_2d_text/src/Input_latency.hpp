@@ -0,0 +1,136 @@
+#ifndef SRC_INPUT_LATENCY_HPP_
+#define SRC_INPUT_LATENCY_HPP_
+
+/*******************************************************************************
+ * Input to photon latency.
+ *
+ * Key, mouse button and cursor events are timestamped in GLFW callbacks as
+ * they are dispatched by glfwPollEvents. The oldest input that arrived since
+ * the previous frame is attributed to the frame being built, which then gets
+ * three more timestamps:
+ *     submit - all GL calls issued, right before glfwSwapBuffers
+ *     swap   - glfwSwapBuffers returned
+ *     gpu    - the GPU finished the frame (a fence and a GL_TIMESTAMP query
+ *              behind the swap, read back once the fence signaled, so this
+ *              never stalls the main loop)
+ * "gpu" is the closest to photons we can get without external hardware, with
+ * v-sync on scanout still waits for the next vblank after it.
+ *
+ * Events wait in the OS queue until glfwPollEvents, that time is not visible
+ * here (GLFW gives no event timestamps), so all numbers are lower bounds.
+ ******************************************************************************/
+
+#include "gl_loader.hpp"
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+class Input_latency final {
+ public:
+    // frames with input whose fence can be pending at once
+    static constexpr unsigned in_flight {8};
+    // latencies the HUD percentiles are taken over
+    static constexpr unsigned recent_size {64};
+    // latencies the report percentiles are taken over, memory stays constant
+    // however long the run
+    static constexpr unsigned report_size {4096};
+
+    enum Stage {
+        submit,
+        swap,
+        gpu,
+        stage_count
+    };
+
+    // installs the input callbacks on `window`, needs a current GL context
+    explicit Input_latency(GLFWwindow* window);
+    ~Input_latency();
+    Input_latency(const Input_latency&) = delete;
+    auto operator=(const Input_latency&) -> Input_latency& = delete;
+
+    // after glfwPollEvents, input that came in since the last frame belongs to
+    // the frame starting now
+    auto begin_frame() -> void;
+    // right before glfwSwapBuffers
+    auto submitted() -> void;
+    // right after glfwSwapBuffers
+    auto swapped() -> void;
+
+    // percentile `p` (0.5 = median) of the recent input to `stage` latencies
+    // in ms, 0 if there were none
+    auto recent_ms(Stage stage, double p) const -> double;
+
+    // percentiles over the last `report_size` frames with input to the log and
+    // the benchmark summary
+    auto report() const -> void;
+
+ private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Frame {
+        Clock::time_point input;
+        Clock::time_point submit;
+        Clock::time_point swap;
+        GLsync fence;
+        GLuint query;
+    };
+
+    // the last `N` latencies of a stage in ms, the oldest is overwritten
+    template<unsigned N>
+    struct Ring {
+        std::array<float, N> values;
+        unsigned len;
+        unsigned pos;
+
+        auto push(float ms) -> void
+        {
+            this->values[this->pos] = ms;
+            this->pos = (this->pos + 1) % N;
+            this->len = std::min(this->len + 1, N);
+        }
+    };
+
+    static auto on_key(GLFWwindow* window, int key, int code, int action,
+                       int mods) -> void;
+    static auto on_button(GLFWwindow* window, int button, int action, int mods)
+        -> void;
+    static auto on_cursor(GLFWwindow* window, double x, double y) -> void;
+
+    auto arrived() -> void;
+    auto calibrate() -> void;
+    // collect frames the GPU is done with, oldest first, wait if `block`
+    auto poll(bool block) -> void;
+    auto add(Stage stage, Clock::time_point input, Clock::time_point end)
+        -> void;
+
+    static Input_latency* active;
+
+    GLFWwindow* window;
+
+    bool pending; // input arrived since the last begin_frame()
+    Clock::time_point pending_time;
+
+    bool has_input; // the current frame carries input
+    Frame cur;
+
+    std::array<Frame, in_flight> frames; // ring of frames waiting on the GPU
+    std::array<GLuint, in_flight> queries;
+    unsigned frame_count;
+    unsigned frame_pos; // oldest frame
+
+    // GPU timestamps are mapped to the CPU clock with an offset measured once
+    // a second
+    Clock::time_point start;
+    int64_t gpu_offset_ns;
+    Clock::time_point calibrated;
+
+    uint64_t input_frames; // over the whole run
+    std::array<Ring<report_size>, stage_count> samples;
+    std::array<Ring<recent_size>, stage_count> recent;
+    mutable std::array<float, recent_size> scratch; // for recent_ms()
+};
+
+#endif // SRC_INPUT_LATENCY_HPP_
@@ -0,0 +1,138 @@
+#include "Pbo_pool.hpp"
+
+#include "gl_loader.hpp"
+
+#include "gl_capture.hpp"
+#include "logs.hpp"
+
+#include "gl_intercept.hpp"
+
+Pbo_pool::Pbo_pool(unsigned count, size_t buffer_size)
+: persistent{false}
+, size{buffer_size}
+, buffers{}
+{
+    // a capture started with the program records everything from the start
+    if (gl_capture::is_recording()) {
+        logs::info("GL capture recording, texture uploads bypass the PBOs");
+        return;
+    }
+
+    this->persistent = gl_loader::has("GL_ARB_buffer_storage")
+        || gl_loader::version(4, 4);
+    const auto bytes {static_cast<GLsizeiptr>(this->size)};
+    constexpr GLbitfield persistent_flags {
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT};
+
+    for (unsigned i {0}; i < count; ++i) {
+        Buffer buffer {
+            .name = 0,
+            .mapped = nullptr,
+            .fence = nullptr,
+            .state = State::free,
+        };
+        glGenBuffers(1, &buffer.name);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.name);
+        if (this->persistent) {
+            glBufferStorage(
+                GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, persistent_flags);
+            buffer.mapped = static_cast<unsigned char*>(glMapBufferRange(
+                GL_PIXEL_UNPACK_BUFFER, 0, bytes, persistent_flags));
+        } else {
+            glBufferData(
+                GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        }
+        this->buffers.push_back(buffer);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    DBG(1, "PBO pool: ", count, " x ", this->size, " bytes, ",
+        this->persistent ? "persistently mapped" : "mapped per upload");
+}
+
+Pbo_pool::~Pbo_pool()
+{
+    for (Buffer& buffer : this->buffers) {
+        if (buffer.fence != nullptr) {
+            glDeleteSync(buffer.fence);
+        }
+        // deleting a buffer unmaps it
+        glDeleteBuffers(1, &buffer.name);
+    }
+}
+
+auto Pbo_pool::usable() const -> bool
+{
+    return !this->buffers.empty() && !gl_capture::is_recording();
+}
+
+auto Pbo_pool::buffer_size() const -> size_t
+{
+    return this->size;
+}
+
+auto Pbo_pool::acquire(size_t size, Staging& staging) -> bool
+{
+    if (size > this->size || !this->usable()) {
+        return false;
+    }
+
+    for (unsigned i {0}; i < this->buffers.size(); ++i) {
+        Buffer& buffer {this->buffers[i]};
+        if (buffer.state == State::in_flight && !this->retire(buffer)) {
+            continue;
+        }
+        if (buffer.state != State::free) {
+            continue;
+        }
+
+        if (!this->persistent) {
+            // invalidating: the driver does not wait for earlier contents
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.name);
+            buffer.mapped = static_cast<unsigned char*>(glMapBufferRange(
+                GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(this->size),
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        if (buffer.mapped == nullptr) {
+            logs::err("could not map PBO ", buffer.name);
+            return false;
+        }
+
+        buffer.state = State::writing;
+        staging = Staging{i, buffer.mapped, size};
+        return true;
+    }
+    return false;
+}
+
+auto Pbo_pool::bind(const Staging& staging) -> void
+{
+    Buffer& buffer {this->buffers[staging.index]};
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.name);
+    if (!this->persistent) {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        buffer.mapped = nullptr;
+    }
+}
+
+auto Pbo_pool::release(const Staging& staging) -> void
+{
+    Buffer& buffer {this->buffers[staging.index]};
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    buffer.state = State::in_flight;
+}
+
+auto Pbo_pool::retire(Buffer& buffer) -> bool
+{
+    // zero timeout: only asks, never waits for the GPU
+    const GLenum status {glClientWaitSync(buffer.fence, 0, 0)};
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return false;
+    }
+    glDeleteSync(buffer.fence);
+    buffer.fence = nullptr;
+    buffer.state = State::free;
+    return true;
+}
@@ -0,0 +1,89 @@
+#ifndef SRC_PBO_POOL_HPP_
+#define SRC_PBO_POOL_HPP_
+
+/*******************************************************************************
+ * Pixel buffer objects for streaming texture uploads.
+ *
+ * acquire() hands out a free buffer of the pool and a pointer to write the
+ * pixels to, which may be filled on any thread. Back on the context thread
+ * bind() makes it the GL_PIXEL_UNPACK_BUFFER, the glTex(Sub)Image calls then
+ * take offsets into it instead of client pointers and the driver copies from
+ * memory the GPU reads directly, without stalling the calling thread. release()
+ * fences the buffer (glFenceSync), acquire() only hands it out again once the
+ * fence is signalled, checked without waiting.
+ *
+ * With GL_ARB_buffer_storage (GL 4.4) the buffers are mapped once for good
+ * (persistent, coherent), otherwise acquire() maps one (invalidating it) and
+ * bind() unmaps it again.
+ *
+ *     Pbo_pool::Staging staging;
+ *     if (pbos.acquire(size, staging)) {
+ *         ... fill staging.data, on any thread ...
+ *         pbos.bind(staging);
+ *         glTexSubImage2D(..., Pbo_pool::offset(at));
+ *         pbos.release(staging);
+ *     }
+ *
+ * A GL capture needs the pixels in client memory, so the pool is not usable
+ * (usable() false, acquire() fails) while one is recording.
+ ******************************************************************************/
+
+#include "gl_loader.hpp"
+
+#include <cstddef>
+#include <vector>
+
+class Pbo_pool final {
+ public:
+    struct Staging {
+        unsigned index;
+        unsigned char* data; // `size` bytes to write the pixels to
+        size_t size;
+    };
+
+    Pbo_pool(unsigned count, size_t buffer_size);
+    ~Pbo_pool();
+    Pbo_pool(const Pbo_pool&) = delete;
+    auto operator=(const Pbo_pool&) -> Pbo_pool& = delete;
+
+    auto usable() const -> bool;
+    auto buffer_size() const -> size_t;
+
+    // a free buffer, false if none is free yet (or `size` does not fit one)
+    auto acquire(size_t size, Staging& staging) -> bool;
+
+    // the pointer to pass to upload calls for `bytes` into the bound buffer
+    static auto offset(size_t bytes) -> const void*
+    {
+        return reinterpret_cast<const void*>(bytes);
+    }
+
+    // bind the buffer for upload calls, the data must be completely written
+    // by now
+    auto bind(const Staging& staging) -> void;
+
+    // after the upload calls: unbind and fence the buffer
+    auto release(const Staging& staging) -> void;
+
+ private:
+    enum class State {
+        free,
+        writing,
+        in_flight
+    };
+
+    struct Buffer {
+        GLuint name;
+        unsigned char* mapped; // persistent mapping, or while writing
+        GLsync fence;
+        State state;
+    };
+
+    auto retire(Buffer& buffer) -> bool;
+
+    bool persistent;
+    size_t size;
+    std::vector<Buffer> buffers;
+};
+
+#endif // SRC_PBO_POOL_HPP_
@@ -0,0 +1,231 @@
+#include "Perf_counters.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#   include <linux/perf_event.h>
+#   include <sys/ioctl.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#endif
+
+#include "bench.hpp"
+#include "logs.hpp"
+
+namespace {
+    constexpr const char* event_names[Perf_counters::event_count] {
+        "instructions", "cycles", "L1D misses", "LLC misses", "branch misses"};
+
+#ifdef __linux__
+    auto open_event(uint32_t type, uint64_t config, int group_fd) -> int
+    {
+        perf_event_attr attr; // NOLINT
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = group_fd == -1 ? 1 : 0; // group starts with the leader
+        attr.exclude_kernel = 1; // allowed with perf_event_paranoid <= 2
+        attr.exclude_hv = 1;
+        attr.read_format =
+            PERF_FORMAT_GROUP
+            | PERF_FORMAT_TOTAL_TIME_ENABLED
+            | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // this thread, any cpu
+        return static_cast<int>(
+            syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+    }
+
+    constexpr auto cache_event(uint64_t cache, uint64_t op, uint64_t result)
+        -> uint64_t
+    {
+        return cache | (op << 8u) | (result << 16u);
+    }
+#endif
+} // namespace
+
+Perf_counters::Perf_counters(bool enable)
+: leader_fd{-1}
+, fds{}
+, slots{}
+, slot_count{0}
+, in_phase{false}
+, cur_phase{Frame_phase::input}
+, prev{}
+, totals{}
+, entered{}
+{
+    this->fds.fill(-1);
+    this->slots.fill(-1);
+
+    if (!enable) {
+        return;
+    }
+
+#ifdef __linux__
+    struct Config {
+        uint32_t type;
+        uint64_t config;
+    };
+    const std::array<Config, event_count> configs {{
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HW_CACHE, cache_event(
+            PERF_COUNT_HW_CACHE_L1D,
+            PERF_COUNT_HW_CACHE_OP_READ,
+            PERF_COUNT_HW_CACHE_RESULT_MISS)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    }};
+
+    // instructions lead the group, without them none of the rates make sense
+    for (size_t i {0}; i < configs.size(); ++i) {
+        const int fd {
+            open_event(configs[i].type, configs[i].config, this->leader_fd)};
+        if (fd == -1) {
+            if (i == instructions) {
+                logs::info(
+                    "perf events not available (", strerror(errno),
+                    "), hardware counters disabled");
+                return;
+            }
+            logs::info("perf event '", event_names[i], "' not supported");
+            continue;
+        }
+
+        if (i == instructions) {
+            this->leader_fd = fd;
+        }
+        this->fds[i] = fd;
+        this->slots[i] = this->slot_count++;
+    }
+
+    ioctl(this->leader_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(this->leader_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    logs::info("perf counters enabled (", this->slot_count, " events)");
+#else
+    logs::info("perf events are Linux only, hardware counters disabled");
+#endif
+}
+
+Perf_counters::~Perf_counters()
+{
+#ifdef __linux__
+    for (int fd : this->fds) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+auto Perf_counters::available() const -> bool
+{
+    return this->leader_fd != -1;
+}
+
+auto Perf_counters::enter(Frame_phase phase) -> void
+{
+    if (!this->available()) {
+        return;
+    }
+
+    Sample now; // NOLINT
+    if (!this->read(now)) {
+        return;
+    }
+
+    // raw counts only grow, their deltas are scaled up by how long the group
+    // got multiplexed out during the phase; scaling the totals first and
+    // subtracting could go negative when that share changes between reads
+    const uint64_t running {now.time_running - this->prev.time_running};
+    if (this->in_phase && running != 0) {
+        const double scale {
+            static_cast<double>(now.time_enabled - this->prev.time_enabled)
+            / static_cast<double>(running)};
+        auto& total {this->totals[static_cast<size_t>(this->cur_phase)]};
+        for (size_t i {0}; i < now.values.size(); ++i) {
+            total[i] += static_cast<uint64_t>(
+                static_cast<double>(now.values[i] - this->prev.values[i])
+                * scale);
+        }
+    }
+
+    this->prev = now;
+    this->cur_phase = phase;
+    this->in_phase = true;
+    ++this->entered[static_cast<size_t>(phase)];
+}
+
+auto Perf_counters::report() const -> void
+{
+    if (!this->available()) {
+        return;
+    }
+
+    for (size_t p {0}; p < frame_phase_count; ++p) {
+        const auto& total {this->totals[p]};
+        if (this->entered[p] == 0 || total[instructions] == 0) {
+            continue;
+        }
+
+        const char* name {phase_name(static_cast<Frame_phase>(p))};
+        const double instr {static_cast<double>(total[instructions])};
+        // misses per thousand instructions
+        auto mpki = [&](Event event) -> double {
+            return this->slots[event] == -1 ? -1.0 : total[event] * 1000.0 / instr;
+        };
+        const double ipc {
+            this->slots[cycles] == -1 || total[cycles] == 0
+                ? -1.0 : instr / total[cycles]};
+
+        logs::info(
+            "perf ", name, ": ",
+            instr / this->entered[p], " instructions/frame, IPC ", ipc,
+            ", L1D MPKI ", mpki(l1d_misses),
+            ", LLC MPKI ", mpki(llc_misses),
+            ", branch MPKI ", mpki(branch_misses));
+
+        // -1 marks events that could not be counted
+        const std::string section {std::string("perf_") + name};
+        bench::set(section, "instructions_per_frame", instr / this->entered[p]);
+        bench::set(section, "ipc", ipc);
+        bench::set(section, "l1d_mpki", mpki(l1d_misses));
+        bench::set(section, "llc_mpki", mpki(llc_misses));
+        bench::set(section, "branch_mpki", mpki(branch_misses));
+    }
+}
+
+auto Perf_counters::read(Sample& sample) -> bool
+{
+#ifdef __linux__
+    // layout of a PERF_FORMAT_GROUP read with both times
+    struct {
+        uint64_t nr;
+        uint64_t time_enabled;
+        uint64_t time_running;
+        uint64_t values[event_count];
+    } buf; // NOLINT
+
+    const ssize_t size {::read(this->leader_fd, &buf, sizeof(buf))};
+    if (size < static_cast<ssize_t>(3 * sizeof(uint64_t))
+        || buf.time_running == 0)
+    {
+        return false;
+    }
+
+    for (size_t i {0}; i < sample.values.size(); ++i) {
+        sample.values[i] =
+            this->slots[i] == -1 ? 0 : buf.values[this->slots[i]];
+    }
+    sample.time_enabled = buf.time_enabled;
+    sample.time_running = buf.time_running;
+    return true;
+#else
+    static_cast<void>(sample);
+    return false;
+#endif
+}
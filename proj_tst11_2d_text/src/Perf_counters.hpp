@@ -0,0 +1,71 @@
+#ifndef SRC_PERF_COUNTERS_HPP_
+#define SRC_PERF_COUNTERS_HPP_
+
+/*******************************************************************************
+ * Hardware performance counters of the main thread (Linux perf_event_open),
+ * attributed to the phases of the main loop.
+ *
+ * Counts user space instructions, cycles, L1D read misses, last level cache
+ * misses and branch misses as one group, read at every phase boundary. When
+ * perf events are not available (other OS, no PMU in a VM, restrictive
+ * perf_event_paranoid) everything quietly turns into a no-op, and events the
+ * CPU does not support are just left out.
+ ******************************************************************************/
+
+#include <array>
+#include <cstdint>
+
+#include "frame_phase.hpp"
+
+class Perf_counters final {
+ public:
+    enum Event {
+        instructions,
+        cycles,
+        l1d_misses,
+        llc_misses,
+        branch_misses,
+        event_count
+    };
+
+    // counters are only opened if `enable` is set, otherwise all is a no-op
+    explicit Perf_counters(bool enable);
+    ~Perf_counters();
+    Perf_counters(const Perf_counters&) = delete;
+    auto operator=(const Perf_counters&) -> Perf_counters& = delete;
+
+    auto available() const -> bool;
+
+    // everything counted since the previous call is attributed to the phase
+    // entered then, call at the start of every phase
+    auto enter(Frame_phase phase) -> void;
+
+    // per-phase IPC and misses per thousand instructions to the log and the
+    // benchmark summary
+    auto report() const -> void;
+
+ private:
+    // one group read, raw counts and the times the group was enabled and
+    // actually on the PMU
+    struct Sample {
+        std::array<uint64_t, event_count> values;
+        uint64_t time_enabled;
+        uint64_t time_running;
+    };
+
+    auto read(Sample& sample) -> bool;
+
+    int leader_fd;
+    std::array<int, event_count> fds;
+    // position of each event in a group read, -1 if not counted
+    std::array<int, event_count> slots;
+    int slot_count;
+
+    bool in_phase; // false until the first enter()
+    Frame_phase cur_phase;
+    Sample prev;
+    std::array<std::array<uint64_t, event_count>, frame_phase_count> totals;
+    std::array<unsigned, frame_phase_count> entered; // times each phase began
+};
+
+#endif // SRC_PERF_COUNTERS_HPP_
@@ -0,0 +1,451 @@
+#include "Shader_manager.hpp"
+
+#include "gl_loader.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "logs.hpp"
+#include "program_cache.hpp"
+#include "gl_intercept.hpp"
+
+namespace {
+    // GL_COMPLETION_STATUS_KHR has the same value as the ARB one
+    auto shader_complete(GLuint shader) -> bool
+    {
+        GLint complete {GL_FALSE};
+        glGetShaderiv(shader, GL_COMPLETION_STATUS_KHR, &complete);
+        return complete == GL_TRUE;
+    }
+
+    auto program_complete(GLuint program) -> bool
+    {
+        GLint complete {GL_FALSE};
+        glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &complete);
+        return complete == GL_TRUE;
+    }
+
+    // logs the info log if there is one, returns the compile status
+    auto check_shader(GLuint shader, const std::string& name) -> bool
+    {
+        GLint result {GL_FALSE};
+        int info_log_length {0};
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &result);
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
+        if (info_log_length > 0) {
+            std::vector<char> err_msg(info_log_length + 1);
+            glGetShaderInfoLog(shader, info_log_length, nullptr, &err_msg[0]);
+            logs::err("could not compile ", name, ":\n", &err_msg[0]);
+        }
+        return result == GL_TRUE;
+    }
+} // namespace
+
+Shader_manager::Shader_manager()
+: parallel{false}
+, programs{}
+, uniforms{}
+, watcher{}
+{
+    if (gl_loader::has("GL_KHR_parallel_shader_compile")) {
+        // 0xFFFFFFFF: as many threads as the driver wants
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        this->parallel = true;
+    } else if (gl_loader::has("GL_ARB_parallel_shader_compile")) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        this->parallel = true;
+    }
+    DBG(1, "parallel shader compile: ", this->parallel ? "yes" : "no");
+}
+
+Shader_manager::~Shader_manager()
+{
+    // programs nobody asked for are still ours
+    for (Program& prog : this->programs) {
+        if (prog.rebuild) {
+            this->discard(*prog.rebuild);
+        }
+        this->discard(prog);
+    }
+}
+
+auto Shader_manager::read(
+    const char* vertex_file_path,
+    const char* fragment_file_path,
+    const std::vector<std::string>& defines) -> Sources
+{
+    Sources sources {
+        .vertex_path = vertex_file_path,
+        .fragment_path = fragment_file_path,
+        .defines = defines,
+        .vertex = {},
+        .fragment = {},
+        .ok = false,
+    };
+    sources.ok =
+        glsl::preprocess(sources.vertex_path, defines, sources.vertex)
+        && glsl::preprocess(sources.fragment_path, defines, sources.fragment);
+    return sources;
+}
+
+auto Shader_manager::submit(
+    const char* vertex_file_path,
+    const char* fragment_file_path,
+    const std::vector<std::string>& defines) -> Handle
+{
+    return this->submit(
+        read(vertex_file_path, fragment_file_path, defines));
+}
+
+auto Shader_manager::submit(const Sources& sources) -> Handle
+{
+    const std::vector<std::string>& defines {sources.defines};
+    Program prog {
+        .vertex_path = sources.vertex_path,
+        .fragment_path = sources.fragment_path,
+        .defines = defines,
+        .name = sources.vertex_path + " + " + sources.fragment_path,
+        .files = {},
+        .file_table = {},
+        .state = State::failed,
+        .cache_key = 0,
+        .vertex = 0,
+        .fragment = 0,
+        .program = 0,
+        .info = {},
+        .rebuild = nullptr,
+        .rebuild_waited = 0,
+    };
+    for (size_t i {0}; i < defines.size(); ++i) {
+        prog.name += (i == 0 ? " [" : ", ") + defines[i];
+    }
+    if (!defines.empty()) {
+        prog.name += "]";
+    }
+
+    const bool read {this->take_sources(prog, sources)};
+
+    // identical final sources, identical program
+    if (read) {
+        for (unsigned id {0}; id < this->programs.size(); ++id) {
+            const Program& other {this->programs[id]};
+            if (other.cache_key == prog.cache_key
+                && other.state != State::failed)
+            {
+                DBG(1, prog.name, " is the same program as ", other.name);
+                return Handle{id};
+            }
+        }
+    }
+
+    const Handle handle {static_cast<unsigned>(this->programs.size())};
+    this->programs.push_back(std::move(prog));
+    Program& added {this->programs.back()};
+    if (this->watcher) {
+        for (const std::string& file : added.files) {
+            this->watcher->add(file);
+        }
+    }
+    if (read) {
+        this->compile(added, sources.vertex, sources.fragment);
+    }
+    return handle;
+}
+
+auto Shader_manager::poll() -> void
+{
+    for (Program& prog : this->programs) {
+        this->advance(prog, false);
+    }
+}
+
+auto Shader_manager::ready(Handle handle) -> bool
+{
+    Program& prog {this->programs.at(handle.id)};
+    this->advance(prog, false);
+    return prog.state == State::done || prog.state == State::failed;
+}
+
+auto Shader_manager::get(Handle handle) -> GLuint
+{
+    Program& prog {this->programs.at(handle.id)};
+    this->advance(prog, true);
+    return prog.state == State::done ? prog.program : 0;
+}
+
+auto Shader_manager::wait_all() -> bool
+{
+    // everything gets linked before the first wait
+    this->poll();
+
+    bool ok {true};
+    for (Program& prog : this->programs) {
+        this->advance(prog, true);
+        ok = ok && prog.state == State::done;
+    }
+    return ok;
+}
+
+auto Shader_manager::watch() -> void
+{
+    if (this->watcher) {
+        return;
+    }
+
+    this->watcher = std::make_unique<File_watcher>();
+    for (const Program& prog : this->programs) {
+        for (const std::string& file : prog.files) {
+            this->watcher->add(file);
+        }
+    }
+    logs::info("watching shader sources for changes");
+}
+
+auto Shader_manager::update() -> void
+{
+    if (!this->watcher) {
+        return;
+    }
+
+    for (const std::string& path : this->watcher->changed()) {
+        for (Program& prog : this->programs) {
+            const auto& files {prog.files};
+            if (std::find(files.begin(), files.end(), path) == files.end()) {
+                continue;
+            }
+            // a newer edit wins over a rebuild still in flight
+            if (prog.rebuild) {
+                this->discard(*prog.rebuild);
+            }
+            prog.rebuild = std::make_unique<Program>(Program{
+                .vertex_path = prog.vertex_path,
+                .fragment_path = prog.fragment_path,
+                .defines = prog.defines,
+                .name = prog.name,
+                .files = {},
+                .file_table = {},
+                .state = State::failed,
+                .cache_key = 0,
+                .vertex = 0,
+                .fragment = 0,
+                .program = 0,
+                .info = {},
+                .rebuild = nullptr,
+                .rebuild_waited = 0,
+            });
+            prog.rebuild_waited = 0;
+            this->start(*prog.rebuild);
+        }
+    }
+
+    for (unsigned id {0}; id < this->programs.size(); ++id) {
+        Program& prog {this->programs[id]};
+        if (!prog.rebuild) {
+            continue;
+        }
+
+        /* without parallel compile there is no way to ask if the link is
+         * done without waiting for it, give the driver a frame first */
+        const bool block {!this->parallel && prog.rebuild_waited > 0};
+        ++prog.rebuild_waited;
+        this->advance(*prog.rebuild, block);
+
+        if (prog.rebuild->state == State::done) {
+            this->swap(id);
+        } else if (prog.rebuild->state == State::failed) {
+            logs::err("keeping the previous version of ", prog.name);
+            prog.rebuild.reset();
+        }
+    }
+}
+
+auto Shader_manager::program(Handle handle) const -> GLuint
+{
+    const Program& prog {this->programs.at(handle.id)};
+    return prog.state == State::done ? prog.program : 0;
+}
+
+auto Shader_manager::info(Handle handle) const
+    -> const gl_reflect::Program_info&
+{
+    return this->programs.at(handle.id).info;
+}
+
+auto Shader_manager::take_sources(Program& prog, const Sources& sources)
+    -> bool
+{
+    // whatever was read is watched, so fixing a missing include works too
+    const auto& vertex_files {sources.vertex.files};
+    const auto& fragment_files {sources.fragment.files};
+    prog.files = vertex_files;
+    prog.files.insert(
+        prog.files.end(), fragment_files.begin(), fragment_files.end());
+    if (!sources.ok) {
+        prog.state = State::failed;
+        return false;
+    }
+
+    // the key includes the driver strings, so this part needs the context
+    prog.cache_key = program_cache::key(
+        {sources.vertex.code, sources.fragment.code});
+    return true;
+}
+
+auto Shader_manager::compile(
+    Program& prog, const glsl::Source& vertex, const glsl::Source& fragment)
+    -> void
+{
+    prog.program = program_cache::load(prog.cache_key);
+    if (prog.program != 0) {
+        prog.info = gl_reflect::reflect(prog.program);
+        prog.state = State::done;
+        return;
+    }
+
+    logs::info("compiling shaders: ", prog.name);
+    prog.file_table =
+        "vertex " + glsl::file_table(vertex)
+        + ", fragment " + glsl::file_table(fragment);
+
+    const char* vertex_code_p {vertex.code.c_str()};
+    prog.vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(prog.vertex, 1, &vertex_code_p, nullptr);
+    glCompileShader(prog.vertex);
+
+    const char* fragment_code_p {fragment.code.c_str()};
+    prog.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(prog.fragment, 1, &fragment_code_p, nullptr);
+    glCompileShader(prog.fragment);
+
+    prog.state = State::compiling;
+}
+
+auto Shader_manager::start(Program& prog) -> void
+{
+    const Sources sources {read(
+        prog.vertex_path.c_str(), prog.fragment_path.c_str(), prog.defines)};
+    if (this->take_sources(prog, sources)) {
+        this->compile(prog, sources.vertex, sources.fragment);
+    }
+}
+
+auto Shader_manager::advance(Program& prog, bool block) -> void
+{
+    if (prog.state == State::compiling) {
+        if (!block && this->parallel
+            && !(shader_complete(prog.vertex) && shader_complete(prog.fragment)))
+        {
+            return;
+        }
+        // without the extension linking right away costs nothing, errors
+        // show up when the link is checked
+        this->link(prog);
+    }
+
+    if (prog.state == State::linking) {
+        if (!block && (!this->parallel || !program_complete(prog.program))) {
+            return;
+        }
+        this->finish(prog);
+    }
+}
+
+auto Shader_manager::link(Program& prog) -> void
+{
+    prog.program = glCreateProgram();
+    if (prog.program == 0) {
+        logs::err("could not create shader program");
+        glDeleteShader(prog.vertex);
+        glDeleteShader(prog.fragment);
+        prog.state = State::failed;
+        return;
+    }
+
+    DBG(1, "linking shader program: ", prog.name);
+    program_cache::prepare(prog.program);
+    glAttachShader(prog.program, prog.vertex);
+    glAttachShader(prog.program, prog.fragment);
+    glLinkProgram(prog.program);
+    prog.state = State::linking;
+}
+
+auto Shader_manager::finish(Program& prog) -> void
+{
+    bool ok {check_shader(prog.vertex, "vertex shader")};
+    ok = check_shader(prog.fragment, "fragment shader") && ok;
+
+    GLint result {GL_FALSE};
+    int info_log_length {0};
+    glGetProgramiv(prog.program, GL_LINK_STATUS, &result);
+    glGetProgramiv(prog.program, GL_INFO_LOG_LENGTH, &info_log_length);
+    if (info_log_length > 0) {
+        std::vector<char> err_msg(info_log_length + 1);
+        glGetProgramInfoLog(
+            prog.program,
+            info_log_length,
+            nullptr,
+            &err_msg[0]);
+        logs::err("could not link shader program:\n", &err_msg[0]);
+    }
+    ok = ok && result == GL_TRUE;
+
+    glDetachShader(prog.program, prog.vertex);
+    glDetachShader(prog.program, prog.fragment);
+    glDeleteShader(prog.vertex);
+    glDeleteShader(prog.fragment);
+
+    if (!ok) {
+        // compiler messages number the sources, this says which is which
+        logs::err(
+            "errors while building ", prog.name, " (", prog.file_table, ")");
+        glDeleteProgram(prog.program);
+        prog.program = 0;
+        prog.state = State::failed;
+        return;
+    }
+
+    program_cache::store(prog.cache_key, prog.program);
+    prog.info = gl_reflect::reflect(prog.program);
+    prog.state = State::done;
+}
+
+auto Shader_manager::discard(Program& prog) -> void
+{
+    if (prog.state == State::compiling || prog.state == State::linking) {
+        glDeleteShader(prog.vertex);
+        glDeleteShader(prog.fragment);
+        glDeleteProgram(prog.program);
+        prog.state = State::failed;
+    }
+}
+
+auto Shader_manager::swap(unsigned id) -> void
+{
+    Program& prog {this->programs[id]};
+
+    // deleting a program that is still bound is fine, GL keeps it until the
+    // next glUseProgram
+    if (prog.state == State::done) {
+        glDeleteProgram(prog.program);
+    }
+    prog.program = prog.rebuild->program;
+    prog.info = std::move(prog.rebuild->info);
+    prog.cache_key = prog.rebuild->cache_key;
+    prog.files = prog.rebuild->files;
+    for (const std::string& file : prog.files) {
+        this->watcher->add(file); // new includes
+    }
+    prog.state = State::done;
+    prog.rebuild.reset();
+
+    // a uniform that went away is logged by bind()
+    for (Uniform_entry& entry : this->uniforms) {
+        if (entry.program == id) {
+            entry.uniform->bind(prog.info);
+        }
+    }
+
+    logs::info("reloaded ", prog.name);
+}
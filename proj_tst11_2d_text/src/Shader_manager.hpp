@@ -0,0 +1,179 @@
+#ifndef SRC_SHADER_MANAGER_HPP_
+#define SRC_SHADER_MANAGER_HPP_
+
+/*******************************************************************************
+ * Asynchronous shader program building and hot reloading.
+ *
+ * submit() reads the sources and starts compiling right away without asking
+ * for any status, so all programs can be handed to the driver up front and
+ * compile side by side. Each one then moves on by itself:
+ *     compiling -> linking -> done (or failed)
+ * poll() advances whatever is finished without blocking, get() blocks until
+ * the given program is done.
+ *
+ * With GL_KHR_parallel_shader_compile (or the ARB version) the driver compiles
+ * on its own threads and GL_COMPLETION_STATUS tells when a step is finished.
+ * Without it the driver may still defer work, but asking whether a link is done
+ * would block, so that only happens in get().
+ *
+ * After watch() the source files are watched (see File_watcher.hpp) and a
+ * changed program is rebuilt next to the old one, which stays in use until
+ * update() finds the new one linked and swaps it in. Call update() between
+ * frames and look the program up with program() every frame, uniform handles
+ * taken through uniform() are bound to the new program on the swap. A broken
+ * edit only logs the errors and keeps the old program.
+ *
+ * Sources go through the GLSL preprocessor (see glsl.hpp), so shaders can
+ * #include shared code and be specialised with defines. Submitting a variant
+ * whose final sources match one submitted before gives back the same handle,
+ * it is only compiled once. Included files are watched too.
+ *
+ * The CPU side of submit() (reading and preprocessing) is also available on
+ * its own as read(), which needs no GL context, so it can run on a worker
+ * thread while the context is still being created; submit() the result later.
+ *
+ * Finished programs belong to the caller, apart from the ones replaced by a
+ * reload. Programs found in the program cache (see program_cache.hpp) are done
+ * immediately.
+ ******************************************************************************/
+
+#include "gl_loader.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "File_watcher.hpp"
+#include "Uniform.hpp"
+#include "gl_reflect.hpp"
+#include "glsl.hpp"
+
+class Shader_manager final {
+ public:
+    // future-like reference to a submitted program
+    struct Handle {
+        unsigned id;
+    };
+
+    // preprocessed sources of a program, see read()
+    struct Sources {
+        std::string vertex_path;
+        std::string fragment_path;
+        std::vector<std::string> defines;
+        glsl::Source vertex;
+        glsl::Source fragment;
+        bool ok; // false if a file could not be read (already logged)
+    };
+
+    // read and preprocess the sources of a program, on any thread
+    static auto read(
+        const char* vertex_file_path,
+        const char* fragment_file_path,
+        const std::vector<std::string>& defines = {}) -> Sources;
+
+    Shader_manager();
+    ~Shader_manager();
+    Shader_manager(const Shader_manager&) = delete;
+    auto operator=(const Shader_manager&) -> Shader_manager& = delete;
+
+    // start building a program, never blocks on the driver, `defines` are
+    // injected into both shaders ("NAME" or "NAME VALUE")
+    auto submit(
+        const char* vertex_file_path,
+        const char* fragment_file_path,
+        const std::vector<std::string>& defines = {}) -> Handle;
+
+    // start building a program out of sources read earlier
+    auto submit(const Sources& sources) -> Handle;
+
+    // advance all programs as far as possible without blocking
+    auto poll() -> void;
+
+    // true once `handle` is done or failed (does not block)
+    auto ready(Handle handle) -> bool;
+
+    // the linked program, blocks until it is done, 0 if it failed
+    auto get(Handle handle) -> GLuint;
+
+    // block until every submitted program is done, false if any failed
+    auto wait_all() -> bool;
+
+    // rebuild programs whose sources change from now on
+    auto watch() -> void;
+
+    // between frames: start rebuilds of changed programs and swap in the ones
+    // that are ready, never blocks with parallel shader compile
+    auto update() -> void;
+
+    // the current program of `handle` (0 while not done), changes on reload
+    auto program(Handle handle) const -> GLuint;
+
+    // reflection of the current program (empty while not done)
+    auto info(Handle handle) const -> const gl_reflect::Program_info&;
+
+    // typed handle to a uniform of a program, waits for the program to be
+    // done, the reference stays valid (and bound) across reloads
+    template<typename T>
+    auto uniform(Handle handle, const std::string& name) -> Uniform<T>&
+    {
+        this->get(handle);
+        auto entry {std::make_unique<Uniform<T>>(this->info(handle), name)};
+        Uniform<T>& ref {*entry};
+        this->uniforms.push_back(Uniform_entry{handle.id, std::move(entry)});
+        return ref;
+    }
+
+ private:
+    enum class State {
+        compiling,
+        linking,
+        done,
+        failed
+    };
+
+    struct Program {
+        std::string vertex_path;
+        std::string fragment_path;
+        std::vector<std::string> defines;
+        std::string name; // for the log
+        std::vector<std::string> files; // sources and includes, to watch
+        std::string file_table; // source numbers in compiler messages
+        State state;
+        uint64_t cache_key;
+        GLuint vertex;
+        GLuint fragment;
+        GLuint program;
+        gl_reflect::Program_info info;
+
+        // the replacement being built after a source change
+        std::unique_ptr<Program> rebuild;
+        unsigned rebuild_waited; // update() calls since it was started
+    };
+
+    struct Uniform_entry {
+        unsigned program; // Handle id
+        std::unique_ptr<Uniform_base> uniform;
+    };
+
+    // sets the files and cache key of `prog` from its sources
+    auto take_sources(Program& prog, const Sources& sources) -> bool;
+    // start compiling (or take the program from the cache)
+    auto compile(
+        Program& prog, const glsl::Source& vertex, const glsl::Source& fragment)
+        -> void;
+    auto start(Program& prog) -> void;
+    // move `prog` on, waiting for the driver only if `block` is set
+    auto advance(Program& prog, bool block) -> void;
+    auto link(Program& prog) -> void;
+    auto finish(Program& prog) -> void;
+    auto discard(Program& prog) -> void;
+    auto swap(unsigned id) -> void;
+
+    bool parallel; // GL_COMPLETION_STATUS can be queried
+    std::vector<Program> programs;
+    std::vector<Uniform_entry> uniforms;
+    std::unique_ptr<File_watcher> watcher;
+};
+
+#endif // SRC_SHADER_MANAGER_HPP_
@@ -0,0 +1,101 @@
+#include "Skyline.hpp"
+
+#include <algorithm>
+
+Skyline::Skyline(unsigned width, unsigned height)
+: width{width}
+, height{height}
+, segments{Segment{0, 0, width}}
+{}
+
+auto Skyline::insert(unsigned width, unsigned height, unsigned& x, unsigned& y)
+    -> bool
+{
+    if (width == 0 || height == 0) {
+        return false;
+    }
+
+    size_t best {this->segments.size()};
+    unsigned best_top {0};
+    unsigned best_width {0};
+    for (size_t i {0}; i < this->segments.size(); ++i) {
+        unsigned at;
+        if (!this->fit(i, width, height, at)) {
+            continue;
+        }
+        const unsigned top {at + height};
+        if (best == this->segments.size() || top < best_top
+            || (top == best_top && this->segments[i].width < best_width)) {
+            best = i;
+            best_top = top;
+            best_width = this->segments[i].width;
+            y = at;
+        }
+    }
+    if (best == this->segments.size()) {
+        return false;
+    }
+    x = this->segments[best].x;
+
+    // the new segment replaces what it covers, a segment it only partly
+    // covers keeps the rest
+    const unsigned end {x + width};
+    this->segments.insert(
+        this->segments.begin() + static_cast<std::ptrdiff_t>(best),
+        Segment{x, y + height, width});
+    size_t next {best + 1};
+    while (next < this->segments.size() && this->segments[next].x < end) {
+        Segment& segment {this->segments[next]};
+        const unsigned segment_end {segment.x + segment.width};
+        if (segment_end <= end) {
+            this->segments.erase(
+                this->segments.begin() + static_cast<std::ptrdiff_t>(next));
+            continue;
+        }
+        segment.width = segment_end - end;
+        segment.x = end;
+        break;
+    }
+
+    // neighbours at the same height become one
+    for (size_t i {0}; i + 1 < this->segments.size();) {
+        if (this->segments[i].y == this->segments[i + 1].y) {
+            this->segments[i].width += this->segments[i + 1].width;
+            this->segments.erase(
+                this->segments.begin() + static_cast<std::ptrdiff_t>(i + 1));
+        } else {
+            ++i;
+        }
+    }
+    return true;
+}
+
+auto Skyline::occupancy() const -> float
+{
+    size_t used {0};
+    for (const Segment& segment : this->segments) {
+        used += size_t{segment.width} * segment.y;
+    }
+    return static_cast<float>(used)
+        / (static_cast<float>(this->width) * static_cast<float>(this->height));
+}
+
+auto Skyline::fit(size_t index, unsigned width, unsigned height, unsigned& y)
+    const -> bool
+{
+    const unsigned x {this->segments[index].x};
+    if (width > this->width - x) {
+        return false;
+    }
+    y = 0;
+    unsigned left {width};
+    for (size_t i {index}; left > 0; ++i) {
+        const Segment& segment {this->segments[i]};
+        y = std::max(y, segment.y);
+        if (height > this->height - y) {
+            return false;
+        }
+        left -= std::min(left, segment.width);
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef SRC_SKYLINE_HPP_
+#define SRC_SKYLINE_HPP_
+
+/*******************************************************************************
+ * Rectangle packing into a fixed size area, for the pages of an Atlas.
+ *
+ * The packed area is kept as its skyline: the top edge of what is placed so
+ * far, a list of horizontal segments from left to right. insert() tries the
+ * rectangle at the left end of every segment, resting on the highest segment
+ * it spans, and takes the place where its top ends lowest (ties go to the
+ * narrowest segment, which leaves the fewest gaps). Space below the skyline
+ * that a placement overhangs is lost, in exchange every insert() is linear in
+ * the number of segments and rectangles can come in any order. Sorting them
+ * by height first packs tighter.
+ ******************************************************************************/
+
+#include <cstddef>
+#include <vector>
+
+class Skyline final {
+ public:
+    Skyline(unsigned width, unsigned height);
+
+    // where a `width` x `height` rectangle goes, false if it does not fit
+    auto insert(unsigned width, unsigned height, unsigned& x, unsigned& y)
+        -> bool;
+
+    // the share of the area under the skyline, lost gaps included
+    auto occupancy() const -> float;
+
+ private:
+    struct Segment {
+        unsigned x;
+        unsigned y; // the top of what is placed there
+        unsigned width;
+    };
+
+    // the height a `width` wide rectangle at segment `index` rests on, false
+    // if it runs past the right or top edge
+    auto fit(size_t index, unsigned width, unsigned height, unsigned& y) const
+        -> bool;
+
+    unsigned width;
+    unsigned height;
+    std::vector<Segment> segments;
+};
+
+#endif // SRC_SKYLINE_HPP_
@@ -0,0 +1,190 @@
+#include "Texture_arrays.hpp"
+
+#include "gl_loader.hpp"
+
+#include <numeric>
+#include <utility>
+
+#include "logs.hpp"
+
+#include "gl_intercept.hpp"
+
+Texture_arrays::Texture_arrays(GLsizei layers_per_array)
+: layers_per_array{layers_per_array}
+, array_list{}
+{}
+
+Texture_arrays::~Texture_arrays()
+{
+    for (const Array& array : this->array_list) {
+        glDeleteTextures(1, &array.name);
+    }
+}
+
+auto Texture_arrays::add(const dds::Image& image, Handle& handle) -> bool
+{
+    if (image.target != GL_TEXTURE_2D) {
+        logs::err("texture arrays: only 2D textures can be layers");
+        return false;
+    }
+    if (!dds::supported(GL_TEXTURE_2D_ARRAY, image.format.internal_format)) {
+        logs::err(
+            "texture arrays: ", image.format.name,
+            " not supported by the context");
+        return false;
+    }
+
+    std::vector<Level> levels;
+    for (const dds::Surface& surface : image.surfaces) {
+        levels.push_back(Level{
+            static_cast<GLsizei>(surface.width),
+            static_cast<GLsizei>(surface.height), surface.data,
+            static_cast<GLsizei>(surface.size)});
+    }
+    return this->add(
+        Key{
+            .internal_format = image.format.internal_format,
+            .format = image.format.format,
+            .type = image.format.type,
+            .compressed = image.format.block_bytes != 0,
+            .width = static_cast<GLsizei>(image.width),
+            .height = static_cast<GLsizei>(image.height),
+            .levels = static_cast<GLint>(image.levels),
+        },
+        levels, handle);
+}
+
+auto Texture_arrays::add(
+    const std::vector<unsigned char>& rgba,
+    const std::vector<mipmaps::Level>& levels, Handle& handle) -> bool
+{
+    std::vector<Level> surfaces;
+    for (size_t i {0}; i < levels.size(); ++i) {
+        const size_t next {
+            i + 1 < levels.size() ? levels[i + 1].offset : rgba.size()};
+        surfaces.push_back(Level{
+            static_cast<GLsizei>(levels[i].width),
+            static_cast<GLsizei>(levels[i].height),
+            rgba.data() + levels[i].offset,
+            static_cast<GLsizei>(next - levels[i].offset)});
+    }
+    return this->add(
+        Key{
+            .internal_format = GL_RGBA8,
+            .format = GL_RGBA,
+            .type = GL_UNSIGNED_BYTE,
+            .compressed = false,
+            .width = surfaces.front().width,
+            .height = surfaces.front().height,
+            .levels = static_cast<GLint>(surfaces.size()),
+        },
+        surfaces, handle);
+}
+
+auto Texture_arrays::remove(Handle handle) -> void
+{
+    this->array_list[handle.array].free_layers.push_back(handle.layer);
+}
+
+auto Texture_arrays::texture(Handle handle) const -> GLuint
+{
+    return this->array_list[handle.array].name;
+}
+
+auto Texture_arrays::arrays() const -> size_t
+{
+    return this->array_list.size();
+}
+
+auto Texture_arrays::layers_used() const -> size_t
+{
+    return std::accumulate(
+        this->array_list.begin(), this->array_list.end(), size_t{0},
+        [&](size_t used, const Array& array) {
+            return used + static_cast<size_t>(this->layers_per_array)
+                - array.free_layers.size();
+        });
+}
+
+auto Texture_arrays::same(const Key& a, const Key& b) -> bool
+{
+    return a.internal_format == b.internal_format && a.format == b.format
+        && a.type == b.type && a.compressed == b.compressed
+        && a.width == b.width && a.height == b.height && a.levels == b.levels;
+}
+
+auto Texture_arrays::add(
+    const Key& key, const std::vector<Level>& levels, Handle& handle) -> bool
+{
+    unsigned index {0};
+    while (index < this->array_list.size()
+           && !(same(this->array_list[index].key, key)
+                && !this->array_list[index].free_layers.empty())) {
+        ++index;
+    }
+    if (index == this->array_list.size()) {
+        index = this->create(key, levels);
+    }
+
+    Array& array {this->array_list[index]};
+    handle = Handle{index, array.free_layers.back()};
+    array.free_layers.pop_back();
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array.name);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, key.compressed ? 1 : 4);
+    for (GLint level {0}; level < key.levels; ++level) {
+        const Level& surface {levels[static_cast<size_t>(level)]};
+        if (key.compressed) {
+            glCompressedTexSubImage3D(
+                GL_TEXTURE_2D_ARRAY, level, 0, 0, handle.layer,
+                surface.width, surface.height, 1, key.internal_format,
+                surface.size, surface.data);
+        } else {
+            glTexSubImage3D(
+                GL_TEXTURE_2D_ARRAY, level, 0, 0, handle.layer,
+                surface.width, surface.height, 1, key.format, key.type,
+                surface.data);
+        }
+    }
+    DBG(3, "texture arrays: layer ", handle.layer, " of array ", index);
+    return true;
+}
+
+auto Texture_arrays::create(const Key& key, const std::vector<Level>& levels)
+    -> unsigned
+{
+    Array array {key, 0, {}};
+    // the first add() takes layer 0
+    for (GLint layer {this->layers_per_array - 1}; layer >= 0; --layer) {
+        array.free_layers.push_back(layer);
+    }
+
+    glGenTextures(1, &array.name);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array.name);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, key.levels - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(
+        GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    for (GLint level {0}; level < key.levels; ++level) {
+        const Level& surface {levels[static_cast<size_t>(level)]};
+        if (key.compressed) {
+            glCompressedTexImage3D(
+                GL_TEXTURE_2D_ARRAY, level, key.internal_format,
+                surface.width, surface.height, this->layers_per_array, 0,
+                surface.size * this->layers_per_array, nullptr);
+        } else {
+            glTexImage3D(
+                GL_TEXTURE_2D_ARRAY, level,
+                static_cast<GLint>(key.internal_format), surface.width,
+                surface.height, this->layers_per_array, 0, key.format,
+                key.type, nullptr);
+        }
+    }
+
+    this->array_list.push_back(std::move(array));
+    DBG(2, "texture arrays: array ", this->array_list.size() - 1, " of ",
+        this->layers_per_array, " ", key.width, "x", key.height, " layers");
+    return static_cast<unsigned>(this->array_list.size() - 1);
+}
@@ -0,0 +1,105 @@
+#ifndef SRC_TEXTURE_ARRAYS_HPP_
+#define SRC_TEXTURE_ARRAYS_HPP_
+
+/*******************************************************************************
+ * Textures of the same format and size as layers of shared
+ * GL_TEXTURE_2D_ARRAY textures, so objects with different textures draw in
+ * one draw call: bind the array once and pass the layer per vertex or per
+ * instance (see drawLayer2D() in text2D.hpp, the font sample line of main.cpp
+ * draws two fonts that way).
+ *
+ * add() finds an array for the image's format, size and mipmap count with a
+ * free layer, making a new one of `layers_per_array` layers when none has,
+ * and uploads the image into it right away (on the context thread, the
+ * image is in memory already: a .dds parsed by dds::parse() or RGBA pixels
+ * with mipmaps::generate() mipmaps). The handle gives the array to bind and
+ * the layer. remove() puts the layer back on its array's free list for the
+ * next add() to reuse, the array keeps its storage. An array never grows:
+ * resizing would mean copying every layer on the GPU (glCopyImageSubData is
+ * GL 4.3), a new array is just one more bind for the draws that use it.
+ *
+ * The arrays are filtered trilinearly and repeat, like the textures of
+ * Texture_manager, and are deleted with the manager.
+ ******************************************************************************/
+
+#include "gl_loader.hpp"
+
+#include <cstddef>
+#include <vector>
+
+#include "dds.hpp"
+#include "mipmaps.hpp"
+
+class Texture_arrays final {
+ public:
+    struct Handle {
+        unsigned array;
+        GLint layer;
+    };
+
+    static constexpr GLsizei default_layers_per_array {64};
+
+    explicit Texture_arrays(
+        GLsizei layers_per_array = default_layers_per_array);
+    ~Texture_arrays();
+    Texture_arrays(const Texture_arrays&) = delete;
+    auto operator=(const Texture_arrays&) -> Texture_arrays& = delete;
+
+    // a 2D (one layer) .dds, false (and an error logged) if it is an array
+    // or cubemap or the context can not do its format in an array
+    auto add(const dds::Image& image, Handle& handle) -> bool;
+
+    // RGBA8 pixels with their mipmaps, as mipmaps::generate() leaves them
+    auto add(
+        const std::vector<unsigned char>& rgba,
+        const std::vector<mipmaps::Level>& levels, Handle& handle) -> bool;
+
+    // the layer is free again, the handle must not be used any more
+    auto remove(Handle handle) -> void;
+
+    // the GL_TEXTURE_2D_ARRAY to bind for `handle`
+    auto texture(Handle handle) const -> GLuint;
+
+    // arrays made so far, and layers in use over all of them
+    auto arrays() const -> size_t;
+    auto layers_used() const -> size_t;
+
+ private:
+    // what the textures of an array have in common
+    struct Key {
+        GLenum internal_format;
+        GLenum format; // uncompressed only
+        GLenum type;   // uncompressed only
+        bool compressed;
+        GLsizei width;
+        GLsizei height;
+        GLint levels;
+    };
+
+    // one mipmap of the image to add
+    struct Level {
+        GLsizei width;
+        GLsizei height;
+        const unsigned char* data;
+        GLsizei size;
+    };
+
+    struct Array {
+        Key key;
+        GLuint name;
+        std::vector<GLint> free_layers; // popped from the back
+    };
+
+    static auto same(const Key& a, const Key& b) -> bool;
+
+    auto add(const Key& key, const std::vector<Level>& levels, Handle& handle)
+        -> bool;
+
+    // a new array for `key` with all of its layers free, returns its index
+    auto create(const Key& key, const std::vector<Level>& levels) -> unsigned;
+
+    GLsizei layers_per_array;
+    std::vector<Array> array_list;
+};
+
+#endif // SRC_TEXTURE_ARRAYS_HPP_
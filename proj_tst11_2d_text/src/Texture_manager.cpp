@@ -0,0 +1,682 @@
+#include "Texture_manager.hpp"
+
+#include "gl_loader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include "assets.hpp"
+#include "dds.hpp"
+#include "logs.hpp"
+#include "mipmaps.hpp"
+#include "png.hpp"
+#include "tutorial_libs/texture.hpp"
+
+#include "gl_intercept.hpp"
+
+namespace {
+    auto has_extension(const std::string& path, const char* ext) -> bool
+    {
+        const std::string::size_type dot {path.rfind('.')};
+        return dot != std::string::npos
+            && path.compare(dot, std::string::npos, ext) == 0;
+    }
+
+    // where the surfaces of a batch go in the PBO
+    struct Copy {
+        unsigned char* to;
+        const unsigned char* from;
+        size_t size;
+    };
+
+    // keeps the offsets of the PBO uploads aligned for every format
+    constexpr size_t pbo_alignment {16};
+
+    // PBOs in flight: the one being filled, the one the GPU reads and a spare
+    constexpr unsigned pbo_count {3};
+
+#ifdef DEBUG
+    // only the debug log reports timings
+    auto ms_since(std::chrono::steady_clock::time_point start) -> double
+    {
+        return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+#endif
+} // namespace
+
+Texture_manager::Texture_manager(
+    Thread_pool& pool, size_t upload_budget, size_t vram_budget)
+: pool{pool}
+, upload_budget{upload_budget}
+, vram_budget{vram_budget}
+, vram_used{0}
+, frame{1}
+, pbos{pbo_count, upload_budget}
+, placeholder{0}
+, textures{}
+, batch{}
+{
+    // magenta and black, hard to mistake for a real texture
+    constexpr unsigned char checker[] {
+        255, 0, 255, 255,   0, 0, 0, 255,
+        0, 0, 0, 255,       255, 0, 255, 255};
+
+    glGenTextures(1, &this->placeholder);
+    glBindTexture(GL_TEXTURE_2D, this->placeholder);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(
+        GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+        checker);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+Texture_manager::~Texture_manager()
+{
+    // the worker may still be writing into the PBO
+    if (this->batch) {
+        this->batch->copied.wait();
+    }
+    // workers still reading only touch their own copy of the path
+    for (const Texture& tex : this->textures) {
+        if (tex.name != 0) {
+            glDeleteTextures(1, &tex.name);
+        }
+    }
+    glDeleteTextures(1, &this->placeholder);
+}
+
+auto Texture_manager::load(
+    const std::string& path, const mipmaps::Options& mipmaps) -> Handle
+{
+    for (unsigned id {0}; id < this->textures.size(); ++id) {
+        if (this->textures[id].path == path) {
+            return Handle{id};
+        }
+    }
+
+    DBG(2, "loading texture ", path);
+    return this->start(
+        path,
+        this->pool.submit([path, mipmaps] { return read(path, mipmaps); }));
+}
+
+auto Texture_manager::add(
+    const std::string& name, unsigned width, unsigned height,
+    std::vector<unsigned char> rgba, const mipmaps::Options& mipmaps) -> Handle
+{
+    for (unsigned id {0}; id < this->textures.size(); ++id) {
+        if (this->textures[id].path == name) {
+            return Handle{id};
+        }
+    }
+
+    DBG(2, "adding texture ", name);
+    return this->start(
+        name,
+        this->pool.submit(
+            [width, height, pixels = std::move(rgba), mipmaps]() mutable {
+                Image image {};
+                image.target = GL_TEXTURE_2D;
+                image.pixels = std::move(pixels);
+                image.internal_format = GL_RGBA8;
+                add_mipmaps(image, width, height, mipmaps);
+                image.ok = true;
+                return image;
+            }));
+}
+
+auto Texture_manager::start(const std::string& path, std::future<Image> reading)
+    -> Handle
+{
+    this->textures.push_back(Texture{
+        .path = path,
+        .state = State::reading,
+        .reading = std::move(reading),
+        .image = {},
+        .name = 0,
+        .next_surface = 0,
+        .surfaces_done = 0,
+        .bytes = 0,
+        .frames = 0,
+        .requested = Clock::now(),
+        .streamed = false,
+        .screen_size = std::numeric_limits<float>::infinity(),
+        .last_used = 0,
+    });
+    return Handle{static_cast<unsigned>(this->textures.size() - 1)};
+}
+
+auto Texture_manager::update() -> void
+{
+    ++this->frame;
+    this->collect(false);
+    for (Texture& tex : this->textures) {
+        if (tex.state == State::reading || tex.state == State::uploading) {
+            ++tex.frames;
+        }
+    }
+
+    size_t uploaded {0};
+    if (this->batch) {
+        // the copy of the last frame's batch is not done, wait for it rather
+        // than stage around it
+        if (this->batch->copied.wait_for(std::chrono::seconds(0))
+            != std::future_status::ready) {
+            return;
+        }
+        uploaded = this->upload_batch();
+    }
+    this->stage(uploaded);
+}
+
+auto Texture_manager::finish() -> void
+{
+    this->collect(true);
+    if (this->batch) {
+        this->batch->copied.wait();
+        this->upload_batch();
+    }
+    for (unsigned id {0}; id < this->textures.size(); ++id) {
+        Texture& tex {this->textures[id]};
+        while (wants_upload(tex)) {
+            const Surface& surface {tex.image.surfaces[tex.next_surface]};
+            if (tex.streamed && tex.next_surface > 0
+                && !this->make_room(static_cast<size_t>(surface.size), id)) {
+                break;
+            }
+            this->upload_surface(tex, tex.next_surface, surface.data);
+            ++tex.next_surface;
+        }
+    }
+}
+
+auto Texture_manager::texture(Handle handle) const -> GLuint
+{
+    const Texture& tex {this->textures[handle.id]};
+    if (tex.state == State::resident) {
+        return tex.name;
+    }
+    return this->target(handle) == GL_TEXTURE_2D ? this->placeholder : 0;
+}
+
+auto Texture_manager::use(Handle handle, float screen_size) -> void
+{
+    Texture& tex {this->textures[handle.id]};
+    if (tex.last_used != this->frame) {
+        tex.last_used = this->frame;
+        tex.screen_size = screen_size;
+    } else {
+        tex.screen_size = std::max(tex.screen_size, screen_size);
+    }
+}
+
+auto Texture_manager::target(Handle handle) const -> GLenum
+{
+    const Texture& tex {this->textures[handle.id]};
+    return tex.state == State::reading ? GL_TEXTURE_2D : tex.image.target;
+}
+
+auto Texture_manager::is_resident(Handle handle) const -> bool
+{
+    return this->textures[handle.id].state == State::resident;
+}
+
+auto Texture_manager::pending() const -> size_t
+{
+    return static_cast<size_t>(std::count_if(
+        this->textures.begin(), this->textures.end(), [](const Texture& tex) {
+            return tex.state == State::reading || wants_upload(tex);
+        }));
+}
+
+auto Texture_manager::vram() const -> size_t
+{
+    return this->vram_used;
+}
+
+auto Texture_manager::read(
+    const std::string& path, const mipmaps::Options& mipmaps) -> Image
+{
+    Image image {};
+    image.target = GL_TEXTURE_2D;
+
+    if (has_extension(path, ".dds")) {
+        std::string_view file;
+        dds::Image dds;
+        if (!assets::get(path, file)) {
+            logs::err("could not read ", path);
+            return image;
+        }
+        if (!dds::parse(path, file, dds)) {
+            return image;
+        }
+        image.target = dds.target;
+        image.compressed = dds.format.block_bytes != 0;
+        image.internal_format = dds.format.internal_format;
+        image.format = dds.format.format;
+        image.type = dds.format.type;
+        image.unpack_alignment = 1;
+        image.levels = static_cast<GLint>(dds.levels);
+        image.layers = static_cast<GLsizei>(dds.layers);
+        for (const dds::Surface& surface : dds.surfaces) {
+            image.surfaces.push_back(Surface{
+                .level = static_cast<GLint>(surface.level),
+                .layer = static_cast<GLint>(surface.layer),
+                .width = static_cast<GLsizei>(surface.width),
+                .height = static_cast<GLsizei>(surface.height),
+                .data = surface.data,
+                .size = static_cast<GLsizei>(surface.size),
+            });
+        }
+    } else if (has_extension(path, ".png")) {
+        // decoded here, on the worker, straight into the image's own memory,
+        // so the textures of a batch of load() calls decode in parallel
+        std::string_view file;
+        png::Info info;
+        if (!assets::get(path, file)) {
+            logs::err("could not read ", path);
+            return image;
+        }
+        if (!png::info(path, file, info)) {
+            return image;
+        }
+        image.pixels.resize(size_t{info.width} * info.height * 4);
+        if (!png::decode(
+                path, file, image.pixels.data(), image.pixels.size())) {
+            return image;
+        }
+        image.internal_format = GL_RGBA8;
+        add_mipmaps(image, info.width, info.height, mipmaps);
+    } else if (has_extension(path, ".bmp")) {
+        BMPImage bmp;
+        if (!parseBMP(path.c_str(), bmp)) {
+            return image;
+        }
+        image.pixels.resize(size_t{bmp.width} * bmp.height * 4);
+        rgbaBMP(bmp, image.pixels.data());
+        image.internal_format = GL_RGB8;
+        add_mipmaps(image, bmp.width, bmp.height, mipmaps);
+    } else {
+        logs::err("unknown texture format: ", path);
+        return image;
+    }
+
+    image.ok = true;
+    return image;
+}
+
+auto Texture_manager::add_mipmaps(
+    Image& image, unsigned width, unsigned height,
+    const mipmaps::Options& mipmaps) -> void
+{
+    const std::vector<mipmaps::Level> levels {
+        mipmaps::generate(image.pixels, width, height, mipmaps)};
+    image.format = GL_RGBA;
+    image.type = GL_UNSIGNED_BYTE;
+    image.unpack_alignment = 4;
+    image.trilinear = true;
+    image.levels = static_cast<GLint>(levels.size());
+    image.layers = 1;
+    // the buffer is final, the pointers stay valid
+    for (size_t i {0}; i < levels.size(); ++i) {
+        const size_t next {
+            i + 1 < levels.size() ? levels[i + 1].offset : image.pixels.size()};
+        image.surfaces.push_back(Surface{
+            .level = static_cast<GLint>(i),
+            .layer = 0,
+            .width = static_cast<GLsizei>(levels[i].width),
+            .height = static_cast<GLsizei>(levels[i].height),
+            .data = image.pixels.data() + levels[i].offset,
+            .size = static_cast<GLsizei>(next - levels[i].offset),
+        });
+    }
+}
+
+auto Texture_manager::collect(bool wait) -> void
+{
+    for (Texture& tex : this->textures) {
+        if (tex.state != State::reading) {
+            continue;
+        }
+        if (!wait
+            && tex.reading.wait_for(std::chrono::seconds(0))
+                != std::future_status::ready) {
+            continue;
+        }
+        tex.image = tex.reading.get();
+        if (!tex.image.ok) {
+            logs::err("could not load texture ", tex.path);
+            tex.state = State::failed;
+            continue;
+        }
+        if (!dds::supported(tex.image.target, tex.image.internal_format)) {
+            logs::err(
+                "texture ", tex.path, ": format not supported by the context");
+            tex.state = State::failed;
+            continue;
+        }
+        this->create(tex);
+        tex.state = State::uploading;
+    }
+}
+
+auto Texture_manager::create(Texture& tex) -> void
+{
+    const Image& image {tex.image};
+    glGenTextures(1, &tex.name);
+    glBindTexture(image.target, tex.name);
+    // complete with the mipmaps the image has, a file may stop short of 1x1
+    glTexParameteri(image.target, GL_TEXTURE_MAX_LEVEL, image.levels - 1);
+    if (image.target == GL_TEXTURE_2D && image.levels > 1) {
+        // smallest first, see upload_surface()
+        tex.streamed = true;
+        std::reverse(tex.image.surfaces.begin(), tex.image.surfaces.end());
+        return;
+    }
+    if (image.target != GL_TEXTURE_2D_ARRAY
+        && image.target != GL_TEXTURE_CUBE_MAP_ARRAY) {
+        return;
+    }
+
+    // the layers of a mipmap are not next to each other in the file, so every
+    // mipmap is allocated for all layers here and filled one layer at a time
+    for (const Surface& surface : image.surfaces) {
+        if (surface.layer != 0) {
+            break;
+        }
+        if (image.compressed) {
+            glCompressedTexImage3D(
+                image.target, surface.level, image.internal_format,
+                surface.width, surface.height, image.layers, 0,
+                surface.size * image.layers, nullptr);
+        } else {
+            glTexImage3D(
+                image.target, surface.level,
+                static_cast<GLint>(image.internal_format),
+                surface.width, surface.height, image.layers, 0,
+                image.format, image.type, nullptr);
+        }
+    }
+}
+
+auto Texture_manager::stage(size_t uploaded) -> void
+{
+    const bool use_pbos {this->pbos.usable()};
+    Batch next {};
+    std::vector<Copy> copies;
+    size_t staged {0};
+    // bytes in the PBO so far, in VRAM only once the batch is uploaded next
+    // frame, so not in vram_used yet
+    size_t pending {0};
+    bool full {false};
+
+    // the first surface of every texture (the smallest mipmap of a streamed
+    // one) before the rest of any, so they all become usable early
+    for (int pass {0}; pass < 2 && !full; ++pass) {
+        for (unsigned id {0}; id < this->textures.size() && !full; ++id) {
+            Texture& tex {this->textures[id]};
+            while (wants_upload(tex) && (pass == 1 || tex.next_surface == 0)) {
+                const Surface& surface {tex.image.surfaces[tex.next_surface]};
+                const auto size {static_cast<size_t>(surface.size)};
+                const size_t at {
+                    (staged + pbo_alignment - 1) & ~(pbo_alignment - 1)};
+                const size_t spent {uploaded + staged};
+                // at least one mipmap per frame, however big
+                if (spent > 0 && spent + size > this->upload_budget) {
+                    full = true;
+                    break;
+                }
+                if (tex.streamed && tex.next_surface > 0
+                    && !this->make_room(pending + size, id)) {
+                    break;
+                }
+
+                if (use_pbos && at + size <= this->pbos.buffer_size()) {
+                    copies.push_back(Copy{nullptr, surface.data, size});
+                    next.entries.push_back(
+                        Batch::Entry{id, tex.next_surface, at});
+                    staged = at + size;
+                    pending += size;
+                } else if (use_pbos && size <= this->pbos.buffer_size()) {
+                    full = true; // next frame's PBO
+                    break;
+                } else {
+                    uploaded += this->upload_surface(
+                        tex, tex.next_surface, surface.data);
+                }
+                ++tex.next_surface;
+            }
+        }
+    }
+    if (copies.empty()) {
+        return;
+    }
+
+    if (!this->pbos.acquire(staged, next.staging)) {
+        // all PBOs still in flight, the same surfaces are up again next frame
+        for (auto it {next.entries.rbegin()}; it != next.entries.rend(); ++it) {
+            this->textures[it->texture].next_surface = it->surface;
+        }
+        return;
+    }
+    for (size_t i {0}; i < copies.size(); ++i) {
+        copies[i].to = next.staging.data + next.entries[i].offset;
+    }
+    next.copied = this->pool.submit([copies] {
+        for (const Copy& copy : copies) {
+            std::memcpy(copy.to, copy.from, copy.size);
+        }
+    });
+    this->batch = std::move(next);
+}
+
+auto Texture_manager::upload_batch() -> size_t
+{
+    this->batch->copied.get();
+    this->pbos.bind(this->batch->staging);
+    size_t bytes {0};
+    for (const Batch::Entry& entry : this->batch->entries) {
+        bytes += this->upload_surface(
+            this->textures[entry.texture], entry.surface,
+            Pbo_pool::offset(entry.offset));
+    }
+    this->pbos.release(this->batch->staging);
+    this->batch.reset();
+    return bytes;
+}
+
+auto Texture_manager::upload_surface(
+    Texture& tex, size_t index, const void* pixels) -> size_t
+{
+    const Image& image {tex.image};
+    const Surface& surface {image.surfaces[index]};
+    const auto size {static_cast<size_t>(surface.size)};
+
+    glBindTexture(image.target, tex.name);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, image.unpack_alignment);
+    if (image.target == GL_TEXTURE_2D_ARRAY
+        || image.target == GL_TEXTURE_CUBE_MAP_ARRAY) {
+        // allocated by create()
+        if (image.compressed) {
+            glCompressedTexSubImage3D(
+                image.target, surface.level, 0, 0, surface.layer,
+                surface.width, surface.height, 1, image.internal_format,
+                surface.size, pixels);
+        } else {
+            glTexSubImage3D(
+                image.target, surface.level, 0, 0, surface.layer,
+                surface.width, surface.height, 1, image.format, image.type,
+                pixels);
+        }
+    } else {
+        const auto face {static_cast<GLenum>(surface.layer)};
+        const GLenum target {image.target == GL_TEXTURE_CUBE_MAP
+            ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face
+            : GL_TEXTURE_2D};
+        if (image.compressed) {
+            glCompressedTexImage2D(
+                target, surface.level, image.internal_format,
+                surface.width, surface.height, 0, surface.size, pixels);
+        } else {
+            glTexImage2D(
+                target, surface.level,
+                static_cast<GLint>(image.internal_format),
+                surface.width, surface.height, 0, image.format, image.type,
+                pixels);
+        }
+    }
+    ++tex.surfaces_done;
+    tex.bytes += size;
+    this->vram_used += size;
+
+    // a streamed texture is complete from the mipmap just uploaded down, the
+    // levels above it are not defined (yet, or any more)
+    if (tex.streamed) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, surface.level);
+    }
+    const bool complete {tex.surfaces_done == image.surfaces.size()};
+    if (tex.state == State::uploading && (tex.streamed || complete)) {
+        if (image.trilinear) {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(
+                GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        }
+        tex.state = State::resident;
+        DBG(2, "texture ", tex.path, " usable after ", tex.frames,
+            " frames, ", ms_since(tex.requested), "ms after load()");
+    }
+    if (complete) {
+        DBG(1, "texture ", tex.path, " resident: ", tex.bytes, " bytes over ",
+            tex.frames, " frames, ", ms_since(tex.requested),
+            "ms after load()");
+        // the data is not needed any more, unless evicted mipmaps come back
+        if (!tex.streamed) {
+            tex.image.surfaces.clear();
+            tex.image.pixels = {};
+        }
+    }
+    return size;
+}
+
+auto Texture_manager::wanted_level(const Texture& tex) -> GLint
+{
+    // the smallest mipmap at least as big as the texture on screen
+    const Surface& biggest {tex.image.surfaces.back()};
+    auto size {static_cast<float>(std::max(biggest.width, biggest.height))};
+    GLint level {0};
+    while (level + 1 < tex.image.levels && size / 2.0f >= tex.screen_size) {
+        size /= 2.0f;
+        ++level;
+    }
+    return level;
+}
+
+auto Texture_manager::wants_upload(const Texture& tex) -> bool
+{
+    if (!(tex.state == State::uploading
+          || (tex.state == State::resident && tex.streamed))
+        || tex.next_surface >= tex.image.surfaces.size()) {
+        return false;
+    }
+    // a streamed texture always gets its smallest mipmap
+    return !tex.streamed || tex.next_surface == 0
+        || tex.image.surfaces[tex.next_surface].level >= wanted_level(tex);
+}
+
+auto Texture_manager::make_room(size_t bytes, unsigned keep) -> bool
+{
+    if (this->vram_used + bytes <= this->vram_budget) {
+        return true;
+    }
+
+    // evict nothing when all that could go is not enough
+    std::vector<unsigned> candidates;
+    size_t freeable {0};
+    for (unsigned id {0}; id < this->textures.size(); ++id) {
+        if (id != keep) {
+            const size_t bytes {this->evictable_bytes(this->textures[id])};
+            if (bytes > 0) {
+                candidates.push_back(id);
+                freeable += bytes;
+            }
+        }
+    }
+    if (this->vram_used - freeable + bytes > this->vram_budget) {
+        return false;
+    }
+    std::sort(
+        candidates.begin(), candidates.end(), [&](unsigned a, unsigned b) {
+            return this->textures[a].last_used < this->textures[b].last_used;
+        });
+    for (unsigned id : candidates) {
+        Texture& tex {this->textures[id]};
+        while (this->vram_used + bytes > this->vram_budget
+               && this->evictable_bytes(tex) > 0) {
+            this->evict(tex);
+        }
+        if (this->vram_used + bytes <= this->vram_budget) {
+            return true;
+        }
+    }
+    return false;
+}
+
+auto Texture_manager::evictable_bytes(const Texture& tex) const -> size_t
+{
+    // with nothing of it staged, all but the smallest mipmap, or the ones
+    // above its screen size if it was drawn (use() comes after update() in a
+    // frame, so the last frame's count too)
+    if (!tex.streamed || tex.state != State::resident
+        || tex.next_surface != tex.surfaces_done) {
+        return 0;
+    }
+    const bool used {tex.last_used != 0 && tex.last_used + 1 >= this->frame};
+    const GLint keep {used ? wanted_level(tex) : tex.image.levels - 1};
+    size_t bytes {0};
+    for (size_t i {tex.surfaces_done}; i > 1; --i) {
+        const Surface& surface {tex.image.surfaces[i - 1]};
+        if (surface.level >= keep) {
+            break;
+        }
+        bytes += static_cast<size_t>(surface.size);
+    }
+    return bytes;
+}
+
+auto Texture_manager::evict(Texture& tex) -> void
+{
+    const Image& image {tex.image};
+    const Surface& top {image.surfaces[tex.surfaces_done - 1]};
+    const auto size {static_cast<size_t>(top.size)};
+
+    // a 0x0 image frees the mipmap, the texture starts at the next one
+    glBindTexture(GL_TEXTURE_2D, tex.name);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, top.level + 1);
+    if (image.compressed) {
+        glCompressedTexImage2D(
+            GL_TEXTURE_2D, top.level, image.internal_format, 0, 0, 0, 0,
+            nullptr);
+    } else {
+        glTexImage2D(
+            GL_TEXTURE_2D, top.level,
+            static_cast<GLint>(image.internal_format), 0, 0, 0,
+            image.format, image.type, nullptr);
+    }
+    --tex.surfaces_done;
+    --tex.next_surface;
+    tex.bytes -= size;
+    this->vram_used -= size;
+    // not drawn lately, only use() brings the mipmap back
+    if (tex.last_used + 1 < this->frame) {
+        tex.screen_size = 0.0f;
+    }
+    DBG(2, "texture ", tex.path, ": evicted mipmap ", top.level, ", ",
+        this->vram_used, " bytes in VRAM");
+}
@@ -0,0 +1,243 @@
+#ifndef SRC_TEXTURE_MANAGER_HPP_
+#define SRC_TEXTURE_MANAGER_HPP_
+
+/*******************************************************************************
+ * Textures loaded in the background.
+ *
+ * load() returns right away: a worker of the thread pool reads and parses the
+ * file (.dds, see dds.hpp, .png, see png.hpp, or .bmp), then update() uploads
+ * it on the context thread one mipmap (of one layer or cubemap face) at a
+ * time, at most `upload_budget` bytes per call (but always at least one
+ * mipmap, so everything gets in eventually). A .png is decoded by the worker
+ * too, so the sources load without cooking them first (rows top to bottom,
+ * like a .dds). The worker also makes the mipmaps of a .png or .bmp, with the
+ * options given to load() (see mipmaps.hpp), so the context thread never
+ * runs glGenerateMipmap(). Loading a batch of textures is spread over
+ * several frames instead of stalling one of them.
+ *
+ * The mipmaps of a frame are copied into a pixel buffer object by a worker
+ * (see Pbo_pool.hpp) and uploaded from there on the next update(), so the
+ * driver neither copies nor waits on the context thread. Mipmaps too big for
+ * a PBO, and all of them while a GL capture records, go from client memory.
+ *
+ * Until all of its mipmaps are in, texture() gives a small checkerboard
+ * placeholder, so call update() once per frame and look the texture up every
+ * frame, the name changes when it becomes resident. The placeholder is a 2D
+ * texture, arrays and cubemaps give 0 until they are resident (target() says
+ * which kind a texture is). finish() uploads everything at once, for loading
+ * screens. A texture that fails to load, or whose format the context can not
+ * do, keeps the placeholder (the error is logged).
+ *
+ * A 2D texture with mipmaps is streamed smallest mipmap first: it is usable
+ * (texture() gives it, GL_TEXTURE_BASE_LEVEL at the biggest mipmap in) as
+ * soon as its smallest mipmap is, every texture gets that far before any
+ * gets more, and it sharpens over the next frames. use() says how big it is
+ * on screen, only the mipmaps down to that size are streamed (without a
+ * use() all of them). Once the uploads pass `vram_budget` bytes, the biggest
+ * mipmaps of the least recently used textures are freed to make room (never
+ * the smallest, and not the ones a texture used in the last frame needs),
+ * such a texture only gets them back through use(). Arrays, cubemaps and
+ * textures without mipmaps are uploaded whole and never evicted.
+ *
+ * add() does the same for RGBA pixels made at runtime, such as the pages of an
+ * Atlas, under a name of the caller's choosing.
+ *
+ * Loading the same path (or adding the same name) again gives back the same
+ * handle. The textures belong to the manager and are deleted with it.
+ ******************************************************************************/
+
+#include "gl_loader.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Pbo_pool.hpp"
+#include "Thread_pool.hpp"
+#include "mipmaps.hpp"
+
+class Texture_manager final {
+ public:
+    struct Handle {
+        unsigned id;
+    };
+
+    // a 1024x1024 DXT5 texture with its mipmaps in about two frames
+    static constexpr size_t default_upload_budget {1u << 20};
+    static constexpr size_t default_vram_budget {256u << 20};
+
+    explicit Texture_manager(
+        Thread_pool& pool, size_t upload_budget = default_upload_budget,
+        size_t vram_budget = default_vram_budget);
+    ~Texture_manager();
+    Texture_manager(const Texture_manager&) = delete;
+    auto operator=(const Texture_manager&) -> Texture_manager& = delete;
+
+    // start loading the texture at `path` on a worker, never blocks;
+    // `mipmaps` is how the mipmaps of a .png or .bmp are made (the first
+    // load() of a path decides)
+    auto load(
+        const std::string& path,
+        const mipmaps::Options& mipmaps = mipmaps::defaults) -> Handle;
+
+    // like load(), for `width` x `height` RGBA pixels (rows top to bottom)
+    // instead of a file, `name` takes the place of the path
+    auto add(
+        const std::string& name, unsigned width, unsigned height,
+        std::vector<unsigned char> rgba,
+        const mipmaps::Options& mipmaps = mipmaps::defaults) -> Handle;
+
+    // between frames: upload what the workers finished, within the budget
+    auto update() -> void;
+
+    // wait for the workers and upload everything, ignoring the budget
+    auto finish() -> void;
+
+    // the texture to bind for `handle`, the placeholder until it is resident
+    auto texture(Handle handle) const -> GLuint;
+
+    // `handle` is drawn this frame, at most `screen_size` pixels across (its
+    // larger side, the largest of several calls in a frame): keeps its
+    // mipmaps down to that size in and from being evicted first
+    auto use(Handle handle, float screen_size) -> void;
+
+    // GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP or
+    // GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_2D until the file is read
+    auto target(Handle handle) const -> GLenum;
+
+    auto is_resident(Handle handle) const -> bool;
+
+    // textures still being read or uploaded (up to the size they are used at)
+    auto pending() const -> size_t;
+
+    // bytes uploaded and not evicted
+    auto vram() const -> size_t;
+
+ private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State {
+        reading,
+        uploading,
+        resident,
+        failed
+    };
+
+    // one mipmap of one layer
+    struct Surface {
+        GLint level;
+        GLint layer; // cubemap face, array layer or layer-face
+        GLsizei width;
+        GLsizei height;
+        const unsigned char* data;
+        GLsizei size;
+    };
+
+    // what a worker hands back, the data points into the asset (see assets.hpp)
+    // or, for a .png or .bmp, into `pixels`, the image and its mipmaps
+    struct Image {
+        bool ok;
+        GLenum target;
+        bool compressed;
+        GLenum internal_format;
+        GLenum format; // uncompressed only
+        GLenum type;   // uncompressed only
+        GLint unpack_alignment;
+        bool trilinear; // set repeat and trilinear filtering, as uploadBMP()
+        GLint levels;
+        GLsizei layers;
+        std::vector<Surface> surfaces;
+        std::vector<unsigned char> pixels;
+    };
+
+    struct Texture {
+        std::string path;
+        State state;
+        std::future<Image> reading;
+        Image image;
+        GLuint name;
+        size_t next_surface; // next to stage or upload
+        size_t surfaces_done;
+        size_t bytes;
+        unsigned frames; // update() calls it took
+        Clock::time_point requested;
+        bool streamed; // surfaces smallest first, see upload_surface()
+        float screen_size; // of the last use()
+        unsigned last_used; // the frame of the last use(), 0 for never
+    };
+
+    // a frame's surfaces, copied into one PBO by a worker
+    struct Batch {
+        struct Entry {
+            unsigned texture;
+            size_t surface;
+            size_t offset; // in the PBO
+        };
+
+        Pbo_pool::Staging staging;
+        std::vector<Entry> entries;
+        std::future<void> copied;
+    };
+
+    static auto read(const std::string& path, const mipmaps::Options& mipmaps)
+        -> Image;
+
+    // a new texture for the image a worker is making
+    auto start(const std::string& path, std::future<Image> reading) -> Handle;
+
+    // the mipmap a streamed texture needs at its screen size
+    static auto wanted_level(const Texture& tex) -> GLint;
+
+    // whether `tex` has a surface to upload next
+    static auto wants_upload(const Texture& tex) -> bool;
+
+    // evict mipmaps of the least recently used textures, but not of `keep`,
+    // until `bytes` more fit the VRAM budget, false if they can not
+    auto make_room(size_t bytes, unsigned keep) -> bool;
+
+    // what evict() can free of `tex` now, biggest mipmap first
+    auto evictable_bytes(const Texture& tex) const -> size_t;
+
+    // free the biggest mipmap of a streamed texture
+    auto evict(Texture& tex) -> void;
+
+    // the mipmap chain of the RGBA `image.pixels` as its surfaces
+    static auto add_mipmaps(
+        Image& image, unsigned width, unsigned height,
+        const mipmaps::Options& mipmaps) -> void;
+
+    // take over the images the workers are done with
+    auto collect(bool wait) -> void;
+
+    // name the texture of a new image, arrays also get their storage, which
+    // has to happen while no PBO is bound
+    auto create(Texture& tex) -> void;
+
+    // pick the next mipmaps within the budget, `uploaded` bytes are spent
+    // already: start copying them into a PBO, the ones that do not fit go
+    // from client memory right away
+    auto stage(size_t uploaded) -> void;
+
+    // upload the mipmaps copied into the PBO, returns their size
+    auto upload_batch() -> size_t;
+
+    // upload surface `index` of `tex` from `pixels` (client memory or an
+    // offset into the bound PBO), returns its size
+    auto upload_surface(Texture& tex, size_t index, const void* pixels)
+        -> size_t;
+
+    Thread_pool& pool;
+    size_t upload_budget;
+    size_t vram_budget;
+    size_t vram_used;
+    unsigned frame; // update() calls, from 1
+    Pbo_pool pbos;
+    GLuint placeholder;
+    std::vector<Texture> textures;
+    std::optional<Batch> batch;
+};
+
+#endif // SRC_TEXTURE_MANAGER_HPP_
@@ -0,0 +1,67 @@
+#include "Thread_pool.hpp"
+
+#include <algorithm>
+
+#include "logs.hpp"
+
+Thread_pool::Thread_pool(unsigned threads)
+: mutex{}
+, wake{}
+, jobs{}
+, stopping{false}
+, threads{}
+{
+    if (threads == 0) {
+        // hardware_concurrency() may not know and say 0
+        threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    for (unsigned i {0}; i < threads; ++i) {
+        this->threads.emplace_back(&Thread_pool::run, this);
+    }
+    DBG(1, "thread pool: ", threads, " workers");
+}
+
+Thread_pool::~Thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (std::thread& thread : this->threads) {
+        thread.join();
+    }
+}
+
+auto Thread_pool::size() const -> unsigned
+{
+    return static_cast<unsigned>(this->threads.size());
+}
+
+auto Thread_pool::push(std::function<void()> job) -> void
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->jobs.push_back(std::move(job));
+    }
+    this->wake.notify_one();
+}
+
+auto Thread_pool::run() -> void
+{
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->wake.wait(lock, [this] {
+                return this->stopping || !this->jobs.empty();
+            });
+            if (this->jobs.empty()) {
+                return; // stopping and nothing left
+            }
+            job = std::move(this->jobs.front());
+            this->jobs.pop_front();
+        }
+        job();
+    }
+}
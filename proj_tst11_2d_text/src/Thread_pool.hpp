@@ -0,0 +1,62 @@
+#ifndef SRC_THREAD_POOL_HPP_
+#define SRC_THREAD_POOL_HPP_
+
+/*******************************************************************************
+ * Fixed set of worker threads taking jobs from one queue.
+ *
+ * Meant for CPU-only work (file reads, parsing, preprocessing), no GL context
+ * is current on the workers. submit() returns a future for the job's result;
+ * the destructor lets the queued jobs finish before joining.
+ *
+ *     Thread_pool pool;
+ *     auto sources {pool.submit([] { return read_sources(); })};
+ *     ... other work ...
+ *     use(sources.get());
+ ******************************************************************************/
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class Thread_pool final {
+ public:
+    // 0 threads: one per hardware thread, minus the caller's
+    explicit Thread_pool(unsigned threads = 0);
+    ~Thread_pool();
+    Thread_pool(const Thread_pool&) = delete;
+    auto operator=(const Thread_pool&) -> Thread_pool& = delete;
+
+    template<typename F>
+    auto submit(F job) -> std::future<std::invoke_result_t<F>>
+    {
+        using Result = std::invoke_result_t<F>;
+        // std::function needs a copyable callable, packaged_task is not
+        auto task {
+            std::make_shared<std::packaged_task<Result()>>(std::move(job))};
+        std::future<Result> result {task->get_future()};
+        this->push([task] { (*task)(); });
+        return result;
+    }
+
+    auto size() const -> unsigned;
+
+ private:
+    auto push(std::function<void()> job) -> void;
+    auto run() -> void;
+
+    std::mutex mutex; // guards jobs and stopping
+    std::condition_variable wake;
+    std::deque<std::function<void()>> jobs;
+    bool stopping;
+
+    std::vector<std::thread> threads;
+};
+
+#endif // SRC_THREAD_POOL_HPP_
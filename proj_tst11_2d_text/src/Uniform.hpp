@@ -0,0 +1,107 @@
+#ifndef SRC_UNIFORM_HPP_
+#define SRC_UNIFORM_HPP_
+
+/*******************************************************************************
+ * Typed handle to a uniform of one program.
+ *
+ * The location is taken from the program's reflection when the handle is
+ * bound, together with a check that the GLSL type matches `T` (a `T` without
+ * a gl_reflect::Type_of does not compile at all). set() remembers the value it
+ * uploaded last and skips the glUniform call if it did not change, so setting
+ * everything every frame costs nothing for the values that stay the same.
+ *
+ * Like glUniform*, set() affects the program currently in use. The remembered
+ * value is only valid as long as nobody else sets the uniform.
+ *
+ *     Uniform<glm::mat4> mvp(gl_reflect::reflect(program), "MVP");
+ *     glUseProgram(program);
+ *     mvp.set(projection * view * model);
+ ******************************************************************************/
+
+#include "gl_loader.hpp"
+
+#include <string>
+#include <utility>
+
+#include "gl_reflect.hpp"
+#include "logs.hpp"
+
+// the part that does not depend on the type, lets Shader_manager re-bind
+// handles of any type after a program is reloaded
+class Uniform_base {
+ public:
+    virtual ~Uniform_base() = default;
+
+    // look the uniform up again, forgets the remembered value
+    virtual auto bind(const gl_reflect::Program_info& info) -> bool = 0;
+};
+
+template<typename T>
+class Uniform final : public Uniform_base {
+ public:
+    static constexpr GLenum gl_type {gl_reflect::Type_of<T>::type};
+
+    Uniform()
+    : name{}
+    , loc{-1}
+    , has_value{false}
+    , value{}
+    {}
+
+    Uniform(const gl_reflect::Program_info& info, std::string name)
+    : name{std::move(name)}
+    , loc{-1}
+    , has_value{false}
+    , value{}
+    {
+        this->bind(info);
+    }
+
+    auto bind(const gl_reflect::Program_info& info) -> bool override
+    {
+        this->loc = -1;
+        this->has_value = false;
+
+        const gl_reflect::Variable* var {info.uniform(this->name)};
+        if (var == nullptr) {
+            logs::err(
+                "uniform '", this->name, "' not found in program ",
+                info.program);
+            return false;
+        }
+        if (!gl_reflect::compatible(gl_type, var->type)) {
+            logs::err(
+                "uniform '", this->name, "' is a ",
+                gl_reflect::type_name(var->type), ", not a ",
+                gl_reflect::type_name(gl_type));
+            return false;
+        }
+
+        this->loc = var->location;
+        return true;
+    }
+
+    auto set(const T& new_value) -> void
+    {
+        if (this->loc == -1 || (this->has_value && this->value == new_value)) {
+            return;
+        }
+        gl_reflect::upload(this->loc, new_value);
+        this->value = new_value;
+        this->has_value = true;
+    }
+
+    // -1 if the uniform was not found or has the wrong type
+    auto location() const -> GLint
+    {
+        return this->loc;
+    }
+
+ private:
+    std::string name;
+    GLint loc;
+    bool has_value;
+    T value; // last uploaded
+};
+
+#endif // SRC_UNIFORM_HPP_
@@ -0,0 +1,43 @@
+#ifndef SRC_ASSET_PACK_FORMAT_HPP_
+#define SRC_ASSET_PACK_FORMAT_HPP_
+
+/*******************************************************************************
+ * On-disk layout of an asset pack, shared by the reader (Asset_pack.hpp) and
+ * the builder (tools/pack_assets.cpp).
+ *
+ * A pack is a File_header, the table of contents (`count` Entries sorted by
+ * name, so it can be binary searched in place), the names and then the file
+ * contents. Every part starts on a multiple of `alignment`, so once the pack is
+ * mapped the table can be used as it is and file contents can be handed to the
+ * driver straight from the mapping. Everything is in host byte order.
+ ******************************************************************************/
+
+#include <cstdint>
+
+namespace asset_pack {
+    constexpr char file_magic[8] {'A', 'S', 'S', 'E', 'T', 'P', 'K', '\0'};
+    constexpr uint32_t file_version {1};
+    constexpr uint64_t alignment {64}; // a cache line, more than any upload needs
+
+    struct File_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t count; // files in the pack
+        uint64_t toc_offset; // from the start of the file
+        uint64_t size; // of the whole file, catches truncated packs
+    };
+
+    struct Entry {
+        uint64_t offset; // of the contents, from the start of the file
+        uint64_t size;
+        uint64_t name_offset; // of the name, not null terminated
+        uint64_t name_size;
+    };
+
+    constexpr auto align(uint64_t offset) -> uint64_t
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+} // namespace asset_pack
+
+#endif // SRC_ASSET_PACK_FORMAT_HPP_
@@ -0,0 +1,100 @@
+#include "assets.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "Asset_pack.hpp"
+#include "logs.hpp"
+
+namespace {
+    bool disk_first {false};
+    std::unique_ptr<Asset_pack> pack;
+
+    // contents of files read from disk, by path
+    std::mutex disk_mutex; // get() may be called from worker threads
+    std::unordered_map<std::string, std::string> disk_files;
+
+    auto find(const std::string& path) -> const assets::Embedded*
+    {
+        const assets::Embedded* begin {assets::embedded};
+        const assets::Embedded* end {begin + assets::embedded_count};
+        const auto it {std::lower_bound(
+            begin, end, path,
+            [](const assets::Embedded& e, const std::string& p) {
+                return strcmp(e.path, p.c_str()) < 0;
+            })};
+        return it != end && path == it->path ? it : nullptr;
+    }
+
+    // one read straight into the string that is kept
+    auto read(const std::string& path, std::string_view& data) -> bool
+    {
+        std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            return false;
+        }
+        const std::streamsize size {file.tellg()};
+        std::string contents(size > 0 ? static_cast<size_t>(size) : 0, '\0');
+        file.seekg(0);
+        file.read(contents.data(), size);
+        if (!file) {
+            logs::err("could not read ", path);
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(disk_mutex);
+        std::string& kept {disk_files[path]};
+        kept = std::move(contents);
+        data = kept;
+        DBG(2, "asset read from disk: ", path, " (", size, " bytes)");
+        return true;
+    }
+} // namespace
+
+namespace assets {
+    auto mount(const std::string& path) -> bool
+    {
+        auto mounted {std::make_unique<Asset_pack>(path)};
+        if (!mounted->is_open()) {
+            return false;
+        }
+        pack = std::move(mounted);
+        return true;
+    }
+
+    auto prefer_disk(bool prefer) -> void
+    {
+        disk_first = prefer;
+    }
+
+    auto get(const std::string& path, std::string_view& data) -> bool
+    {
+        // the same spelling the table was generated with
+        const std::string name {
+            std::filesystem::path(path).lexically_normal().generic_string()};
+
+        if (disk_first && read(name, data)) {
+            return true;
+        }
+        if (pack && pack->find(name, data)) {
+            return true;
+        }
+
+        const Embedded* file {find(name)};
+        if (file == nullptr) {
+            return !disk_first && read(name, data);
+        }
+
+        data = std::string_view(
+            reinterpret_cast<const char*>(file->data), file->size);
+        return true;
+    }
+} // namespace assets
@@ -0,0 +1,53 @@
+#ifndef SRC_ASSETS_HPP_
+#define SRC_ASSETS_HPP_
+
+/*******************************************************************************
+ * Core assets compiled into the executable.
+ *
+ * The build turns the files listed in EMBED_ASSETS (makefile) into constant
+ * byte arrays (see tools/embed_assets.cpp), shaders are checked with
+ * glslangValidator on the way if it is installed. get() hands them out by
+ * their path in the source tree without touching the disk, so startup does no
+ * file I/O for them and does not depend on the working directory.
+ *
+ * An asset pack (see Asset_pack.hpp) can be mounted on top, its files win
+ * over the embedded ones and are handed out straight from the mapping. Files
+ * found in neither are read from disk as before. After prefer_disk(true) a
+ * file present on disk wins over both, which is how assets are still edited
+ * without a rebuild (`--disk-assets`, implied by `--watch-shaders`).
+ ******************************************************************************/
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace assets {
+    // mounted at startup if it exists (`make pack` builds it)
+    constexpr const char* default_pack {"data.pack"};
+
+    // one embedded file, the generated table is sorted by path
+    struct Embedded {
+        const char* path; // "data/shaders/vertex_simple_shader.glsl"
+        const unsigned char* data;
+        size_t size;
+    };
+
+    // defined in the generated embedded_assets.cpp
+    extern const Embedded embedded[];
+    extern const size_t embedded_count;
+
+    // map the asset pack at `path`, replacing the one mounted before
+    // (invalidating its views), false if it can not be used
+    auto mount(const std::string& path) -> bool;
+
+    // let files on disk override the packed and embedded ones
+    auto prefer_disk(bool prefer) -> void;
+
+    /* contents of the file at `path`, false if it is neither embedded nor
+     * readable, views of files read from disk stay valid until the same path
+     * is read again; safe on any thread, but mount() and prefer_disk() have to
+     * be done before anyone else calls it */
+    auto get(const std::string& path, std::string_view& data) -> bool;
+} // namespace assets
+
+#endif // SRC_ASSETS_HPP_
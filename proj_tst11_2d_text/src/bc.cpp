@@ -0,0 +1,681 @@
+#include "bc.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+    constexpr unsigned pixels {16};
+
+    // per channel minimum and maximum of the block
+    auto bounds(const unsigned char* block, unsigned char lo[4],
+                unsigned char hi[4]) -> void
+    {
+#if defined(__SSE2__)
+        const auto* p {reinterpret_cast<const __m128i*>(block)};
+        const __m128i p0 {_mm_loadu_si128(p)};
+        const __m128i p1 {_mm_loadu_si128(p + 1)};
+        const __m128i p2 {_mm_loadu_si128(p + 2)};
+        const __m128i p3 {_mm_loadu_si128(p + 3)};
+        __m128i min {_mm_min_epu8(_mm_min_epu8(p0, p1), _mm_min_epu8(p2, p3))};
+        __m128i max {_mm_max_epu8(_mm_max_epu8(p0, p1), _mm_max_epu8(p2, p3))};
+        // fold the four pixels of each register into one
+        min = _mm_min_epu8(min, _mm_srli_si128(min, 8));
+        min = _mm_min_epu8(min, _mm_srli_si128(min, 4));
+        max = _mm_max_epu8(max, _mm_srli_si128(max, 8));
+        max = _mm_max_epu8(max, _mm_srli_si128(max, 4));
+        const int min_rgba {_mm_cvtsi128_si32(min)};
+        const int max_rgba {_mm_cvtsi128_si32(max)};
+        std::memcpy(lo, &min_rgba, 4);
+        std::memcpy(hi, &max_rgba, 4);
+#else
+        for (unsigned c {0}; c < 4; ++c) {
+            lo[c] = 255;
+            hi[c] = 0;
+        }
+        for (unsigned i {0}; i < pixels; ++i) {
+            for (unsigned c {0}; c < 4; ++c) {
+                lo[c] = std::min(lo[c], block[4 * i + c]);
+                hi[c] = std::max(hi[c], block[4 * i + c]);
+            }
+        }
+#endif
+    }
+
+    // dot product of every pixel with `axis`
+    auto project(const unsigned char* block, const int axis[4], int dots[16])
+        -> void
+    {
+#if defined(__SSE2__)
+        const __m128i a {_mm_set_epi16(
+            static_cast<short>(axis[3]), static_cast<short>(axis[2]),
+            static_cast<short>(axis[1]), static_cast<short>(axis[0]),
+            static_cast<short>(axis[3]), static_cast<short>(axis[2]),
+            static_cast<short>(axis[1]), static_cast<short>(axis[0]))};
+        const __m128i zero {_mm_setzero_si128()};
+        for (unsigned i {0}; i < 4; ++i) {
+            const __m128i p {_mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(block) + i)};
+            // r*ar + g*ag and b*ab + a*aa of two pixels each
+            const __m128i first {_mm_madd_epi16(_mm_unpacklo_epi8(p, zero), a)};
+            const __m128i second {
+                _mm_madd_epi16(_mm_unpackhi_epi8(p, zero), a)};
+            const __m128 f {_mm_castsi128_ps(first)};
+            const __m128 s {_mm_castsi128_ps(second)};
+            const __m128i even {_mm_castps_si128(
+                _mm_shuffle_ps(f, s, _MM_SHUFFLE(2, 0, 2, 0)))};
+            const __m128i odd {_mm_castps_si128(
+                _mm_shuffle_ps(f, s, _MM_SHUFFLE(3, 1, 3, 1)))};
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(dots) + i, _mm_add_epi32(even, odd));
+        }
+#else
+        for (unsigned i {0}; i < pixels; ++i) {
+            dots[i] = 0;
+            for (unsigned c {0}; c < 4; ++c) {
+                dots[i] += block[4 * i + c] * axis[c];
+            }
+        }
+#endif
+    }
+
+    // which of `steps` evenly spaced points from `from` to `to` every dot is
+    // nearest to, 0 at `from`
+    auto quantize(const int dots[16], int from, int to, int steps,
+                  unsigned char indices[16]) -> void
+    {
+        if (from == to) {
+            std::fill(indices, indices + pixels, 0);
+            return;
+        }
+        const float scale {static_cast<float>(steps - 1)
+            / static_cast<float>(to - from)};
+#if defined(__SSE2__)
+        const __m128 start {_mm_set1_ps(static_cast<float>(from))};
+        const __m128 factor {_mm_set1_ps(scale)};
+        const __m128 last {_mm_set1_ps(static_cast<float>(steps - 1))};
+        const __m128 half {_mm_set1_ps(0.5f)};
+        __m128i index[4];
+        for (unsigned i {0}; i < 4; ++i) {
+            const __m128 dot {_mm_cvtepi32_ps(_mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(dots) + i))};
+            __m128 t {_mm_mul_ps(_mm_sub_ps(dot, start), factor)};
+            t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), last);
+            index[i] = _mm_cvttps_epi32(_mm_add_ps(t, half));
+        }
+        const __m128i packed {_mm_packus_epi16(
+            _mm_packs_epi32(index[0], index[1]),
+            _mm_packs_epi32(index[2], index[3]))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(indices), packed);
+#else
+        for (unsigned i {0}; i < pixels; ++i) {
+            const float t {std::clamp(
+                static_cast<float>(dots[i] - from) * scale, 0.0f,
+                static_cast<float>(steps - 1))};
+            indices[i] = static_cast<unsigned char>(t + 0.5f);
+        }
+#endif
+    }
+
+    // whether channel `c` falls while green rises, then the box's main
+    // diagonal runs the other way along it
+    auto anticorrelated(const unsigned char* block, unsigned c) -> bool
+    {
+        // sums, the means times 16
+        int mean_g {0};
+        int mean_c {0};
+        for (unsigned i {0}; i < pixels; ++i) {
+            mean_g += block[4 * i + 1];
+            mean_c += block[4 * i + c];
+        }
+        int covariance {0};
+        for (unsigned i {0}; i < pixels; ++i) {
+            covariance += (16 * block[4 * i + 1] - mean_g)
+                * (16 * block[4 * i + c] - mean_c);
+        }
+        return covariance < 0;
+    }
+
+    auto diagonal(const unsigned char* block, unsigned channels,
+                  unsigned char lo[4], unsigned char hi[4]) -> void
+    {
+        for (unsigned c {0}; c < channels; ++c) {
+            if (c != 1 && anticorrelated(block, c)) {
+                std::swap(lo[c], hi[c]);
+            }
+        }
+    }
+
+    auto dot(const int a[4], const int b[4]) -> int
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+    }
+
+    auto to_565(const int rgb[4]) -> uint16_t
+    {
+        const int r {(rgb[0] * 31 + 127) / 255};
+        const int g {(rgb[1] * 63 + 127) / 255};
+        const int b {(rgb[2] * 31 + 127) / 255};
+        return static_cast<uint16_t>(r << 11 | g << 5 | b);
+    }
+
+    auto from_565(uint16_t c, int rgb[4]) -> void
+    {
+        const int r {c >> 11};
+        const int g {(c >> 5) & 63};
+        const int b {c & 31};
+        rgb[0] = r << 3 | r >> 2;
+        rgb[1] = g << 2 | g >> 4;
+        rgb[2] = b << 3 | b >> 2;
+        rgb[3] = 0;
+    }
+
+    auto put16(unsigned char* out, uint16_t value) -> void
+    {
+        out[0] = static_cast<unsigned char>(value);
+        out[1] = static_cast<unsigned char>(value >> 8);
+    }
+
+    // a BC1 colour block from the box corners moved `inset` of the way
+    // in, returns its squared error
+    auto encode_colour(
+        const unsigned char* block, const unsigned char lo[4],
+        const unsigned char hi[4], int inset, unsigned char* out) -> int
+    {
+        int end0[4] {};
+        int end1[4] {};
+        for (unsigned c {0}; c < 3; ++c) {
+            const int by {inset != 0 ? (hi[c] - lo[c]) / inset : 0};
+            end0[c] = hi[c] - by;
+            end1[c] = lo[c] + by;
+        }
+        uint16_t c0 {to_565(end0)};
+        uint16_t c1 {to_565(end1)};
+        from_565(c0, end0);
+        from_565(c1, end1);
+
+        // what the decoder makes of the positions from c1 to c0
+        int palette[4][3];
+        for (unsigned c {0}; c < 3; ++c) {
+            palette[0][c] = end1[c];
+            palette[1][c] = (2 * end1[c] + end0[c]) / 3;
+            palette[2][c] = (end1[c] + 2 * end0[c]) / 3;
+            palette[3][c] = end0[c];
+        }
+
+        unsigned char steps[pixels] {};
+        if (c0 != c1) {
+            const int axis[4] {
+                end0[0] - end1[0], end0[1] - end1[1], end0[2] - end1[2], 0};
+            int dots[pixels];
+            project(block, axis, dots);
+            quantize(dots, dot(end1, axis), dot(end0, axis), 4, steps);
+        }
+
+        // codes by position: c1, 2/3 c1 + 1/3 c0, the other way round, c0;
+        // with c0 < c1 the two swap places
+        constexpr uint32_t codes[4] {1, 3, 2, 0};
+        const uint32_t flip {c0 < c1 ? 1u : 0u};
+        uint32_t bits {0};
+        int error {0};
+        for (unsigned i {0}; i < pixels; ++i) {
+            bits |= (codes[steps[i]] ^ flip) << (2 * i);
+            for (unsigned c {0}; c < 3; ++c) {
+                const int d {palette[steps[i]][c] - block[4 * i + c]};
+                error += d * d;
+            }
+        }
+        if (flip != 0) {
+            // c0 > c1 keeps the four colour mode
+            std::swap(c0, c1);
+        }
+        put16(out, c0);
+        put16(out + 2, c1);
+        std::memcpy(out + 4, &bits, 4);
+        return error;
+    }
+
+    auto encode_bc1(const unsigned char* block, unsigned char* out) -> void
+    {
+        unsigned char lo[4];
+        unsigned char hi[4];
+        bounds(block, lo, hi);
+        diagonal(block, 3, lo, hi);
+
+        // insetting the endpoints helps where the extremes are outliers, but
+        // blocks of few colours want them exact, so try both
+        unsigned char inset[8];
+        const int inset_error {encode_colour(block, lo, hi, 16, inset)};
+        if (encode_colour(block, lo, hi, 0, out) > inset_error) {
+            std::memcpy(out, inset, sizeof(inset));
+        }
+    }
+
+    // one BC4 block: the two endpoints, then 3 bit codes into `values`
+    auto write_bc4(
+        int a0, int a1, const int values[8], const unsigned char* block,
+        unsigned channel, const unsigned char codes[16], unsigned char* out)
+        -> int
+    {
+        out[0] = static_cast<unsigned char>(a0);
+        out[1] = static_cast<unsigned char>(a1);
+        uint64_t bits {0};
+        int error {0};
+        for (unsigned i {0}; i < pixels; ++i) {
+            bits |= uint64_t{codes[i]} << (3 * i);
+            const int d {values[codes[i]] - block[4 * i + channel]};
+            error += d * d;
+        }
+        for (unsigned i {0}; i < 6; ++i) {
+            out[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+        }
+        return error;
+    }
+
+    auto encode_bc4(const unsigned char* block, unsigned channel,
+                    unsigned char* out) -> void
+    {
+        unsigned char lo[4];
+        unsigned char hi[4];
+        bounds(block, lo, hi);
+
+        // eight values from the maximum down to the minimum
+        const int a0 {hi[channel]};
+        const int a1 {lo[channel]};
+        int values[8] {a0, a1};
+        for (int k {2}; k < 8; ++k) {
+            values[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+        }
+        unsigned char codes[pixels] {};
+        if (a0 != a1) {
+            int axis[4] {};
+            axis[channel] = 1;
+            int dots[pixels];
+            project(block, axis, dots);
+            quantize(dots, a1, a0, 8, codes);
+            // codes by position from the minimum: 1, 7, 6, ..., 2, 0
+            for (unsigned char& code : codes) {
+                code = static_cast<unsigned char>(
+                    code == 0 ? 1 : code == 7 ? 0 : 8 - code);
+            }
+        }
+        const int error {write_bc4(a0, a1, values, block, channel, codes, out)};
+        if (error == 0 || (a1 != 0 && a0 != 255)) {
+            return;
+        }
+
+        // the other mode has 0 and 255 exact and six values between the
+        // extremes of the rest, better where a block has both, like the
+        // edges of glyphs
+        int inner_lo {255};
+        int inner_hi {0};
+        for (unsigned i {0}; i < pixels; ++i) {
+            const int v {block[4 * i + channel]};
+            if (v != 0 && v != 255) {
+                inner_lo = std::min(inner_lo, v);
+                inner_hi = std::max(inner_hi, v);
+            }
+        }
+        if (inner_lo > inner_hi) {
+            inner_lo = inner_hi = a1; // only 0 and 255
+        }
+        int extremes[8] {inner_lo, inner_hi};
+        for (int k {2}; k < 6; ++k) {
+            extremes[k] = ((6 - k) * inner_lo + (k - 1) * inner_hi) / 5;
+        }
+        extremes[6] = 0;
+        extremes[7] = 255;
+        for (unsigned i {0}; i < pixels; ++i) {
+            const int v {block[4 * i + channel]};
+            unsigned best {0};
+            for (unsigned k {1}; k < 8; ++k) {
+                if (std::abs(extremes[k] - v) < std::abs(extremes[best] - v)) {
+                    best = k;
+                }
+            }
+            codes[i] = static_cast<unsigned char>(best);
+        }
+        unsigned char other[8];
+        const int other_error {write_bc4(
+            inner_lo, inner_hi, extremes, block, channel, codes, other)};
+        if (other_error < error) {
+            std::memcpy(out, other, sizeof(other));
+        }
+    }
+
+    // 128 bits, least significant first
+    class Bit_writer final {
+     public:
+        Bit_writer()
+        : bits{0, 0}
+        , at{0}
+        {}
+
+        auto put(uint64_t value, unsigned count) -> void
+        {
+            for (unsigned i {0}; i < count; ++i, ++this->at) {
+                this->bits[this->at / 64] |=
+                    ((value >> i) & 1) << (this->at % 64);
+            }
+        }
+
+        auto write(unsigned char* out) const -> void
+        {
+            std::memcpy(out, this->bits, 16);
+        }
+
+     private:
+        uint64_t bits[2];
+        unsigned at;
+    };
+
+    // BC7 interpolation weights in 64ths, for 2, 3 and 4 bit indices
+    constexpr int weights_2[4] {0, 21, 43, 64};
+    constexpr int weights_3[8] {0, 9, 18, 27, 37, 46, 55, 64};
+    constexpr int weights_4[16] {
+        0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    // with the nearest of the `count` points from e0 to e1 for every pixel,
+    // over channels [first, last), returns the squared error
+    auto assign(
+        const unsigned char* block, unsigned first, unsigned last,
+        const int e0[4], const int e1[4], const int* weights, unsigned count,
+        unsigned char indices[16]) -> int
+    {
+        int palette[16][4];
+        for (unsigned k {0}; k < count; ++k) {
+            for (unsigned c {first}; c < last; ++c) {
+                palette[k][c] =
+                    ((64 - weights[k]) * e0[c] + weights[k] * e1[c] + 32) >> 6;
+            }
+        }
+        int error {0};
+        for (unsigned i {0}; i < pixels; ++i) {
+            int best {-1};
+            for (unsigned k {0}; k < count; ++k) {
+                int e {0};
+                for (unsigned c {first}; c < last; ++c) {
+                    const int d {palette[k][c] - block[4 * i + c]};
+                    e += d * d;
+                }
+                if (best < 0 || e < best) {
+                    best = e;
+                    indices[i] = static_cast<unsigned char>(k);
+                }
+            }
+            error += best;
+        }
+        return error;
+    }
+
+    // least squares endpoints of channels [first, last) for the weights the
+    // indices pick, false when all pixels have the same weight
+    auto fit(
+        const unsigned char* block, unsigned first, unsigned last,
+        const int* weights, const unsigned char indices[16],
+        unsigned char e0[4], unsigned char e1[4]) -> bool
+    {
+        float aa {0.0f};
+        float ab {0.0f};
+        float bb {0.0f};
+        float ax[4] {};
+        float bx[4] {};
+        for (unsigned i {0}; i < pixels; ++i) {
+            const float t {static_cast<float>(weights[indices[i]]) / 64.0f};
+            aa += (1.0f - t) * (1.0f - t);
+            ab += (1.0f - t) * t;
+            bb += t * t;
+            for (unsigned c {first}; c < last; ++c) {
+                ax[c] += (1.0f - t) * block[4 * i + c];
+                bx[c] += t * block[4 * i + c];
+            }
+        }
+        const float det {aa * bb - ab * ab};
+        if (det < 1e-3f) {
+            return false;
+        }
+        for (unsigned c {first}; c < last; ++c) {
+            const float a {(bb * ax[c] - ab * bx[c]) / det};
+            const float b {(aa * bx[c] - ab * ax[c]) / det};
+            e0[c] = static_cast<unsigned char>(
+                std::clamp(a + 0.5f, 0.0f, 255.0f));
+            e1[c] = static_cast<unsigned char>(
+                std::clamp(b + 0.5f, 0.0f, 255.0f));
+        }
+        return true;
+    }
+
+    // 7 bits and a shared lowest bit (p-bit), whichever p-bit is closer
+    auto endpoint_7p(const unsigned char* value, int q[4], int& p) -> void
+    {
+        int best {-1};
+        for (int bit {0}; bit < 2; ++bit) {
+            int error {0};
+            int candidate[4];
+            for (unsigned c {0}; c < 4; ++c) {
+                candidate[c] = std::clamp((value[c] - bit + 1) >> 1, 0, 127);
+                const int d {(candidate[c] << 1 | bit) - value[c]};
+                error += d * d;
+            }
+            if (best < 0 || error < best) {
+                best = error;
+                p = bit;
+                std::copy(candidate, candidate + 4, q);
+            }
+        }
+    }
+
+    // times the endpoints are refitted to the indices they got
+    constexpr unsigned refinements {2};
+
+    // mode 6: one RGBA line, 7 bit endpoints with a p-bit and 4 bit indices,
+    // returns the squared error
+    auto encode_mode_6(const unsigned char* block, unsigned char* out) -> int
+    {
+        unsigned char lo[4];
+        unsigned char hi[4];
+        bounds(block, lo, hi);
+        diagonal(block, 4, lo, hi);
+
+        int best_error {-1};
+        int q[2][4] {};
+        int p[2] {};
+        unsigned char indices[pixels] {};
+        for (unsigned pass {0}; pass <= refinements; ++pass) {
+            int cand_q[2][4];
+            int cand_p[2];
+            endpoint_7p(lo, cand_q[0], cand_p[0]);
+            endpoint_7p(hi, cand_q[1], cand_p[1]);
+            int end0[4];
+            int end1[4];
+            for (unsigned c {0}; c < 4; ++c) {
+                end0[c] = cand_q[0][c] << 1 | cand_p[0];
+                end1[c] = cand_q[1][c] << 1 | cand_p[1];
+            }
+            unsigned char cand_indices[pixels];
+            const int error {assign(
+                block, 0, 4, end0, end1, weights_4, 16, cand_indices)};
+            if (best_error < 0 || error < best_error) {
+                best_error = error;
+                std::copy(&cand_q[0][0], &cand_q[0][0] + 8, &q[0][0]);
+                std::copy(cand_p, cand_p + 2, p);
+                std::copy(cand_indices, cand_indices + pixels, indices);
+            }
+            if (error == 0
+                || !fit(block, 0, 4, weights_4, cand_indices, lo, hi)) {
+                break;
+            }
+        }
+
+        // the first index is stored without its top bit, which has to be 0
+        if (indices[0] >= 8) {
+            std::swap(q[0], q[1]);
+            std::swap(p[0], p[1]);
+            for (unsigned char& index : indices) {
+                index = static_cast<unsigned char>(15 - index);
+            }
+        }
+
+        Bit_writer bits;
+        bits.put(1u << 6, 7); // mode 6
+        for (unsigned c {0}; c < 4; ++c) {
+            bits.put(static_cast<uint64_t>(q[0][c]), 7);
+            bits.put(static_cast<uint64_t>(q[1][c]), 7);
+        }
+        bits.put(static_cast<uint64_t>(p[0]), 1);
+        bits.put(static_cast<uint64_t>(p[1]), 1);
+        bits.put(indices[0], 3);
+        for (unsigned i {1}; i < pixels; ++i) {
+            bits.put(indices[i], 4);
+        }
+        bits.write(out);
+        return best_error;
+    }
+
+    // endpoints of `bits` bits (no p-bit) for channels [first, last) and the
+    // indices into the `count` points between them, fitted like mode 6,
+    // returns the squared error over those channels
+    auto encode_line(
+        const unsigned char* block, unsigned first, unsigned last,
+        unsigned bits, const int* weights, unsigned count,
+        unsigned char lo[4], unsigned char hi[4], int q[2][4],
+        unsigned char indices[16]) -> int
+    {
+        const int top {(1 << bits) - 1};
+        int best_error {-1};
+        for (unsigned pass {0}; pass <= refinements; ++pass) {
+            int cand_q[2][4] {};
+            int end[2][4] {};
+            for (unsigned c {first}; c < last; ++c) {
+                cand_q[0][c] = (lo[c] * top + 127) / 255;
+                cand_q[1][c] = (hi[c] * top + 127) / 255;
+                for (unsigned e {0}; e < 2; ++e) {
+                    // the top bits repeated below, as the decoder does
+                    end[e][c] = cand_q[e][c] << (8 - bits)
+                        | cand_q[e][c] >> (2 * bits - 8);
+                }
+            }
+            unsigned char cand_indices[pixels];
+            const int error {assign(
+                block, first, last, end[0], end[1], weights, count,
+                cand_indices)};
+            if (best_error < 0 || error < best_error) {
+                best_error = error;
+                std::copy(&cand_q[0][0], &cand_q[0][0] + 8, &q[0][0]);
+                std::copy(cand_indices, cand_indices + pixels, indices);
+            }
+            if (error == 0
+                || !fit(block, first, last, weights, cand_indices, lo, hi)) {
+                break;
+            }
+        }
+
+        // the first index is stored without its top bit, which has to be 0
+        if (indices[0] >= count / 2) {
+            std::swap(q[0], q[1]);
+            for (unsigned i {0}; i < pixels; ++i) {
+                indices[i] = static_cast<unsigned char>(count - 1 - indices[i]);
+            }
+        }
+        return best_error;
+    }
+
+    // modes 4 and 5: RGB and alpha as two lines, without channel rotation;
+    // mode 4 has 5 bit colour and 6 bit alpha endpoints, 2 bit colour and
+    // 3 bit alpha indices, mode 5 7 and 8 bit endpoints and 2 bit indices for
+    // both; returns the squared error
+    auto encode_separate(
+        const unsigned char* block, unsigned mode, unsigned char* out) -> int
+    {
+        const unsigned colour_bits {mode == 4 ? 5u : 7u};
+        const unsigned alpha_bits {mode == 4 ? 6u : 8u};
+        const unsigned alpha_index_bits {mode == 4 ? 3u : 2u};
+
+        unsigned char lo[4];
+        unsigned char hi[4];
+        bounds(block, lo, hi);
+        diagonal(block, 3, lo, hi);
+
+        int colour_q[2][4] {};
+        unsigned char colour[pixels] {};
+        const int colour_error {encode_line(
+            block, 0, 3, colour_bits, weights_2, 4, lo, hi, colour_q,
+            colour)};
+        int alpha_q[2][4] {};
+        unsigned char alpha[pixels] {};
+        const int alpha_error {encode_line(
+            block, 3, 4, alpha_bits,
+            alpha_index_bits == 3 ? weights_3 : weights_2,
+            1u << alpha_index_bits, lo, hi, alpha_q, alpha)};
+
+        Bit_writer bits;
+        bits.put(1u << mode, mode + 1);
+        bits.put(0, 2); // no channel rotation
+        if (mode == 4) {
+            bits.put(0, 1); // the 2 bit indices are the colour ones
+        }
+        for (unsigned c {0}; c < 3; ++c) {
+            bits.put(static_cast<uint64_t>(colour_q[0][c]), colour_bits);
+            bits.put(static_cast<uint64_t>(colour_q[1][c]), colour_bits);
+        }
+        bits.put(static_cast<uint64_t>(alpha_q[0][3]), alpha_bits);
+        bits.put(static_cast<uint64_t>(alpha_q[1][3]), alpha_bits);
+        bits.put(colour[0], 1);
+        for (unsigned i {1}; i < pixels; ++i) {
+            bits.put(colour[i], 2);
+        }
+        bits.put(alpha[0], alpha_index_bits - 1);
+        for (unsigned i {1}; i < pixels; ++i) {
+            bits.put(alpha[i], alpha_index_bits);
+        }
+        bits.write(out);
+        return colour_error + alpha_error;
+    }
+
+    // mode 6 keeps colour and alpha on one line, good where they change
+    // together; modes 4 and 5 fit them separately, good where they do not
+    // (glyph edges, cut-outs), mode 4 with finer alpha, 5 with finer colour
+    auto encode_bc7(const unsigned char* block, unsigned char* out) -> void
+    {
+        int error {encode_mode_6(block, out)};
+        for (unsigned mode {4}; mode <= 5 && error != 0; ++mode) {
+            unsigned char other[16];
+            const int other_error {encode_separate(block, mode, other)};
+            if (other_error < error) {
+                error = other_error;
+                std::memcpy(out, other, sizeof(other));
+            }
+        }
+    }
+} // namespace
+
+auto bc::block_bytes(Format format) -> unsigned
+{
+    return format == Format::bc1 ? 8 : 16;
+}
+
+auto bc::encode(Format format, const unsigned char* block, unsigned char* out)
+    -> void
+{
+    switch (format) {
+    case Format::bc1:
+        encode_bc1(block, out);
+        break;
+    case Format::bc3:
+        encode_bc4(block, 3, out);
+        encode_bc1(block, out + 8);
+        break;
+    case Format::bc5:
+        encode_bc4(block, 0, out);
+        encode_bc4(block, 1, out + 8);
+        break;
+    case Format::bc7:
+        encode_bc7(block, out);
+        break;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef SRC_BC_HPP_
+#define SRC_BC_HPP_
+
+/*******************************************************************************
+ * Block compression (BCn) encoders, for the texture cooker.
+ *
+ * encode() compresses one 4x4 block of 8 bit RGBA pixels (64 bytes, rows top
+ * to bottom) into block_bytes() bytes of:
+ *
+ *  - BC1 (DXT1): RGB at 4 bits a pixel, alpha is dropped
+ *  - BC3 (DXT5): BC1 colour and a BC4 block for alpha
+ *  - BC5 (ATI2, RGTC2): red and green as two BC4 blocks, for normal maps
+ *  - BC7: RGBA, one subset: mode 6 (colour and alpha on one line, 4 bit
+ *    indices), or mode 4 or 5 (alpha on a line of its own), whichever has the
+ *    lower error
+ *
+ * Endpoints are the corners of the block's bounding box along its main
+ * diagonal, every pixel gets the nearest point between them. BC7 then refits
+ * the endpoints to the indices by least squares a couple of times. That is far
+ * from what an exhaustive encoder finds but it is fast, and good enough for
+ * the smooth and greyscale textures here. The per pixel work of BC1 to BC5
+ * (bounds, projections, quantisation) uses SSE2 where the compiler targets
+ * it.
+ ******************************************************************************/
+
+namespace bc {
+    enum class Format {
+        bc1,
+        bc3,
+        bc5,
+        bc7
+    };
+
+    auto block_bytes(Format format) -> unsigned;
+
+    auto encode(Format format, const unsigned char* block, unsigned char* out)
+        -> void;
+} // namespace bc
+
+#endif // SRC_BC_HPP_
@@ -0,0 +1,58 @@
+#include "bench.hpp"
+
+#include <fstream>
+#include <utility>
+#include <vector>
+
+#include "logs.hpp"
+
+namespace {
+    using Section = std::pair<std::string, std::vector<std::pair<std::string, double>>>;
+
+    std::vector<Section> sections;
+} // namespace
+
+auto bench::set(const std::string& section, const std::string& key, double value)
+    -> void
+{
+    auto sec {sections.begin()};
+    while (sec != sections.end() && sec->first != section) {
+        ++sec;
+    }
+    if (sec == sections.end()) {
+        sections.emplace_back(section, Section::second_type{});
+        sec = sections.end() - 1;
+    }
+
+    for (auto& entry : sec->second) {
+        if (entry.first == key) {
+            entry.second = value;
+            return;
+        }
+    }
+    sec->second.emplace_back(key, value);
+}
+
+auto bench::write(const std::string& path) -> bool
+{
+    std::ofstream out(path, std::ios::out);
+    if (!out.is_open()) {
+        logs::err("can not open ", path, " for writing");
+        return false;
+    }
+
+    out << "{";
+    for (size_t i {0}; i < sections.size(); ++i) {
+        out << (i > 0 ? ",\n " : "\n ") << "\"" << sections[i].first << "\": {";
+        const auto& entries {sections[i].second};
+        for (size_t j {0}; j < entries.size(); ++j) {
+            out << (j > 0 ? ", " : "")
+                << "\"" << entries[j].first << "\": " << entries[j].second;
+        }
+        out << "}";
+    }
+    out << "\n}\n";
+
+    logs::info("benchmark summary written to ", path);
+    return out.good();
+}
@@ -0,0 +1,22 @@
+#ifndef SRC_BENCH_HPP_
+#define SRC_BENCH_HPP_
+
+/*******************************************************************************
+ * Benchmark summary, written at exit when the program is run with
+ * `--bench <file>`.
+ *
+ * Values are grouped into sections and written as one JSON object per section,
+ * in the order they were first set:
+ *     {"frames": {"count": 1200, "mean_ms": 16.6}, "gl": {...}}
+ ******************************************************************************/
+
+#include <string>
+
+namespace bench {
+    auto set(const std::string& section, const std::string& key, double value)
+        -> void;
+
+    auto write(const std::string& path) -> bool;
+} // namespace bench
+
+#endif // SRC_BENCH_HPP_
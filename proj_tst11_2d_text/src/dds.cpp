@@ -0,0 +1,302 @@
+#include "dds.hpp"
+
+#include "gl_loader.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "dds_format.hpp"
+#include "logs.hpp"
+
+namespace {
+    using namespace dds;
+
+    // what GL_MAX_TEXTURE_SIZE and GL_MAX_ARRAY_TEXTURE_LAYERS usually are,
+    // keeps the sizes far from overflowing
+    constexpr unsigned max_dimension {16384};
+    constexpr unsigned max_array_size {2048};
+
+    // GL_EXT_texture_sRGB, not in glcorearb.h
+    constexpr GLenum compressed_srgb_alpha_s3tc_dxt1 {0x8c4d};
+    constexpr GLenum compressed_srgb_alpha_s3tc_dxt3 {0x8c4e};
+    constexpr GLenum compressed_srgb_alpha_s3tc_dxt5 {0x8c4f};
+
+    constexpr dds::Format rgba8 {
+        "RGBA8", GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 0, 4};
+    constexpr dds::Format bgra8 {
+        "BGRA8", GL_RGBA8, GL_BGRA, GL_UNSIGNED_BYTE, 0, 4};
+    constexpr dds::Format bc1 {
+        "BC1", GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 0, 0, 8, 0};
+    constexpr dds::Format bc2 {
+        "BC2", GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 0, 0, 16, 0};
+    constexpr dds::Format bc3 {
+        "BC3", GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 0, 0, 16, 0};
+    constexpr dds::Format bc4 {"BC4", GL_COMPRESSED_RED_RGTC1, 0, 0, 8, 0};
+    constexpr dds::Format bc4_snorm {
+        "BC4_SNORM", GL_COMPRESSED_SIGNED_RED_RGTC1, 0, 0, 8, 0};
+    constexpr dds::Format bc5 {"BC5", GL_COMPRESSED_RG_RGTC2, 0, 0, 16, 0};
+    constexpr dds::Format bc5_snorm {
+        "BC5_SNORM", GL_COMPRESSED_SIGNED_RG_RGTC2, 0, 0, 16, 0};
+
+    struct Dxgi_format {
+        Dxgi code;
+        dds::Format format;
+    };
+
+    constexpr Dxgi_format dxgi_formats[] {
+        {dxgi_rgba8, rgba8},
+        {dxgi_rgba8_srgb,
+         {"RGBA8_SRGB", GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE, 0, 4}},
+        {dxgi_bc1, bc1},
+        {dxgi_bc1_srgb,
+         {"BC1_SRGB", compressed_srgb_alpha_s3tc_dxt1, 0, 0, 8, 0}},
+        {dxgi_bc2, bc2},
+        {dxgi_bc2_srgb,
+         {"BC2_SRGB", compressed_srgb_alpha_s3tc_dxt3, 0, 0, 16, 0}},
+        {dxgi_bc3, bc3},
+        {dxgi_bc3_srgb,
+         {"BC3_SRGB", compressed_srgb_alpha_s3tc_dxt5, 0, 0, 16, 0}},
+        {dxgi_bc4, bc4},
+        {dxgi_bc4_snorm, bc4_snorm},
+        {dxgi_bc5, bc5},
+        {dxgi_bc5_snorm, bc5_snorm},
+        {dxgi_bgra8, bgra8},
+        {dxgi_bgra8_srgb,
+         {"BGRA8_SRGB", GL_SRGB8_ALPHA8, GL_BGRA, GL_UNSIGNED_BYTE, 0, 4}},
+        {dxgi_bc6h_uf16,
+         {"BC6H_UF16", GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, 0, 0, 16, 0}},
+        {dxgi_bc6h_sf16,
+         {"BC6H_SF16", GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT, 0, 0, 16, 0}},
+        {dxgi_bc7, {"BC7", GL_COMPRESSED_RGBA_BPTC_UNORM, 0, 0, 16, 0}},
+        {dxgi_bc7_srgb,
+         {"BC7_SRGB", GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 0, 0, 16, 0}},
+    };
+
+    // the file is little endian, like everything this runs on
+    auto u32(std::string_view file, size_t at) -> uint32_t
+    {
+        uint32_t value;
+        std::memcpy(&value, file.data() + at, sizeof(value));
+        return value;
+    }
+
+    auto legacy_format(std::string_view file, dds::Format& format) -> bool
+    {
+        const uint32_t flags {u32(file, at_pf_flags)};
+        if ((flags & pf_fourcc) != 0) {
+            const uint32_t code {u32(file, at_pf_fourcc)};
+            if (code == fourcc("DXT1")) {
+                format = bc1;
+            } else if (code == fourcc("DXT3")) {
+                format = bc2;
+            } else if (code == fourcc("DXT5")) {
+                format = bc3;
+            } else if (code == fourcc("ATI1") || code == fourcc("BC4U")) {
+                format = bc4;
+            } else if (code == fourcc("BC4S")) {
+                format = bc4_snorm;
+            } else if (code == fourcc("ATI2") || code == fourcc("BC5U")) {
+                format = bc5;
+            } else if (code == fourcc("BC5S")) {
+                format = bc5_snorm;
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        if ((flags & pf_rgb) != 0 && u32(file, at_pf_bit_count) == 32) {
+            const uint32_t red {u32(file, at_pf_masks)};
+            const uint32_t blue {u32(file, at_pf_masks + 8)};
+            if (red == 0x000000ff && blue == 0x00ff0000) {
+                format = rgba8;
+                return true;
+            }
+            if (red == 0x00ff0000 && blue == 0x000000ff) {
+                format = bgra8;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    auto dxgi_format(uint32_t code, dds::Format& format) -> bool
+    {
+        for (const Dxgi_format& known : dxgi_formats) {
+            if (known.code == code) {
+                format = known.format;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    auto mipmap_levels(unsigned width, unsigned height) -> unsigned
+    {
+        unsigned levels {1};
+        for (unsigned size {std::max(width, height)}; size > 1; size /= 2) {
+            ++levels;
+        }
+        return levels;
+    }
+} // namespace
+
+auto dds::level_size(const Format& format, unsigned width, unsigned height)
+    -> size_t
+{
+    if (format.block_bytes == 0) {
+        return size_t{width} * height * format.pixel_bytes;
+    }
+    const size_t blocks_x {std::max((width + 3) / 4, 1u)};
+    const size_t blocks_y {std::max((height + 3) / 4, 1u)};
+    return blocks_x * blocks_y * format.block_bytes;
+}
+
+auto dds::parse(const std::string& name, std::string_view file, Image& image)
+    -> bool
+{
+    if (file.size() < magic_size + header_size
+        || std::memcmp(file.data(), file_magic, magic_size) != 0) {
+        logs::err(name, " is not a .dds file");
+        return false;
+    }
+    if (u32(file, at_header_size) != header_size
+        || u32(file, at_pf_size) != pf_size) {
+        logs::err(name, ": corrupt .dds header");
+        return false;
+    }
+
+    size_t offset {magic_size + header_size};
+    const uint32_t caps2 {u32(file, at_caps2)};
+    bool cube {(caps2 & caps2_cubemap) != 0};
+    unsigned array_size {1};
+    const bool dx10 {(u32(file, at_pf_flags) & pf_fourcc) != 0
+        && u32(file, at_pf_fourcc) == fourcc("DX10")};
+
+    if (dx10) {
+        if (file.size() < offset + dx10_header_size) {
+            logs::err(name, " is truncated");
+            return false;
+        }
+        offset += dx10_header_size;
+        const uint32_t code {u32(file, at_dxgi_format)};
+        if (!dxgi_format(code, image.format)) {
+            logs::err(name, ": unsupported DXGI format ", code);
+            return false;
+        }
+        if (u32(file, at_dimension) != dimension_texture2d) {
+            logs::err(name, ": only 2D textures are supported");
+            return false;
+        }
+        cube = (u32(file, at_misc_flag) & misc_texturecube) != 0;
+        array_size = u32(file, at_array_size);
+    } else {
+        if (!legacy_format(file, image.format)) {
+            logs::err(name, ": unsupported pixel format");
+            return false;
+        }
+        if ((caps2 & caps2_volume) != 0 && u32(file, at_depth) > 1) {
+            logs::err(name, ": volume textures are not supported");
+            return false;
+        }
+        if (cube && (caps2 & caps2_all_faces) != caps2_all_faces) {
+            logs::err(name, ": cubemaps need all six faces");
+            return false;
+        }
+    }
+
+    image.width = u32(file, at_width);
+    image.height = u32(file, at_height);
+    if (image.width == 0 || image.height == 0
+        || image.width > max_dimension || image.height > max_dimension) {
+        logs::err(name, ": bad size ", image.width, "x", image.height);
+        return false;
+    }
+    if (cube && image.width != image.height) {
+        logs::err(name, ": cubemap faces are not square");
+        return false;
+    }
+    if (array_size == 0 || array_size > max_array_size) {
+        logs::err(name, ": bad array size ", array_size);
+        return false;
+    }
+
+    // files without mipmaps may say 0
+    image.levels = std::max(u32(file, at_mipmap_count), 1u);
+    if (image.levels > mipmap_levels(image.width, image.height)) {
+        logs::err(name, ": ", image.levels, " mipmaps for ",
+            image.width, "x", image.height);
+        return false;
+    }
+
+    image.layers = cube ? array_size * 6 : array_size;
+    if (cube) {
+        image.target =
+            array_size > 1 ? GL_TEXTURE_CUBE_MAP_ARRAY : GL_TEXTURE_CUBE_MAP;
+    } else {
+        image.target = array_size > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    }
+
+    image.surfaces.clear();
+    image.surfaces.reserve(size_t{image.layers} * image.levels);
+    const auto* data {reinterpret_cast<const unsigned char*>(file.data())};
+    for (unsigned layer {0}; layer < image.layers; ++layer) {
+        unsigned width {image.width};
+        unsigned height {image.height};
+        for (unsigned level {0}; level < image.levels; ++level) {
+            const size_t size {level_size(image.format, width, height)};
+            // compared this way round the sum can not overflow
+            if (size > file.size() - offset) {
+                logs::err(name, " is truncated");
+                return false;
+            }
+            image.surfaces.push_back(Surface{
+                .layer = layer,
+                .level = level,
+                .width = width,
+                .height = height,
+                .data = data + offset,
+                .size = size,
+            });
+            offset += size;
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+        }
+    }
+
+    DBG(2, name, ": ", image.format.name, " ", image.width, "x", image.height,
+        ", ", image.levels, " mipmaps, ", image.layers, " layers",
+        cube ? " (cubemap)" : "");
+    return true;
+}
+
+auto dds::supported(GLenum target, GLenum internal_format) -> bool
+{
+    if (target == GL_TEXTURE_CUBE_MAP_ARRAY
+        && !gl_loader::has("GL_ARB_texture_cube_map_array")
+        && !gl_loader::version(4, 0)) {
+        return false;
+    }
+
+    switch (internal_format) {
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        return gl_loader::has("GL_EXT_texture_compression_s3tc");
+    case compressed_srgb_alpha_s3tc_dxt1:
+    case compressed_srgb_alpha_s3tc_dxt3:
+    case compressed_srgb_alpha_s3tc_dxt5:
+        return gl_loader::has("GL_EXT_texture_compression_s3tc")
+            && (gl_loader::has("GL_EXT_texture_sRGB")
+                || gl_loader::has("GL_EXT_texture_compression_s3tc_srgb"));
+    case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+    case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+        return gl_loader::has("GL_ARB_texture_compression_bptc")
+            || gl_loader::version(4, 2);
+    default:
+        return true; // RGTC and the uncompressed ones are core in 3.0
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef SRC_DDS_HPP_
+#define SRC_DDS_HPP_
+
+/*******************************************************************************
+ * DirectDraw Surface (.dds) files, parsed in place.
+ *
+ * parse() reads the header (and the DX10 extension header after it) from a
+ * file already in memory, e.g. a view from assets::get(), and hands back
+ * where every surface is: nothing is copied, the surfaces point into the
+ * file. It needs no OpenGL, so workers can do it.
+ *
+ * Formats: BC1-BC7 (DXT1/3/5, ATI1/2 and BC4U/S, BC5U/S as legacy FourCCs,
+ * the rest through the DX10 header, sRGB and signed variants included) and
+ * 32 bit RGBA/BGRA. Besides plain 2D textures the file may hold an array,
+ * a cubemap (all six faces) or an array of cubemaps. Volume textures,
+ * partial cubemaps and other formats are rejected.
+ *
+ * The size of every mipmap is computed from the format and dimensions, not
+ * taken from the header's pitch, and all of them have to be within the file,
+ * so a truncated or corrupt file fails to parse rather than reading past its
+ * end. The header is read with memcpy, the file needs no particular alignment.
+ ******************************************************************************/
+
+#include "gl_loader.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dds {
+    struct Format {
+        const char* name; // "BC7_SRGB"
+        GLenum internal_format;
+        GLenum format;        // uncompressed only
+        GLenum type;          // uncompressed only
+        unsigned block_bytes; // per 4x4 block, 0 if uncompressed
+        unsigned pixel_bytes; // uncompressed only
+    };
+
+    // one mipmap of one layer
+    struct Surface {
+        unsigned layer; // array element * 6 + face for cubemaps
+        unsigned level;
+        unsigned width;
+        unsigned height;
+        const unsigned char* data;
+        size_t size;
+    };
+
+    struct Image {
+        Format format;
+        // GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP or
+        // GL_TEXTURE_CUBE_MAP_ARRAY
+        GLenum target;
+        unsigned width;
+        unsigned height;
+        unsigned levels;
+        unsigned layers; // 6 per cubemap
+        // in file order: layer after layer, biggest mipmap first
+        std::vector<Surface> surfaces;
+    };
+
+    // bytes of a `width` x `height` mipmap
+    auto level_size(const Format& format, unsigned width, unsigned height)
+        -> size_t;
+
+    // parse the file in `file`, false (and an error about `name` logged) if
+    // it is not a .dds file this can load
+    auto parse(const std::string& name, std::string_view file, Image& image)
+        -> bool;
+
+    // whether the context can do a `target` texture of `internal_format`
+    // (BPTC needs GL 4.2, cubemap arrays GL 4.0, S3TC an extension), only
+    // on the context thread
+    auto supported(GLenum target, GLenum internal_format) -> bool;
+} // namespace dds
+
+#endif // SRC_DDS_HPP_
@@ -0,0 +1,97 @@
+#ifndef SRC_DDS_FORMAT_HPP_
+#define SRC_DDS_FORMAT_HPP_
+
+/*******************************************************************************
+ * On-disk layout of a .dds file, shared by the parser (dds.hpp), the texture
+ * cooker (tools/cook_textures.cpp) and the atlas packer (tools/pack_atlas.cpp).
+ *
+ * A file is the magic, the 124 byte DDS_HEADER, the 20 byte DDS_HEADER_DXT10
+ * if the pixel format's FourCC is "DX10", and then the surfaces: layer after
+ * layer (cubemap faces count as layers), each with its mipmaps from the
+ * biggest down, without padding. Everything is little endian. The fields are
+ * given as offsets from the start of the file, so they can be read and
+ * written with memcpy wherever the file is in memory.
+ ******************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dds {
+    constexpr char file_magic[4] {'D', 'D', 'S', ' '};
+    constexpr size_t magic_size {4};
+    constexpr size_t header_size {124};
+    constexpr size_t dx10_header_size {20};
+
+    // DDS_HEADER
+    constexpr size_t at_header_size {4};
+    constexpr size_t at_flags {8};
+    constexpr size_t at_height {12};
+    constexpr size_t at_width {16};
+    constexpr size_t at_pitch {20}; // or the size of the first mipmap
+    constexpr size_t at_depth {24};
+    constexpr size_t at_mipmap_count {28};
+    constexpr size_t at_pf_size {76}; // DDS_PIXELFORMAT from here
+    constexpr size_t at_pf_flags {80};
+    constexpr size_t at_pf_fourcc {84};
+    constexpr size_t at_pf_bit_count {88};
+    constexpr size_t at_pf_masks {92}; // red, green, blue, alpha
+    constexpr size_t at_caps {108};
+    constexpr size_t at_caps2 {112};
+    constexpr uint32_t pf_size {32};
+
+    // DDS_HEADER_DXT10, right after DDS_HEADER
+    constexpr size_t at_dxgi_format {magic_size + header_size};
+    constexpr size_t at_dimension {at_dxgi_format + 4};
+    constexpr size_t at_misc_flag {at_dxgi_format + 8};
+    constexpr size_t at_array_size {at_dxgi_format + 12};
+
+    constexpr uint32_t flags_caps {0x1};
+    constexpr uint32_t flags_height {0x2};
+    constexpr uint32_t flags_width {0x4};
+    constexpr uint32_t flags_pitch {0x8};
+    constexpr uint32_t flags_pixel_format {0x1000};
+    constexpr uint32_t flags_mipmap_count {0x20000};
+    constexpr uint32_t flags_linear_size {0x80000};
+    constexpr uint32_t pf_fourcc {0x4};
+    constexpr uint32_t pf_rgb {0x40};
+    constexpr uint32_t caps_complex {0x8};
+    constexpr uint32_t caps_texture {0x1000};
+    constexpr uint32_t caps_mipmap {0x400000};
+    constexpr uint32_t caps2_cubemap {0x200};
+    constexpr uint32_t caps2_all_faces {0xfc00};
+    constexpr uint32_t caps2_volume {0x200000};
+    constexpr uint32_t dimension_texture2d {3};
+    constexpr uint32_t misc_texturecube {0x4};
+
+    // the DXGI_FORMAT values used
+    enum Dxgi : uint32_t {
+        dxgi_rgba8 = 28,
+        dxgi_rgba8_srgb = 29,
+        dxgi_bc1 = 71,
+        dxgi_bc1_srgb = 72,
+        dxgi_bc2 = 74,
+        dxgi_bc2_srgb = 75,
+        dxgi_bc3 = 77,
+        dxgi_bc3_srgb = 78,
+        dxgi_bc4 = 80,
+        dxgi_bc4_snorm = 81,
+        dxgi_bc5 = 83,
+        dxgi_bc5_snorm = 84,
+        dxgi_bgra8 = 87,
+        dxgi_bgra8_srgb = 91,
+        dxgi_bc6h_uf16 = 95,
+        dxgi_bc6h_sf16 = 96,
+        dxgi_bc7 = 98,
+        dxgi_bc7_srgb = 99,
+    };
+
+    constexpr auto fourcc(const char (&code)[5]) -> uint32_t
+    {
+        return static_cast<uint32_t>(code[0])
+            | static_cast<uint32_t>(code[1]) << 8
+            | static_cast<uint32_t>(code[2]) << 16
+            | static_cast<uint32_t>(code[3]) << 24;
+    }
+} // namespace dds
+
+#endif // SRC_DDS_FORMAT_HPP_
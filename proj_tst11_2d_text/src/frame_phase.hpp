@@ -0,0 +1,29 @@
+#ifndef SRC_FRAME_PHASE_HPP_
+#define SRC_FRAME_PHASE_HPP_
+
+#include <cstddef>
+
+// phases of the main loop, per-frame measurements are attributed to these
+enum class Frame_phase {
+    input, // polling events, reading keys and cursor
+    update, // camera, matrices, vertex data
+    render, // issuing GL calls
+    present, // swap and frame cap
+    count
+};
+
+constexpr size_t frame_phase_count {static_cast<size_t>(Frame_phase::count)};
+
+constexpr auto phase_name(Frame_phase phase) -> const char*
+{
+    switch (phase) {
+    case Frame_phase::input: return "input";
+    case Frame_phase::update: return "update";
+    case Frame_phase::render: return "render";
+    case Frame_phase::present: return "present";
+    case Frame_phase::count: break;
+    }
+    return "?";
+}
+
+#endif // SRC_FRAME_PHASE_HPP_
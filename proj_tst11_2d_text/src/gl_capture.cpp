@@ -0,0 +1,103 @@
+#include "gl_capture.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "logs.hpp"
+
+namespace {
+    struct Recorder {
+        bool active {false};
+        std::string path;
+        unsigned tgt_frame {0}; // frame to capture
+        unsigned frame {0}; // current frame
+        size_t frame_begin {0}; // stream offset where current frame begins
+        std::vector<uint8_t> stream;
+    };
+
+    Recorder rec;
+
+    auto write_capture() -> bool
+    {
+        std::ofstream out(rec.path, std::ios::out | std::ios::binary);
+        if (!out.is_open()) {
+            logs::err("can not open ", rec.path, " for writing");
+            return false;
+        }
+
+        gl_capture::File_header header {};
+        memcpy(header.magic, gl_capture::file_magic, sizeof(header.magic));
+        header.version = gl_capture::file_version;
+        header.frame_number = rec.tgt_frame;
+        header.setup_size = rec.frame_begin;
+        header.frame_size = rec.stream.size() - rec.frame_begin;
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(
+            reinterpret_cast<const char*>(rec.stream.data()),
+            static_cast<std::streamsize>(rec.stream.size()));
+
+        return out.good();
+    }
+} // namespace
+
+auto gl_capture::start(const std::string& path, unsigned frame) -> void
+{
+    rec.active = true;
+    rec.path = path;
+    // frame 0 also creates all the resources, replaying it in a loop would
+    // keep re-creating them
+    rec.tgt_frame = frame > 0 ? frame : 1;
+    rec.frame = 0;
+    rec.frame_begin = 0;
+    rec.stream.clear();
+
+    logs::info("capturing GL calls of frame ", rec.tgt_frame, " to ", path);
+}
+
+auto gl_capture::is_recording() -> bool
+{
+    return rec.active;
+}
+
+auto gl_capture::end_frame() -> void
+{
+    if (!rec.active) {
+        return;
+    }
+
+    record(Op::end_frame);
+
+    if (rec.frame < rec.tgt_frame) {
+        ++rec.frame;
+        rec.frame_begin = rec.stream.size();
+        return;
+    }
+
+    if (write_capture()) {
+        logs::info(
+            "captured frame ", rec.frame, " (",
+            rec.frame_begin, " bytes setup, ",
+            rec.stream.size() - rec.frame_begin, " bytes frame) to ",
+            rec.path);
+    } else {
+        logs::err("could not write GL capture to ", rec.path);
+    }
+
+    rec.active = false;
+    std::vector<uint8_t>().swap(rec.stream);
+}
+
+auto gl_capture::put_bytes(const void* data, size_t size) -> void
+{
+    const auto* bytes {static_cast<const uint8_t*>(data)};
+    rec.stream.insert(rec.stream.end(), bytes, bytes + size);
+}
+
+auto gl_capture::put_blob(const void* data, size_t size) -> void
+{
+    put(static_cast<uint64_t>(size));
+    put_bytes(data, size);
+}
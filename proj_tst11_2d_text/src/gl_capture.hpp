@@ -0,0 +1,48 @@
+#ifndef SRC_GL_CAPTURE_HPP_
+#define SRC_GL_CAPTURE_HPP_
+
+/*******************************************************************************
+ * GL call-stream recorder.
+ *
+ * Fed by the interception layer (gl_intercept.hpp) when the project is built
+ * with `make CAPTURE=1`. Everything is kept in memory until the requested frame
+ * ends, then the whole stream is written out in one go (layout described in
+ * gl_capture_format.hpp) and recording stops, so the hot path never does I/O.
+ ******************************************************************************/
+
+#include <cstddef>
+#include <string>
+
+#include "gl_capture_format.hpp"
+
+namespace gl_capture {
+    // start recording, the capture is written to `path` once frame number
+    // `frame` (counted from 0) has ended
+    auto start(const std::string& path, unsigned frame) -> void;
+    auto is_recording() -> bool;
+
+    // mark the end of the current frame
+    auto end_frame() -> void;
+
+    // raw bytes appended to the command stream
+    auto put_bytes(const void* data, size_t size) -> void;
+
+    // size prefixed bytes (see "blob" in gl_capture_format.hpp)
+    auto put_blob(const void* data, size_t size) -> void;
+
+    template<typename T>
+    auto put(const T& value) -> void
+    {
+        put_bytes(&value, sizeof(value));
+    }
+
+    // an op followed by its fixed size arguments
+    template<typename... Ts>
+    auto record(Op op, const Ts&... args) -> void
+    {
+        put(op);
+        (put(args), ...);
+    }
+} // namespace gl_capture
+
+#endif // SRC_GL_CAPTURE_HPP_
@@ -0,0 +1,120 @@
+#ifndef SRC_GL_CAPTURE_FORMAT_HPP_
+#define SRC_GL_CAPTURE_FORMAT_HPP_
+
+/*******************************************************************************
+ * On-disk layout of a GL call-stream capture, shared by the recorder
+ * (gl_capture.hpp) and the replayer (tools/gl_replay.cpp).
+ *
+ * A capture file is a File_header followed by two command streams:
+ *  - the setup stream: every intercepted call issued before the captured frame
+ *    (resource creation, uploads, earlier frames), replayed once
+ *  - the frame stream: the calls of the captured frame, replayed in a loop
+ *
+ * Each command is an Op followed by its arguments in host byte order. Buffer,
+ * texture and shader source contents are stored inline right after the call
+ * that referenced them, so a capture is self contained.
+ *
+ * Not recorded: immutable buffer storage, buffer mapping and fence syncs
+ * (glBufferStorage, glMapBufferRange, glUnmapBuffer, gl*Sync), which only
+ * gl_stats counts. Uploads through a mapped pixel buffer could not be replayed
+ * from the stream, so the PBO pool (Pbo_pool.hpp) is not used while a capture
+ * records and texture uploads then go from client memory; the fences only pace
+ * the CPU and the replayer has no use for them. The recorder does not rely on
+ * that: an image upload made while a GL_PIXEL_UNPACK_BUFFER is bound is
+ * recorded without data (has_data 0), the replayer allocates for it or, for a
+ * sub-image, skips it.
+ ******************************************************************************/
+
+#include <cstdint>
+
+namespace gl_capture {
+    constexpr char file_magic[8] {'G', 'L', 'C', 'A', 'P', 'T', 'R', '\0'};
+    constexpr uint32_t file_version {5};
+
+    struct File_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t frame_number; // which frame of the application was captured
+        uint64_t setup_size; // bytes in the setup stream
+        uint64_t frame_size; // bytes in the frame stream
+    };
+
+    /* argument encoding is noted next to each op; "names" are the object
+     * names the application saw, the replayer maps them to its own, "blob" is
+     * a u64 byte count followed by that many bytes (just the count when the
+     * call had no client data, see has_data) */
+    enum class Op : uint16_t {
+        end_frame, // -
+
+        // objects
+        gen_vertex_arrays, // i32 n, u32 names[n]
+        bind_vertex_array, // u32 name
+        gen_buffers, // i32 n, u32 names[n]
+        bind_buffer, // u32 target, u32 name
+        buffer_data, // u32 target, u32 usage, u8 has_data, blob
+        delete_buffers, // i32 n, u32 names[n]
+        gen_textures, // i32 n, u32 names[n]
+        bind_texture, // u32 target, u32 name
+        delete_textures, // i32 n, u32 names[n]
+        active_texture, // u32 unit
+        tex_image_2d, // u32 target, i32 level, i32 ifmt, i32 w, i32 h,
+                      // i32 border, u32 fmt, u32 type, u8 has_data, blob
+        compressed_tex_image_2d, // u32 target, i32 level, u32 ifmt, i32 w,
+                                 // i32 h, i32 border, u8 has_data, blob
+        tex_image_3d, // u32 target, i32 level, i32 ifmt, i32 w, i32 h, i32 d,
+                      // i32 border, u32 fmt, u32 type, u8 has_data, blob
+        compressed_tex_image_3d, // u32 target, i32 level, u32 ifmt, i32 w,
+                                 // i32 h, i32 d, i32 border, u8 has_data,
+                                 // blob
+        tex_sub_image_3d, // u32 target, i32 level, i32 x, i32 y, i32 z,
+                          // i32 w, i32 h, i32 d, u32 fmt, u32 type,
+                          // u8 has_data, blob
+        compressed_tex_sub_image_3d, // u32 target, i32 level, i32 x, i32 y,
+                                     // i32 z, i32 w, i32 h, i32 d, u32 fmt,
+                                     // u8 has_data, blob
+        tex_parameter_i, // u32 target, u32 pname, i32 param
+        generate_mipmap, // u32 target
+        pixel_store_i, // u32 pname, i32 param
+
+        // shaders
+        create_shader, // u32 type, u32 name
+        shader_source, // u32 shader, i32 count, blob[count]
+        compile_shader, // u32 shader
+        delete_shader, // u32 shader
+        create_program, // u32 name
+        attach_shader, // u32 program, u32 shader
+        detach_shader, // u32 program, u32 shader
+        link_program, // u32 program
+        use_program, // u32 program
+        delete_program, // u32 program
+        get_uniform_location, // u32 program, blob name, i32 location
+
+        // fixed function state
+        clear_color, // f32 r, f32 g, f32 b, f32 a
+        clear, // u32 mask
+        enable, // u32 cap
+        disable, // u32 cap
+        depth_func, // u32 func
+        blend_func, // u32 sfactor, u32 dfactor
+        enable_vertex_attrib_array, // u32 index
+        disable_vertex_attrib_array, // u32 index
+        vertex_attrib_pointer, // u32 index, i32 size, u32 type, u8 normalized,
+                               // i32 stride, u64 offset
+
+        // uniforms
+        uniform_1i, // i32 location, i32 v0
+        uniform_1f, // i32 location, f32 v0
+        uniform_2fv, // i32 location, i32 count, f32 values[2 * count]
+        uniform_3fv, // i32 location, i32 count, f32 values[3 * count]
+        uniform_4fv, // i32 location, i32 count, f32 values[4 * count]
+        uniform_matrix_4fv, // i32 location, i32 count, u8 transpose,
+                            // f32 values[16 * count]
+
+        // draws
+        draw_arrays, // u32 mode, i32 first, i32 count
+
+        count
+    };
+} // namespace gl_capture
+
+#endif // SRC_GL_CAPTURE_FORMAT_HPP_
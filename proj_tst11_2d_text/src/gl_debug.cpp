@@ -0,0 +1,153 @@
+#include "gl_debug.hpp"
+
+#include "gl_loader.hpp"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "logs.hpp"
+
+namespace {
+    // source, type, id, severity
+    using Message_key = std::tuple<GLenum, GLenum, GLuint, GLenum>;
+
+    struct Message_count {
+        unsigned count;
+        std::string text; // first occurrence
+    };
+
+    // the callback may come from a driver thread when not synchronous
+    std::mutex seen_mutex;
+    std::map<Message_key, Message_count> seen;
+
+    gl_debug::Severity cur_min_severity {gl_debug::default_severity};
+
+    auto to_severity(GLenum severity) -> gl_debug::Severity
+    {
+        switch (severity) {
+        case GL_DEBUG_SEVERITY_HIGH: return gl_debug::Severity::high;
+        case GL_DEBUG_SEVERITY_MEDIUM: return gl_debug::Severity::medium;
+        case GL_DEBUG_SEVERITY_LOW: return gl_debug::Severity::low;
+        default: return gl_debug::Severity::notification;
+        }
+    }
+
+    auto source_name(GLenum source) -> const char*
+    {
+        switch (source) {
+        case GL_DEBUG_SOURCE_API: return "api";
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+        case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+        case GL_DEBUG_SOURCE_APPLICATION: return "application";
+        default: return "other";
+        }
+    }
+
+    auto type_name(GLenum type) -> const char*
+    {
+        switch (type) {
+        case GL_DEBUG_TYPE_ERROR: return "error";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined behavior";
+        case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+        case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+        case GL_DEBUG_TYPE_MARKER: return "marker";
+        default: return "other";
+        }
+    }
+
+    void APIENTRY on_message(
+        GLenum source, GLenum type, GLuint id, GLenum severity,
+        GLsizei length, const GLchar* message, const void* user_param)
+    {
+        const auto min_severity {
+            *static_cast<const gl_debug::Severity*>(user_param)};
+        const gl_debug::Severity sev {to_severity(severity)};
+        if (sev < min_severity) {
+            return;
+        }
+
+        const std::string text {
+            length < 0 ? std::string(message) : std::string(message, length)};
+        {
+            std::lock_guard<std::mutex> lock(seen_mutex);
+            auto it {seen.find({source, type, id, severity})};
+            if (it != seen.end()) {
+                ++it->second.count;
+                return;
+            }
+            seen.emplace(
+                Message_key{source, type, id, severity},
+                Message_count{1, text});
+        }
+
+        switch (sev) {
+        case gl_debug::Severity::high:
+        case gl_debug::Severity::medium:
+            logs::err(
+                "GL ", source_name(source), " ", type_name(type),
+                " #", id, ": ", text);
+            break;
+        case gl_debug::Severity::low:
+            logs::info(
+                "GL ", source_name(source), " ", type_name(type),
+                " #", id, ": ", text);
+            break;
+        case gl_debug::Severity::notification:
+            DBG(5, "GL ", source_name(source), " ", type_name(type),
+                " #", id, ": ", text);
+            break;
+        }
+    }
+} // namespace
+
+auto gl_debug::init(Severity min_severity) -> bool
+{
+    if (!gl_loader::has("GL_KHR_debug") && !gl_loader::version(4, 3)) {
+        logs::info("GL_KHR_debug not available, GL errors will not be reported");
+        return false;
+    }
+
+    cur_min_severity = min_severity;
+
+    glEnable(GL_DEBUG_OUTPUT);
+#ifdef DEBUG
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+#endif
+    glDebugMessageCallback(on_message, &cur_min_severity);
+
+    // let the driver drop what we would ignore anyway (the callback filters
+    // again, not every driver honours this)
+    glDebugMessageControl(
+        GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+    constexpr GLenum severities[] {
+        GL_DEBUG_SEVERITY_NOTIFICATION,
+        GL_DEBUG_SEVERITY_LOW,
+        GL_DEBUG_SEVERITY_MEDIUM,
+        GL_DEBUG_SEVERITY_HIGH};
+    for (GLenum severity : severities) {
+        if (to_severity(severity) >= min_severity) {
+            glDebugMessageControl(
+                GL_DONT_CARE, GL_DONT_CARE, severity, 0, nullptr, GL_TRUE);
+        }
+    }
+
+    DBG(1, "GL debug output enabled");
+    return true;
+}
+
+auto gl_debug::deinit() -> void
+{
+    std::lock_guard<std::mutex> lock(seen_mutex);
+    for (const auto& entry : seen) {
+        if (entry.second.count > 1) {
+            logs::info(
+                "GL message repeated ", entry.second.count, " times: ",
+                entry.second.text);
+        }
+    }
+    seen.clear();
+}
@@ -0,0 +1,39 @@
+#ifndef SRC_GL_DEBUG_HPP_
+#define SRC_GL_DEBUG_HPP_
+
+/*******************************************************************************
+ * GL error and driver message reporting through GL_KHR_debug.
+ *
+ * Instead of polling glGetError (which forces a sync with the driver on many
+ * implementations) the driver calls back into us. Messages go through `logs`,
+ * anything below the configured severity is dropped and repeats of a message
+ * are only counted (summarised by deinit()).
+ *
+ * Debug builds ask for a debug context and synchronous delivery, so a message
+ * arrives while the offending call is still on the stack. Release builds keep
+ * delivery asynchronous.
+ ******************************************************************************/
+
+namespace gl_debug {
+    enum class Severity {
+        notification,
+        low,
+        medium,
+        high
+    };
+
+#ifdef DEBUG
+    constexpr Severity default_severity {Severity::low};
+#else
+    constexpr Severity default_severity {Severity::medium};
+#endif
+
+    // call right after the context is made current and gl_loader::init() ran,
+    // returns false if GL_KHR_debug is not available
+    auto init(Severity min_severity = default_severity) -> bool;
+
+    // log how often repeated messages were suppressed
+    auto deinit() -> void;
+} // namespace gl_debug
+
+#endif // SRC_GL_DEBUG_HPP_
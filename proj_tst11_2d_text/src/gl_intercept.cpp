@@ -0,0 +1,906 @@
+#define GL_INTERCEPT_IMPL
+#include "gl_intercept.hpp"
+
+#ifdef GL_INTERCEPT_ENABLED
+
+#include "gl_loader.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "gl_capture.hpp"
+#include "gl_stats.hpp"
+#include "program_cache.hpp"
+#include "warmup.hpp"
+
+using gl_capture::Op;
+using gl_stats::Call;
+
+namespace {
+    struct Attrib_pointer {
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+        GLsizei stride;
+        const void* pointer;
+        GLuint buffer; // GL_ARRAY_BUFFER binding when it was specified
+
+        auto operator==(const Attrib_pointer& other) const -> bool
+        {
+            return this->size == other.size
+                && this->type == other.type
+                && this->normalized == other.normalized
+                && this->stride == other.stride
+                && this->pointer == other.pointer
+                && this->buffer == other.buffer;
+        }
+    };
+
+    /* what the GL state is believed to be, only calls made through this layer
+     * are seen, so it is exact only as long as all state changes go through
+     * it (keys combining two values are `high << 32 | low`) */
+    struct Shadow_state {
+        GLuint vertex_array {0};
+        GLuint program {0};
+        GLenum active_texture {GL_TEXTURE0};
+        std::unordered_map<uint64_t, GLuint> buffers; // (vao,) target
+        std::unordered_map<uint64_t, GLuint> textures; // unit, target
+        std::unordered_map<GLenum, bool> caps;
+        GLenum depth_func {GL_LESS};
+        std::array<GLenum, 2> blend_func {GL_ONE, GL_ZERO};
+        std::array<GLfloat, 4> clear_color {0.0f, 0.0f, 0.0f, 0.0f};
+        std::unordered_map<uint64_t, bool> attribs_enabled; // vao, index
+        std::unordered_map<uint64_t, Attrib_pointer> attrib_pointers;
+        std::unordered_map<GLenum, GLint> pixel_store;
+        std::unordered_map<uint64_t, std::string> uniforms; // program, location
+    };
+
+    Shadow_state shadow;
+
+    // of the last draw recorded for the warm-up list, rebuilt only when one of
+    // the calls feeding it changed the state since
+    warmup::Combination last_combination;
+    bool combination_dirty {true};
+
+    GLint unpack_alignment {4}; // mirrors GL_UNPACK_ALIGNMENT
+
+    inline auto recording() -> bool
+    {
+#ifdef GL_CAPTURE
+        return gl_capture::is_recording();
+#else
+        return false;
+#endif
+    }
+
+    inline auto key(uint64_t high, uint64_t low) -> uint64_t
+    {
+        return high << 32u | (low & 0xffffffffu);
+    }
+
+    // sets `cur` to `value`, returns false if it already was
+    template<typename T>
+    auto update(T& cur, const T& value) -> bool
+    {
+        if (cur == value) {
+            return false;
+        }
+        cur = value;
+        return true;
+    }
+
+    template<typename K, typename T>
+    auto update(std::unordered_map<K, T>& map, const K& k, const T& value)
+        -> bool
+    {
+        auto it {map.find(k)};
+        if (it == map.end()) {
+            map.emplace(k, value);
+            return true;
+        }
+        return update(it->second, value);
+    }
+
+    auto buffer_key(GLenum target) -> uint64_t
+    {
+        // the element array binding is part of the vertex array object
+        return target == GL_ELEMENT_ARRAY_BUFFER
+            ? key(shadow.vertex_array, target)
+            : target;
+    }
+
+    // uniform values are program state, compared byte for byte
+    auto update_uniform(GLint location, const void* value, size_t size) -> bool
+    {
+        if (location < 0) {
+            return true;
+        }
+        return update(
+            shadow.uniforms,
+            key(shadow.program, static_cast<uint64_t>(location)),
+            std::string(static_cast<const char*>(value), size));
+    }
+
+    // passes `changed` through, noting that the next draw's combination must
+    // be rebuilt
+    auto draw_state(bool changed) -> bool
+    {
+        combination_dirty = combination_dirty || changed;
+        return changed;
+    }
+
+    auto enabled(GLenum cap) -> bool
+    {
+        const auto it {shadow.caps.find(cap)};
+        return it != shadow.caps.end() && it->second;
+    }
+
+    // the state a draw with `mode` is made with, for the warm-up list
+    auto combination(GLenum mode) -> warmup::Combination
+    {
+        constexpr GLuint max_attribs {16}; // the minimum GL guarantees
+
+        warmup::Combination c;
+        c.program = program_cache::key_of(shadow.program);
+        c.mode = mode;
+        for (GLuint index {0}; index < max_attribs; ++index) {
+            const uint64_t k {key(shadow.vertex_array, index)};
+            const auto on {shadow.attribs_enabled.find(k)};
+            const auto ptr {shadow.attrib_pointers.find(k)};
+            if (on == shadow.attribs_enabled.end() || !on->second
+                || ptr == shadow.attrib_pointers.end()) {
+                continue;
+            }
+            const Attrib_pointer& a {ptr->second};
+            c.attribs.push_back(warmup::Attrib{
+                index, a.size, a.type, a.normalized, a.stride});
+        }
+        c.blend = enabled(GL_BLEND);
+        c.blend_func = shadow.blend_func;
+        c.depth_test = enabled(GL_DEPTH_TEST);
+        c.depth_func = shadow.depth_func;
+        c.cull_face = enabled(GL_CULL_FACE);
+        return c;
+    }
+
+    auto stats(Call call, bool changed, const char* name) -> void
+    {
+#ifdef GL_STATS
+        gl_stats::count(call);
+        if (!changed) {
+            gl_stats::count_redundant(name);
+        }
+#else
+        static_cast<void>(call);
+        static_cast<void>(changed);
+        static_cast<void>(name);
+#endif
+    }
+
+    auto stats_upload(size_t bytes) -> void
+    {
+#ifdef GL_STATS
+        gl_stats::count_upload(bytes);
+#else
+        static_cast<void>(bytes);
+#endif
+    }
+
+    // bytes glTex(Sub)Image{2,3}D read from client memory
+    auto tex_image_size(
+        GLsizei width, GLsizei height, GLsizei depth, GLenum format,
+        GLenum type) -> size_t
+    {
+        size_t components {4};
+        switch (format) {
+        case GL_RED: components = 1; break;
+        case GL_RG: components = 2; break;
+        case GL_RGB:
+        case GL_BGR: components = 3; break;
+        default: break;
+        }
+
+        size_t component_size {1};
+        switch (type) {
+        case GL_UNSIGNED_SHORT:
+        case GL_SHORT:
+        case GL_HALF_FLOAT: component_size = 2; break;
+        case GL_UNSIGNED_INT:
+        case GL_INT:
+        case GL_FLOAT: component_size = 4; break;
+        default: break;
+        }
+
+        const auto align {static_cast<size_t>(unpack_alignment)};
+        size_t row {static_cast<size_t>(width) * components * component_size};
+        row = (row + align - 1) / align * align;
+
+        return row * static_cast<size_t>(height)
+            * static_cast<size_t>(depth);
+    }
+
+    /* client data, or just its size when there is none: an allocation, or a
+     * pixel unpack buffer is bound and `data` is an offset into it (what was
+     * written into the buffer is not recorded, see gl_capture_format.hpp) */
+    auto put_data(const void* data, size_t size) -> void
+    {
+        GLint unpack_buffer {0};
+        glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpack_buffer);
+        const bool client {data != nullptr && unpack_buffer == 0};
+        gl_capture::put(static_cast<uint8_t>(client));
+        if (client) {
+            gl_capture::put_blob(data, size);
+        } else {
+            gl_capture::put(static_cast<uint64_t>(size));
+        }
+    }
+
+    auto record_names(Op op, GLsizei n, const GLuint* names) -> void
+    {
+        gl_capture::record(op, static_cast<int32_t>(n));
+        gl_capture::put_bytes(names, sizeof(GLuint) * static_cast<size_t>(n));
+    }
+
+    // glUniform{2,3,4}fv, `size` floats per element
+    auto uniform_fv(
+        Op op, const char* name, GLint location, GLsizei count,
+        const GLfloat* value, size_t size) -> void
+    {
+        const size_t bytes {
+            sizeof(GLfloat) * size * static_cast<size_t>(count)};
+        stats(Call::uniform, update_uniform(location, value, bytes), name);
+        if (recording()) {
+            gl_capture::record(op, location, static_cast<int32_t>(count));
+            gl_capture::put_bytes(value, bytes);
+        }
+    }
+} // namespace
+
+auto gl_intercept::end_frame() -> void
+{
+#ifdef GL_CAPTURE
+    gl_capture::end_frame();
+#endif
+#ifdef GL_STATS
+    gl_stats::end_frame();
+#endif
+}
+
+// objects ---------------------------------------------------------------------
+
+auto gl_intercept::gen_vertex_arrays(GLsizei n, GLuint* arrays) -> void
+{
+    stats(Call::object, true, "glGenVertexArrays");
+    glGenVertexArrays(n, arrays);
+    if (recording()) {
+        record_names(Op::gen_vertex_arrays, n, arrays);
+    }
+}
+
+auto gl_intercept::bind_vertex_array(GLuint array) -> void
+{
+    stats(
+        Call::bind,
+        draw_state(update(shadow.vertex_array, array)),
+        "glBindVertexArray");
+    if (recording()) {
+        gl_capture::record(Op::bind_vertex_array, array);
+    }
+    glBindVertexArray(array);
+}
+
+auto gl_intercept::gen_buffers(GLsizei n, GLuint* buffers) -> void
+{
+    stats(Call::object, true, "glGenBuffers");
+    glGenBuffers(n, buffers);
+    if (recording()) {
+        record_names(Op::gen_buffers, n, buffers);
+    }
+}
+
+auto gl_intercept::bind_buffer(GLenum target, GLuint buffer) -> void
+{
+    stats(
+        Call::bind,
+        update(shadow.buffers, buffer_key(target), buffer),
+        "glBindBuffer");
+    if (recording()) {
+        gl_capture::record(Op::bind_buffer, target, buffer);
+    }
+    glBindBuffer(target, buffer);
+}
+
+auto gl_intercept::buffer_data(
+    GLenum target, GLsizeiptr size, const void* data, GLenum usage) -> void
+{
+    stats_upload(static_cast<size_t>(size));
+    if (recording()) {
+        gl_capture::record(
+            Op::buffer_data, target, usage,
+            static_cast<uint8_t>(data != nullptr));
+        if (data != nullptr) {
+            gl_capture::put_blob(data, static_cast<size_t>(size));
+        } else {
+            gl_capture::put(static_cast<uint64_t>(size));
+        }
+    }
+    glBufferData(target, size, data, usage);
+}
+
+auto gl_intercept::delete_buffers(GLsizei n, const GLuint* buffers) -> void
+{
+    stats(Call::object, true, "glDeleteBuffers");
+    // deleting a bound buffer unbinds it
+    for (GLsizei i {0}; i < n; ++i) {
+        for (auto& binding : shadow.buffers) {
+            if (binding.second == buffers[i]) {
+                binding.second = 0;
+            }
+        }
+    }
+    if (recording()) {
+        record_names(Op::delete_buffers, n, buffers);
+    }
+    glDeleteBuffers(n, buffers);
+}
+
+// storage, mapping and syncs are not in the capture format: the PBO pool
+// stands aside while a capture records
+
+auto gl_intercept::buffer_storage(
+    GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) -> void
+{
+    stats_upload(static_cast<size_t>(size));
+    glBufferStorage(target, size, data, flags);
+}
+
+auto gl_intercept::map_buffer_range(
+    GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+    -> void*
+{
+    stats(Call::sync, true, "glMapBufferRange");
+    return glMapBufferRange(target, offset, length, access);
+}
+
+auto gl_intercept::unmap_buffer(GLenum target) -> GLboolean
+{
+    stats(Call::sync, true, "glUnmapBuffer");
+    return glUnmapBuffer(target);
+}
+
+auto gl_intercept::gen_textures(GLsizei n, GLuint* textures) -> void
+{
+    stats(Call::object, true, "glGenTextures");
+    glGenTextures(n, textures);
+    if (recording()) {
+        record_names(Op::gen_textures, n, textures);
+    }
+}
+
+auto gl_intercept::bind_texture(GLenum target, GLuint texture) -> void
+{
+    stats(
+        Call::bind,
+        update(shadow.textures, key(shadow.active_texture, target), texture),
+        "glBindTexture");
+    if (recording()) {
+        gl_capture::record(Op::bind_texture, target, texture);
+    }
+    glBindTexture(target, texture);
+}
+
+auto gl_intercept::delete_textures(GLsizei n, const GLuint* textures) -> void
+{
+    stats(Call::object, true, "glDeleteTextures");
+    // deleting a bound texture unbinds it
+    for (GLsizei i {0}; i < n; ++i) {
+        for (auto& binding : shadow.textures) {
+            if (binding.second == textures[i]) {
+                binding.second = 0;
+            }
+        }
+    }
+    if (recording()) {
+        record_names(Op::delete_textures, n, textures);
+    }
+    glDeleteTextures(n, textures);
+}
+
+auto gl_intercept::active_texture(GLenum texture) -> void
+{
+    stats(
+        Call::bind,
+        update(shadow.active_texture, texture),
+        "glActiveTexture");
+    if (recording()) {
+        gl_capture::record(Op::active_texture, texture);
+    }
+    glActiveTexture(texture);
+}
+
+auto gl_intercept::tex_image_2d(
+    GLenum target, GLint level, GLint internal_format,
+    GLsizei width, GLsizei height, GLint border,
+    GLenum format, GLenum type, const void* pixels) -> void
+{
+    const size_t size {tex_image_size(width, height, 1, format, type)};
+    stats_upload(size);
+    if (recording()) {
+        gl_capture::record(
+            Op::tex_image_2d, target, level, internal_format,
+            width, height, border, format, type);
+        put_data(pixels, size);
+    }
+    glTexImage2D(
+        target, level, internal_format,
+        width, height, border, format, type, pixels);
+}
+
+auto gl_intercept::compressed_tex_image_2d(
+    GLenum target, GLint level, GLenum internal_format,
+    GLsizei width, GLsizei height, GLint border,
+    GLsizei image_size, const void* data) -> void
+{
+    stats_upload(static_cast<size_t>(image_size));
+    if (recording()) {
+        gl_capture::record(
+            Op::compressed_tex_image_2d, target, level, internal_format,
+            width, height, border);
+        put_data(data, static_cast<size_t>(image_size));
+    }
+    glCompressedTexImage2D(
+        target, level, internal_format,
+        width, height, border, image_size, data);
+}
+
+auto gl_intercept::tex_image_3d(
+    GLenum target, GLint level, GLint internal_format,
+    GLsizei width, GLsizei height, GLsizei depth, GLint border,
+    GLenum format, GLenum type, const void* pixels) -> void
+{
+    const size_t size {tex_image_size(width, height, depth, format, type)};
+    stats_upload(size);
+    if (recording()) {
+        gl_capture::record(
+            Op::tex_image_3d, target, level, internal_format,
+            width, height, depth, border, format, type);
+        put_data(pixels, size);
+    }
+    glTexImage3D(
+        target, level, internal_format,
+        width, height, depth, border, format, type, pixels);
+}
+
+auto gl_intercept::compressed_tex_image_3d(
+    GLenum target, GLint level, GLenum internal_format,
+    GLsizei width, GLsizei height, GLsizei depth, GLint border,
+    GLsizei image_size, const void* data) -> void
+{
+    stats_upload(static_cast<size_t>(image_size));
+    if (recording()) {
+        gl_capture::record(
+            Op::compressed_tex_image_3d, target, level, internal_format,
+            width, height, depth, border);
+        put_data(data, static_cast<size_t>(image_size));
+    }
+    glCompressedTexImage3D(
+        target, level, internal_format,
+        width, height, depth, border, image_size, data);
+}
+
+auto gl_intercept::tex_sub_image_3d(
+    GLenum target, GLint level, GLint x, GLint y, GLint z,
+    GLsizei width, GLsizei height, GLsizei depth,
+    GLenum format, GLenum type, const void* pixels) -> void
+{
+    const size_t size {tex_image_size(width, height, depth, format, type)};
+    stats_upload(size);
+    if (recording()) {
+        gl_capture::record(
+            Op::tex_sub_image_3d, target, level, x, y, z,
+            width, height, depth, format, type);
+        put_data(pixels, size);
+    }
+    glTexSubImage3D(
+        target, level, x, y, z, width, height, depth, format, type, pixels);
+}
+
+auto gl_intercept::compressed_tex_sub_image_3d(
+    GLenum target, GLint level, GLint x, GLint y, GLint z,
+    GLsizei width, GLsizei height, GLsizei depth,
+    GLenum format, GLsizei image_size, const void* data) -> void
+{
+    stats_upload(static_cast<size_t>(image_size));
+    if (recording()) {
+        gl_capture::record(
+            Op::compressed_tex_sub_image_3d, target, level, x, y, z,
+            width, height, depth, format);
+        put_data(data, static_cast<size_t>(image_size));
+    }
+    glCompressedTexSubImage3D(
+        target, level, x, y, z, width, height, depth, format, image_size,
+        data);
+}
+
+auto gl_intercept::tex_parameter_i(
+    GLenum target, GLenum pname, GLint param) -> void
+{
+    stats(Call::state, true, "glTexParameteri");
+    if (recording()) {
+        gl_capture::record(Op::tex_parameter_i, target, pname, param);
+    }
+    glTexParameteri(target, pname, param);
+}
+
+auto gl_intercept::generate_mipmap(GLenum target) -> void
+{
+    stats_upload(0);
+    if (recording()) {
+        gl_capture::record(Op::generate_mipmap, target);
+    }
+    glGenerateMipmap(target);
+}
+
+auto gl_intercept::pixel_store_i(GLenum pname, GLint param) -> void
+{
+    stats(
+        Call::state,
+        update(shadow.pixel_store, pname, param),
+        "glPixelStorei");
+    if (pname == GL_UNPACK_ALIGNMENT) {
+        unpack_alignment = param;
+    }
+    if (recording()) {
+        gl_capture::record(Op::pixel_store_i, pname, param);
+    }
+    glPixelStorei(pname, param);
+}
+
+// shaders ---------------------------------------------------------------------
+
+auto gl_intercept::create_shader(GLenum type) -> GLuint
+{
+    stats(Call::object, true, "glCreateShader");
+    GLuint shader {glCreateShader(type)};
+    if (recording()) {
+        gl_capture::record(Op::create_shader, type, shader);
+    }
+    return shader;
+}
+
+auto gl_intercept::shader_source(
+    GLuint shader, GLsizei count,
+    const GLchar* const* strings, const GLint* lengths) -> void
+{
+    stats(Call::object, true, "glShaderSource");
+    if (recording()) {
+        gl_capture::record(
+            Op::shader_source, shader, static_cast<int32_t>(count));
+        for (GLsizei i {0}; i < count; ++i) {
+            const bool terminated {lengths == nullptr || lengths[i] < 0};
+            gl_capture::put_blob(
+                strings[i],
+                terminated ? strlen(strings[i]) : static_cast<size_t>(lengths[i]));
+        }
+    }
+    glShaderSource(shader, count, strings, lengths);
+}
+
+auto gl_intercept::compile_shader(GLuint shader) -> void
+{
+    stats(Call::object, true, "glCompileShader");
+    if (recording()) {
+        gl_capture::record(Op::compile_shader, shader);
+    }
+    glCompileShader(shader);
+}
+
+auto gl_intercept::delete_shader(GLuint shader) -> void
+{
+    stats(Call::object, true, "glDeleteShader");
+    if (recording()) {
+        gl_capture::record(Op::delete_shader, shader);
+    }
+    glDeleteShader(shader);
+}
+
+auto gl_intercept::create_program() -> GLuint
+{
+    stats(Call::object, true, "glCreateProgram");
+    GLuint program {glCreateProgram()};
+    if (recording()) {
+        gl_capture::record(Op::create_program, program);
+    }
+    return program;
+}
+
+auto gl_intercept::attach_shader(GLuint program, GLuint shader) -> void
+{
+    stats(Call::object, true, "glAttachShader");
+    if (recording()) {
+        gl_capture::record(Op::attach_shader, program, shader);
+    }
+    glAttachShader(program, shader);
+}
+
+auto gl_intercept::detach_shader(GLuint program, GLuint shader) -> void
+{
+    stats(Call::object, true, "glDetachShader");
+    if (recording()) {
+        gl_capture::record(Op::detach_shader, program, shader);
+    }
+    glDetachShader(program, shader);
+}
+
+auto gl_intercept::link_program(GLuint program) -> void
+{
+    stats(Call::object, draw_state(true), "glLinkProgram");
+    // linking resets all uniforms to their defaults
+    for (auto it {shadow.uniforms.begin()}; it != shadow.uniforms.end();) {
+        it = (it->first >> 32u) == program ? shadow.uniforms.erase(it) : ++it;
+    }
+    if (recording()) {
+        gl_capture::record(Op::link_program, program);
+    }
+    glLinkProgram(program);
+}
+
+auto gl_intercept::use_program(GLuint program) -> void
+{
+    stats(
+        Call::bind, draw_state(update(shadow.program, program)),
+        "glUseProgram");
+    if (recording()) {
+        gl_capture::record(Op::use_program, program);
+    }
+    glUseProgram(program);
+}
+
+auto gl_intercept::delete_program(GLuint program) -> void
+{
+    stats(Call::object, true, "glDeleteProgram");
+    if (recording()) {
+        gl_capture::record(Op::delete_program, program);
+    }
+    glDeleteProgram(program);
+}
+
+auto gl_intercept::get_uniform_location(
+    GLuint program, const GLchar* name) -> GLint
+{
+    stats(Call::object, true, "glGetUniformLocation");
+    GLint location {glGetUniformLocation(program, name)};
+    if (recording()) {
+        gl_capture::record(Op::get_uniform_location, program);
+        gl_capture::put_blob(name, strlen(name));
+        gl_capture::put(location);
+    }
+    return location;
+}
+
+// fixed function state --------------------------------------------------------
+
+auto gl_intercept::clear_color(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+    -> void
+{
+    stats(
+        Call::state,
+        update(shadow.clear_color, {r, g, b, a}),
+        "glClearColor");
+    if (recording()) {
+        gl_capture::record(Op::clear_color, r, g, b, a);
+    }
+    glClearColor(r, g, b, a);
+}
+
+auto gl_intercept::clear(GLbitfield mask) -> void
+{
+    stats(Call::clear, true, "glClear");
+    if (recording()) {
+        gl_capture::record(Op::clear, mask);
+    }
+    glClear(mask);
+}
+
+auto gl_intercept::enable(GLenum cap) -> void
+{
+    stats(Call::state, draw_state(update(shadow.caps, cap, true)), "glEnable");
+    if (recording()) {
+        gl_capture::record(Op::enable, cap);
+    }
+    glEnable(cap);
+}
+
+auto gl_intercept::disable(GLenum cap) -> void
+{
+    stats(
+        Call::state, draw_state(update(shadow.caps, cap, false)), "glDisable");
+    if (recording()) {
+        gl_capture::record(Op::disable, cap);
+    }
+    glDisable(cap);
+}
+
+auto gl_intercept::depth_func(GLenum func) -> void
+{
+    stats(
+        Call::state, draw_state(update(shadow.depth_func, func)),
+        "glDepthFunc");
+    if (recording()) {
+        gl_capture::record(Op::depth_func, func);
+    }
+    glDepthFunc(func);
+}
+
+auto gl_intercept::blend_func(GLenum sfactor, GLenum dfactor) -> void
+{
+    stats(
+        Call::state,
+        draw_state(update(shadow.blend_func, {sfactor, dfactor})),
+        "glBlendFunc");
+    if (recording()) {
+        gl_capture::record(Op::blend_func, sfactor, dfactor);
+    }
+    glBlendFunc(sfactor, dfactor);
+}
+
+auto gl_intercept::enable_vertex_attrib_array(GLuint index) -> void
+{
+    stats(
+        Call::state,
+        draw_state(update(
+            shadow.attribs_enabled, key(shadow.vertex_array, index), true)),
+        "glEnableVertexAttribArray");
+    if (recording()) {
+        gl_capture::record(Op::enable_vertex_attrib_array, index);
+    }
+    glEnableVertexAttribArray(index);
+}
+
+auto gl_intercept::disable_vertex_attrib_array(GLuint index) -> void
+{
+    stats(
+        Call::state,
+        draw_state(update(
+            shadow.attribs_enabled, key(shadow.vertex_array, index), false)),
+        "glDisableVertexAttribArray");
+    if (recording()) {
+        gl_capture::record(Op::disable_vertex_attrib_array, index);
+    }
+    glDisableVertexAttribArray(index);
+}
+
+auto gl_intercept::vertex_attrib_pointer(
+    GLuint index, GLint size, GLenum type, GLboolean normalized,
+    GLsizei stride, const void* pointer) -> void
+{
+    const Attrib_pointer attrib {
+        size, type, normalized, stride, pointer,
+        shadow.buffers[GL_ARRAY_BUFFER]};
+    stats(
+        Call::state,
+        draw_state(update(
+            shadow.attrib_pointers, key(shadow.vertex_array, index), attrib)),
+        "glVertexAttribPointer");
+    if (recording()) {
+        // core profile, so the pointer is always an offset into a buffer
+        gl_capture::record(
+            Op::vertex_attrib_pointer, index, size, type,
+            static_cast<uint8_t>(normalized), stride,
+            static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pointer)));
+    }
+    glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+// uniforms --------------------------------------------------------------------
+
+auto gl_intercept::uniform_1i(GLint location, GLint v0) -> void
+{
+    stats(
+        Call::uniform,
+        update_uniform(location, &v0, sizeof(v0)),
+        "glUniform1i");
+    if (recording()) {
+        gl_capture::record(Op::uniform_1i, location, v0);
+    }
+    glUniform1i(location, v0);
+}
+
+auto gl_intercept::uniform_1f(GLint location, GLfloat v0) -> void
+{
+    stats(
+        Call::uniform,
+        update_uniform(location, &v0, sizeof(v0)),
+        "glUniform1f");
+    if (recording()) {
+        gl_capture::record(Op::uniform_1f, location, v0);
+    }
+    glUniform1f(location, v0);
+}
+
+auto gl_intercept::uniform_2fv(
+    GLint location, GLsizei count, const GLfloat* value) -> void
+{
+    uniform_fv(Op::uniform_2fv, "glUniform2fv", location, count, value, 2);
+    glUniform2fv(location, count, value);
+}
+
+auto gl_intercept::uniform_3fv(
+    GLint location, GLsizei count, const GLfloat* value) -> void
+{
+    uniform_fv(Op::uniform_3fv, "glUniform3fv", location, count, value, 3);
+    glUniform3fv(location, count, value);
+}
+
+auto gl_intercept::uniform_4fv(
+    GLint location, GLsizei count, const GLfloat* value) -> void
+{
+    uniform_fv(Op::uniform_4fv, "glUniform4fv", location, count, value, 4);
+    glUniform4fv(location, count, value);
+}
+
+auto gl_intercept::uniform_matrix_4fv(
+    GLint location, GLsizei count,
+    GLboolean transpose, const GLfloat* value) -> void
+{
+    stats(
+        Call::uniform,
+        update_uniform(
+            location, value, sizeof(GLfloat) * 16 * static_cast<size_t>(count)),
+        "glUniformMatrix4fv");
+    if (recording()) {
+        gl_capture::record(
+            Op::uniform_matrix_4fv, location, static_cast<int32_t>(count),
+            static_cast<uint8_t>(transpose));
+        gl_capture::put_bytes(
+            value, sizeof(GLfloat) * 16 * static_cast<size_t>(count));
+    }
+    glUniformMatrix4fv(location, count, transpose, value);
+}
+
+// draws -----------------------------------------------------------------------
+
+auto gl_intercept::draw_arrays(GLenum mode, GLint first, GLsizei count) -> void
+{
+    stats(Call::draw, true, "glDrawArrays");
+    if (recording()) {
+        gl_capture::record(Op::draw_arrays, mode, first, count);
+    }
+    if (warmup::recording()
+        && (combination_dirty || mode != last_combination.mode)) {
+        warmup::Combination c {combination(mode)};
+        if (!(c == last_combination)) {
+            warmup::seen(c);
+            last_combination = std::move(c);
+        }
+        combination_dirty = false;
+    }
+    glDrawArrays(mode, first, count);
+}
+
+// synchronization -------------------------------------------------------------
+
+auto gl_intercept::fence_sync(GLenum condition, GLbitfield flags) -> GLsync
+{
+    stats(Call::sync, true, "glFenceSync");
+    return glFenceSync(condition, flags);
+}
+
+auto gl_intercept::client_wait_sync(
+    GLsync sync, GLbitfield flags, GLuint64 timeout) -> GLenum
+{
+    stats(Call::sync, true, "glClientWaitSync");
+    return glClientWaitSync(sync, flags, timeout);
+}
+
+auto gl_intercept::delete_sync(GLsync sync) -> void
+{
+    stats(Call::sync, true, "glDeleteSync");
+    glDeleteSync(sync);
+}
+
+#endif // GL_INTERCEPT_ENABLED
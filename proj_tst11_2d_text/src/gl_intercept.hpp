@@ -0,0 +1,244 @@
+#ifndef SRC_GL_INTERCEPT_HPP_
+#define SRC_GL_INTERCEPT_HPP_
+
+/*******************************************************************************
+ * Interception of the GL entry points used by this project.
+ *
+ * Include this header *last* in every source file that issues GL calls. When
+ * interception is compiled in (debug builds and `make CAPTURE=1`) the gl* names
+ * listed below are redirected to the wrappers in `gl_intercept`, which update
+ * the call counters (gl_stats.hpp), hand the call to the recorder
+ * (gl_capture.hpp) and then forward it to the driver. Otherwise only a no-op
+ * end_frame() is left and the GL calls go straight to the driver.
+ *
+ * Calls without side effects (glGet*, glGetError, ...) are never intercepted.
+ ******************************************************************************/
+
+#include "gl_loader.hpp"
+
+#include "gl_stats.hpp" // GL_STATS
+
+#if defined(GL_CAPTURE) || defined(GL_STATS)
+#   define GL_INTERCEPT_ENABLED
+#endif
+
+namespace gl_intercept {
+#ifdef GL_INTERCEPT_ENABLED
+    // mark the end of a frame, call once per frame right after the swap
+    auto end_frame() -> void;
+
+    // objects
+    auto gen_vertex_arrays(GLsizei n, GLuint* arrays) -> void;
+    auto bind_vertex_array(GLuint array) -> void;
+    auto gen_buffers(GLsizei n, GLuint* buffers) -> void;
+    auto bind_buffer(GLenum target, GLuint buffer) -> void;
+    auto buffer_data(
+        GLenum target, GLsizeiptr size, const void* data, GLenum usage) -> void;
+    auto delete_buffers(GLsizei n, const GLuint* buffers) -> void;
+    auto buffer_storage(
+        GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+        -> void;
+    auto map_buffer_range(
+        GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+        -> void*;
+    auto unmap_buffer(GLenum target) -> GLboolean;
+    auto gen_textures(GLsizei n, GLuint* textures) -> void;
+    auto bind_texture(GLenum target, GLuint texture) -> void;
+    auto delete_textures(GLsizei n, const GLuint* textures) -> void;
+    auto active_texture(GLenum texture) -> void;
+    auto tex_image_2d(
+        GLenum target, GLint level, GLint internal_format,
+        GLsizei width, GLsizei height, GLint border,
+        GLenum format, GLenum type, const void* pixels) -> void;
+    auto compressed_tex_image_2d(
+        GLenum target, GLint level, GLenum internal_format,
+        GLsizei width, GLsizei height, GLint border,
+        GLsizei image_size, const void* data) -> void;
+    auto tex_image_3d(
+        GLenum target, GLint level, GLint internal_format,
+        GLsizei width, GLsizei height, GLsizei depth, GLint border,
+        GLenum format, GLenum type, const void* pixels) -> void;
+    auto compressed_tex_image_3d(
+        GLenum target, GLint level, GLenum internal_format,
+        GLsizei width, GLsizei height, GLsizei depth, GLint border,
+        GLsizei image_size, const void* data) -> void;
+    auto tex_sub_image_3d(
+        GLenum target, GLint level, GLint x, GLint y, GLint z,
+        GLsizei width, GLsizei height, GLsizei depth,
+        GLenum format, GLenum type, const void* pixels) -> void;
+    auto compressed_tex_sub_image_3d(
+        GLenum target, GLint level, GLint x, GLint y, GLint z,
+        GLsizei width, GLsizei height, GLsizei depth,
+        GLenum format, GLsizei image_size, const void* data) -> void;
+    auto tex_parameter_i(GLenum target, GLenum pname, GLint param) -> void;
+    auto generate_mipmap(GLenum target) -> void;
+    auto pixel_store_i(GLenum pname, GLint param) -> void;
+
+    // shaders
+    auto create_shader(GLenum type) -> GLuint;
+    auto shader_source(
+        GLuint shader, GLsizei count,
+        const GLchar* const* strings, const GLint* lengths) -> void;
+    auto compile_shader(GLuint shader) -> void;
+    auto delete_shader(GLuint shader) -> void;
+    auto create_program() -> GLuint;
+    auto attach_shader(GLuint program, GLuint shader) -> void;
+    auto detach_shader(GLuint program, GLuint shader) -> void;
+    auto link_program(GLuint program) -> void;
+    auto use_program(GLuint program) -> void;
+    auto delete_program(GLuint program) -> void;
+    auto get_uniform_location(GLuint program, const GLchar* name) -> GLint;
+
+    // fixed function state
+    auto clear_color(GLfloat r, GLfloat g, GLfloat b, GLfloat a) -> void;
+    auto clear(GLbitfield mask) -> void;
+    auto enable(GLenum cap) -> void;
+    auto disable(GLenum cap) -> void;
+    auto depth_func(GLenum func) -> void;
+    auto blend_func(GLenum sfactor, GLenum dfactor) -> void;
+    auto enable_vertex_attrib_array(GLuint index) -> void;
+    auto disable_vertex_attrib_array(GLuint index) -> void;
+    auto vertex_attrib_pointer(
+        GLuint index, GLint size, GLenum type, GLboolean normalized,
+        GLsizei stride, const void* pointer) -> void;
+
+    // uniforms
+    auto uniform_1i(GLint location, GLint v0) -> void;
+    auto uniform_1f(GLint location, GLfloat v0) -> void;
+    auto uniform_2fv(GLint location, GLsizei count, const GLfloat* value)
+        -> void;
+    auto uniform_3fv(GLint location, GLsizei count, const GLfloat* value)
+        -> void;
+    auto uniform_4fv(GLint location, GLsizei count, const GLfloat* value)
+        -> void;
+    auto uniform_matrix_4fv(
+        GLint location, GLsizei count,
+        GLboolean transpose, const GLfloat* value) -> void;
+
+    // draws
+    auto draw_arrays(GLenum mode, GLint first, GLsizei count) -> void;
+
+    // synchronization, counted but not captured (see gl_capture_format.hpp)
+    auto fence_sync(GLenum condition, GLbitfield flags) -> GLsync;
+    auto client_wait_sync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+        -> GLenum;
+    auto delete_sync(GLsync sync) -> void;
+#else
+    inline auto end_frame() -> void {}
+#endif
+} // namespace gl_intercept
+
+// the implementation needs the real entry points
+#if defined(GL_INTERCEPT_ENABLED) && !defined(GL_INTERCEPT_IMPL)
+#   undef glGenVertexArrays
+#   define glGenVertexArrays gl_intercept::gen_vertex_arrays
+#   undef glBindVertexArray
+#   define glBindVertexArray gl_intercept::bind_vertex_array
+#   undef glGenBuffers
+#   define glGenBuffers gl_intercept::gen_buffers
+#   undef glBindBuffer
+#   define glBindBuffer gl_intercept::bind_buffer
+#   undef glBufferData
+#   define glBufferData gl_intercept::buffer_data
+#   undef glDeleteBuffers
+#   define glDeleteBuffers gl_intercept::delete_buffers
+#   undef glBufferStorage
+#   define glBufferStorage gl_intercept::buffer_storage
+#   undef glMapBufferRange
+#   define glMapBufferRange gl_intercept::map_buffer_range
+#   undef glUnmapBuffer
+#   define glUnmapBuffer gl_intercept::unmap_buffer
+#   undef glGenTextures
+#   define glGenTextures gl_intercept::gen_textures
+#   undef glBindTexture
+#   define glBindTexture gl_intercept::bind_texture
+#   undef glDeleteTextures
+#   define glDeleteTextures gl_intercept::delete_textures
+#   undef glActiveTexture
+#   define glActiveTexture gl_intercept::active_texture
+#   undef glTexImage2D
+#   define glTexImage2D gl_intercept::tex_image_2d
+#   undef glCompressedTexImage2D
+#   define glCompressedTexImage2D gl_intercept::compressed_tex_image_2d
+#   undef glTexImage3D
+#   define glTexImage3D gl_intercept::tex_image_3d
+#   undef glCompressedTexImage3D
+#   define glCompressedTexImage3D gl_intercept::compressed_tex_image_3d
+#   undef glTexSubImage3D
+#   define glTexSubImage3D gl_intercept::tex_sub_image_3d
+#   undef glCompressedTexSubImage3D
+#   define glCompressedTexSubImage3D gl_intercept::compressed_tex_sub_image_3d
+#   undef glTexParameteri
+#   define glTexParameteri gl_intercept::tex_parameter_i
+#   undef glGenerateMipmap
+#   define glGenerateMipmap gl_intercept::generate_mipmap
+#   undef glPixelStorei
+#   define glPixelStorei gl_intercept::pixel_store_i
+
+#   undef glCreateShader
+#   define glCreateShader gl_intercept::create_shader
+#   undef glShaderSource
+#   define glShaderSource gl_intercept::shader_source
+#   undef glCompileShader
+#   define glCompileShader gl_intercept::compile_shader
+#   undef glDeleteShader
+#   define glDeleteShader gl_intercept::delete_shader
+#   undef glCreateProgram
+#   define glCreateProgram gl_intercept::create_program
+#   undef glAttachShader
+#   define glAttachShader gl_intercept::attach_shader
+#   undef glDetachShader
+#   define glDetachShader gl_intercept::detach_shader
+#   undef glLinkProgram
+#   define glLinkProgram gl_intercept::link_program
+#   undef glUseProgram
+#   define glUseProgram gl_intercept::use_program
+#   undef glDeleteProgram
+#   define glDeleteProgram gl_intercept::delete_program
+#   undef glGetUniformLocation
+#   define glGetUniformLocation gl_intercept::get_uniform_location
+
+#   undef glClearColor
+#   define glClearColor gl_intercept::clear_color
+#   undef glClear
+#   define glClear gl_intercept::clear
+#   undef glEnable
+#   define glEnable gl_intercept::enable
+#   undef glDisable
+#   define glDisable gl_intercept::disable
+#   undef glDepthFunc
+#   define glDepthFunc gl_intercept::depth_func
+#   undef glBlendFunc
+#   define glBlendFunc gl_intercept::blend_func
+#   undef glEnableVertexAttribArray
+#   define glEnableVertexAttribArray gl_intercept::enable_vertex_attrib_array
+#   undef glDisableVertexAttribArray
+#   define glDisableVertexAttribArray gl_intercept::disable_vertex_attrib_array
+#   undef glVertexAttribPointer
+#   define glVertexAttribPointer gl_intercept::vertex_attrib_pointer
+
+#   undef glUniform1i
+#   define glUniform1i gl_intercept::uniform_1i
+#   undef glUniform1f
+#   define glUniform1f gl_intercept::uniform_1f
+#   undef glUniform2fv
+#   define glUniform2fv gl_intercept::uniform_2fv
+#   undef glUniform3fv
+#   define glUniform3fv gl_intercept::uniform_3fv
+#   undef glUniform4fv
+#   define glUniform4fv gl_intercept::uniform_4fv
+#   undef glUniformMatrix4fv
+#   define glUniformMatrix4fv gl_intercept::uniform_matrix_4fv
+
+#   undef glDrawArrays
+#   define glDrawArrays gl_intercept::draw_arrays
+
+#   undef glFenceSync
+#   define glFenceSync gl_intercept::fence_sync
+#   undef glClientWaitSync
+#   define glClientWaitSync gl_intercept::client_wait_sync
+#   undef glDeleteSync
+#   define glDeleteSync gl_intercept::delete_sync
+#endif
+
+#endif // SRC_GL_INTERCEPT_HPP_
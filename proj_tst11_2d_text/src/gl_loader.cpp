@@ -0,0 +1,83 @@
+#include "gl_loader.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "logs.hpp"
+
+namespace {
+    GLint context_major {0};
+    GLint context_minor {0};
+
+    // only the extensions somebody asked about
+    std::vector<std::pair<std::string, bool>> asked;
+} // namespace
+
+auto gl_loader::init() -> bool
+{
+    const auto start {std::chrono::steady_clock::now()};
+
+    if (!load_core()) {
+        logs::err("the GL driver misses core entry points");
+        return false;
+    }
+    glGetIntegerv(GL_MAJOR_VERSION, &context_major);
+    glGetIntegerv(GL_MINOR_VERSION, &context_minor);
+    asked.clear();
+
+    DBG(1, "GL ", context_major, ".", context_minor, ": ", core_count,
+        " entry points resolved, ", optional_count, " on first use, in ",
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count(), "ms");
+    return true;
+}
+
+auto gl_loader::has(const char* extension) -> bool
+{
+    for (const auto& [name, supported] : asked) {
+        if (name == extension) {
+            return supported;
+        }
+    }
+
+    bool supported {false};
+    GLint count {0};
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i {0}; i < count && !supported; ++i) {
+        const auto* name {reinterpret_cast<const char*>(
+            glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)))};
+        supported = name != nullptr && std::strcmp(name, extension) == 0;
+    }
+    DBG(3, extension, supported ? " supported" : " not supported");
+    asked.emplace_back(extension, supported);
+    return supported;
+}
+
+auto gl_loader::version(int major, int minor) -> bool
+{
+    return context_major > major
+        || (context_major == major && context_minor >= minor);
+}
+
+auto gl_loader::resolve(const char* name) -> Proc
+{
+    return glfwGetProcAddress(name);
+}
+
+auto gl_loader::resolve_lazily(const char* name) -> Proc
+{
+    Proc proc {resolve(name)};
+    if (proc == nullptr) {
+        // callers check has()/version() first, this is a bug
+        logs::err("GL entry point ", name, " is not available");
+        std::abort();
+    }
+    DBG(3, "resolved ", name, " on first use");
+    return proc;
+}
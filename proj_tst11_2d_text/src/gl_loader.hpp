@@ -0,0 +1,51 @@
+#ifndef SRC_GL_LOADER_HPP_
+#define SRC_GL_LOADER_HPP_
+
+/*******************************************************************************
+ * GL types, enums and entry points, used instead of GLEW.
+ *
+ * The build scans the sources for the gl* functions they reference and
+ * generates a function pointer for each of them (see tools/gen_gl_loader.cpp),
+ * nothing else is declared. init() resolves the ones belonging to the core
+ * version the context is created with, the rest (newer versions, extensions)
+ * resolve themselves on their first call. Check has() or version() before
+ * calling those, like the GLEW_* flags were checked before.
+ *
+ * Include this before any other GL or GLFW header.
+ ******************************************************************************/
+
+#if defined(__gl_h_) || defined(__GL_H__) || defined(__glew_h__)
+#   error "gl_loader.hpp has to be included before <GL/gl.h> (or GLEW)"
+#endif
+
+// GLFW must not pull in the system's gl.h, it would declare the functions
+#define GLFW_INCLUDE_NONE
+#include <GL/glcorearb.h>
+
+#include "gl_functions.hpp" // generated
+
+namespace gl_loader {
+    using Proc = void (*)();
+
+    // resolve the core entry points, needs a current context, false if the
+    // driver misses one of them
+    auto init() -> bool;
+
+    // whether the context advertises `extension` ("GL_KHR_debug"), answers
+    // are cached
+    auto has(const char* extension) -> bool;
+
+    // whether the context is at least GL `major`.`minor`
+    auto version(int major, int minor) -> bool;
+
+    // address of the entry point `name`, nullptr if there is none
+    auto resolve(const char* name) -> Proc;
+
+    // used by the generated code
+    auto resolve_lazily(const char* name) -> Proc;
+    auto load_core() -> bool;
+    extern const unsigned core_count;
+    extern const unsigned optional_count;
+} // namespace gl_loader
+
+#endif // SRC_GL_LOADER_HPP_
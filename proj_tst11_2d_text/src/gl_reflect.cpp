@@ -0,0 +1,193 @@
+#include "gl_reflect.hpp"
+
+#include "gl_loader.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+#include "logs.hpp"
+#include "gl_intercept.hpp"
+
+namespace {
+    auto strip_array(std::string name) -> std::string
+    {
+        const size_t bracket {name.rfind("[0]")};
+        if (bracket != std::string::npos && bracket + 3 == name.size()) {
+            name.resize(bracket);
+        }
+        return name;
+    }
+
+    auto find(const std::vector<gl_reflect::Variable>& vars,
+              const std::string& name) -> const gl_reflect::Variable*
+    {
+        for (const auto& var : vars) {
+            if (var.name == name) {
+                return &var;
+            }
+        }
+        return nullptr;
+    }
+
+    auto is_sampler(GLenum type) -> bool
+    {
+        switch (type) {
+        case GL_SAMPLER_1D:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_1D_SHADOW:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_1D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_1D_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_MULTISAMPLE:
+        case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_BUFFER:
+        case GL_SAMPLER_2D_RECT:
+        case GL_SAMPLER_2D_RECT_SHADOW:
+        case GL_INT_SAMPLER_2D:
+        case GL_INT_SAMPLER_3D:
+        case GL_INT_SAMPLER_CUBE:
+        case GL_INT_SAMPLER_2D_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_2D:
+        case GL_UNSIGNED_INT_SAMPLER_3D:
+        case GL_UNSIGNED_INT_SAMPLER_CUBE:
+        case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+            return true;
+        default:
+            return false;
+        }
+    }
+} // namespace
+
+namespace gl_reflect {
+    auto Program_info::uniform(const std::string& name) const -> const Variable*
+    {
+        return find(this->uniforms, name);
+    }
+
+    auto Program_info::attribute(const std::string& name) const
+        -> const Variable*
+    {
+        return find(this->attributes, name);
+    }
+
+    auto reflect(GLuint program) -> Program_info
+    {
+        Program_info info;
+        info.program = program;
+
+        GLint count {0};
+        GLint max_len {0};
+        GLsizei len {0};
+
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_len);
+        std::vector<char> name(max_len + 1);
+        for (GLuint i {0}; i < static_cast<GLuint>(count); ++i) {
+            GLint block {-1};
+            glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_BLOCK_INDEX, &block);
+            if (block != -1) {
+                continue; // set through the block's buffer
+            }
+
+            Variable var {};
+            glGetActiveUniform(
+                program, i, max_len, &len, &var.size, &var.type, name.data());
+            var.name = strip_array(std::string(name.data(), len));
+            var.location = glGetUniformLocation(program, var.name.c_str());
+            info.uniforms.push_back(var);
+        }
+
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        glGetProgramiv(
+            program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_len);
+        name.resize(max_len + 1);
+        for (GLuint i {0}; i < static_cast<GLuint>(count); ++i) {
+            Block block {};
+            block.index = i;
+            glGetActiveUniformBlockName(program, i, max_len, &len, name.data());
+            block.name = std::string(name.data(), len);
+            glGetActiveUniformBlockiv(
+                program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.data_size);
+            glGetActiveUniformBlockiv(
+                program, i, GL_UNIFORM_BLOCK_BINDING, &block.binding);
+            info.blocks.push_back(block);
+        }
+
+        glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+        glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_len);
+        name.resize(max_len + 1);
+        for (GLuint i {0}; i < static_cast<GLuint>(count); ++i) {
+            Variable var {};
+            glGetActiveAttrib(
+                program, i, max_len, &len, &var.size, &var.type, name.data());
+            var.name = strip_array(std::string(name.data(), len));
+            var.location = glGetAttribLocation(program, var.name.c_str());
+            info.attributes.push_back(var);
+        }
+
+        DBG(2, "program ", program, ": ", info.uniforms.size(), " uniforms, ",
+            info.blocks.size(), " blocks, ", info.attributes.size(),
+            " attributes");
+        return info;
+    }
+
+    auto type_name(GLenum type) -> const char*
+    {
+        switch (type) {
+        case GL_BOOL: return "bool";
+        case GL_INT: return "int";
+        case GL_FLOAT: return "float";
+        case GL_FLOAT_VEC2: return "vec2";
+        case GL_FLOAT_VEC3: return "vec3";
+        case GL_FLOAT_VEC4: return "vec4";
+        case GL_FLOAT_MAT3: return "mat3";
+        case GL_FLOAT_MAT4: return "mat4";
+        default: return is_sampler(type) ? "sampler" : "?";
+        }
+    }
+
+    auto compatible(GLenum cpp_type, GLenum type) -> bool
+    {
+        if (cpp_type == GL_INT) {
+            return type == GL_INT || type == GL_BOOL || is_sampler(type);
+        }
+        return cpp_type == type;
+    }
+
+    auto upload(GLint location, GLint value) -> void
+    {
+        glUniform1i(location, value);
+    }
+
+    auto upload(GLint location, GLfloat value) -> void
+    {
+        glUniform1f(location, value);
+    }
+
+    auto upload(GLint location, const glm::vec2& value) -> void
+    {
+        glUniform2fv(location, 1, glm::value_ptr(value));
+    }
+
+    auto upload(GLint location, const glm::vec3& value) -> void
+    {
+        glUniform3fv(location, 1, glm::value_ptr(value));
+    }
+
+    auto upload(GLint location, const glm::vec4& value) -> void
+    {
+        glUniform4fv(location, 1, glm::value_ptr(value));
+    }
+
+    auto upload(GLint location, const glm::mat4& value) -> void
+    {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+} // namespace gl_reflect
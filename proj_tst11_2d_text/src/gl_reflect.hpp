@@ -0,0 +1,87 @@
+#ifndef SRC_GL_REFLECT_HPP_
+#define SRC_GL_REFLECT_HPP_
+
+/*******************************************************************************
+ * Reflection of linked programs.
+ *
+ * reflect() asks the driver once (after linking) for the active uniforms,
+ * uniform blocks and attributes of a program, lookups by name happen in this
+ * table rather than through the driver. See Uniform.hpp for typed handles
+ * built on top of it.
+ ******************************************************************************/
+
+#include "gl_loader.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+namespace gl_reflect {
+    struct Variable {
+        std::string name; // arrays without the "[0]"
+        GLenum type; // GL_FLOAT_MAT4, GL_SAMPLER_2D, ...
+        GLint size; // array length, 1 if not an array
+        GLint location;
+    };
+
+    struct Block {
+        std::string name;
+        GLuint index;
+        GLint data_size; // bytes
+        GLint binding;
+    };
+
+    struct Program_info {
+        GLuint program {0};
+        // uniforms in the default block, block members are not listed here
+        std::vector<Variable> uniforms;
+        std::vector<Block> blocks;
+        std::vector<Variable> attributes;
+
+        // nullptr if the program has no such active uniform/attribute
+        auto uniform(const std::string& name) const -> const Variable*;
+        auto attribute(const std::string& name) const -> const Variable*;
+    };
+
+    // needs a successfully linked program
+    auto reflect(GLuint program) -> Program_info;
+
+    // "GL_FLOAT_MAT4" and the like, for messages
+    auto type_name(GLenum type) -> const char*;
+
+    // GL type a C++ type is uploaded as, not defined for unsupported types
+    template<typename T> struct Type_of;
+    template<> struct Type_of<GLint> {
+        static constexpr GLenum type {GL_INT};
+    };
+    template<> struct Type_of<GLfloat> {
+        static constexpr GLenum type {GL_FLOAT};
+    };
+    template<> struct Type_of<glm::vec2> {
+        static constexpr GLenum type {GL_FLOAT_VEC2};
+    };
+    template<> struct Type_of<glm::vec3> {
+        static constexpr GLenum type {GL_FLOAT_VEC3};
+    };
+    template<> struct Type_of<glm::vec4> {
+        static constexpr GLenum type {GL_FLOAT_VEC4};
+    };
+    template<> struct Type_of<glm::mat4> {
+        static constexpr GLenum type {GL_FLOAT_MAT4};
+    };
+
+    // whether a uniform of GL type `type` can be set from a `cpp_type` value
+    // (ints also set bools and samplers)
+    auto compatible(GLenum cpp_type, GLenum type) -> bool;
+
+    // glUniform* for the current program, one overload per Type_of
+    auto upload(GLint location, GLint value) -> void;
+    auto upload(GLint location, GLfloat value) -> void;
+    auto upload(GLint location, const glm::vec2& value) -> void;
+    auto upload(GLint location, const glm::vec3& value) -> void;
+    auto upload(GLint location, const glm::vec4& value) -> void;
+    auto upload(GLint location, const glm::mat4& value) -> void;
+} // namespace gl_reflect
+
+#endif // SRC_GL_REFLECT_HPP_
@@ -0,0 +1,81 @@
+#include "gl_stats.hpp"
+
+#include <unordered_set>
+
+#include "logs.hpp"
+
+namespace {
+    gl_stats::Counters cur_frame;
+    gl_stats::Counters prev_frame;
+    gl_stats::Counters sums;
+    unsigned frame_count {0};
+
+    // redundant calls already reported
+    std::unordered_set<const char*> reported;
+} // namespace
+
+auto gl_stats::count(Call call) -> void
+{
+    ++cur_frame[call];
+}
+
+auto gl_stats::count_upload(size_t bytes) -> void
+{
+    ++cur_frame[Call::upload];
+    cur_frame.upload_bytes += bytes;
+}
+
+auto gl_stats::count_redundant(const char* call) -> void
+{
+    ++cur_frame.redundant;
+
+    if (reported.insert(call).second) {
+        logs::info(
+            "redundant ", call, " (matches current state), "
+            "further ones are only counted");
+    }
+}
+
+auto gl_stats::end_frame() -> void
+{
+    for (size_t i {0}; i < sums.calls.size(); ++i) {
+        sums.calls[i] += cur_frame.calls[i];
+    }
+    sums.upload_bytes += cur_frame.upload_bytes;
+    sums.redundant += cur_frame.redundant;
+    ++frame_count;
+
+    prev_frame = cur_frame;
+    cur_frame = Counters{};
+}
+
+auto gl_stats::last_frame() -> const Counters&
+{
+    return prev_frame;
+}
+
+auto gl_stats::totals() -> const Counters&
+{
+    return sums;
+}
+
+auto gl_stats::frames() -> unsigned
+{
+    return frame_count;
+}
+
+auto gl_stats::name(Call call) -> const char*
+{
+    switch (call) {
+    case Call::draw: return "draw";
+    case Call::clear: return "clear";
+    case Call::bind: return "bind";
+    case Call::state: return "state";
+    case Call::uniform: return "uniform";
+    case Call::upload: return "upload";
+    case Call::object: return "object";
+    case Call::sync: return "sync";
+    case Call::count: break;
+    }
+    return "?";
+}
@@ -0,0 +1,68 @@
+#ifndef SRC_GL_STATS_HPP_
+#define SRC_GL_STATS_HPP_
+
+/*******************************************************************************
+ * Per-frame GL call counters.
+ *
+ * Fed by the interception layer (gl_intercept.hpp) in debug builds, so release
+ * builds pay nothing. GL_STATS is defined here: include this header before
+ * testing it. Besides counting calls by category and uploaded bytes, the layer
+ * flags binds and state sets that would not change the current GL state.
+ ******************************************************************************/
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// call counters are part of every debug build
+#if defined(DEBUG)
+#   define GL_STATS
+#endif
+
+namespace gl_stats {
+    enum class Call {
+        draw,
+        clear,
+        bind, // buffers, vertex arrays, textures, programs
+        state, // fixed function state, vertex attributes, pixel store
+        uniform,
+        upload, // buffer and texture data specification
+        object, // creation, deletion, compilation and linking
+        sync, // fences, waits on them and buffer mapping
+        count
+    };
+
+    struct Counters {
+        std::array<unsigned, static_cast<size_t>(Call::count)> calls {};
+        uint64_t upload_bytes {0};
+        unsigned redundant {0}; // calls that did not change any state
+
+        auto operator[](Call call) -> unsigned&
+        {
+            return this->calls[static_cast<size_t>(call)];
+        }
+
+        auto operator[](Call call) const -> unsigned
+        {
+            return this->calls[static_cast<size_t>(call)];
+        }
+    };
+
+    auto count(Call call) -> void;
+    auto count_upload(size_t bytes) -> void;
+    // `call` is the GL function name, each one is reported once in the log
+    auto count_redundant(const char* call) -> void;
+
+    // mark the end of a frame
+    auto end_frame() -> void;
+
+    // counters of the last finished frame
+    auto last_frame() -> const Counters&;
+    // sums over all finished frames
+    auto totals() -> const Counters&;
+    auto frames() -> unsigned;
+
+    auto name(Call call) -> const char*;
+} // namespace gl_stats
+
+#endif // SRC_GL_STATS_HPP_
@@ -0,0 +1,170 @@
+#include "glsl.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "assets.hpp"
+#include "logs.hpp"
+
+namespace {
+    // nested includes past this are most likely a symlink loop
+    constexpr unsigned max_depth {32};
+
+    // "dir/inc.glsl" included from "dir/sub/a.glsl" as "../inc.glsl"
+    auto include_path(const std::string& from, const std::string& name)
+        -> std::string
+    {
+        const std::filesystem::path dir {std::filesystem::path(from).parent_path()};
+        return (dir / name).lexically_normal().generic_string();
+    }
+
+    // the directive name if `line` is a preprocessor line, "" otherwise,
+    // `rest` gets what follows the name
+    auto directive(std::string_view line, std::string& rest) -> std::string
+    {
+        size_t pos {line.find_first_not_of(" \t")};
+        if (pos == std::string::npos || line[pos] != '#') {
+            return "";
+        }
+        pos = line.find_first_not_of(" \t", pos + 1);
+        if (pos == std::string::npos) {
+            return "";
+        }
+        const size_t end {line.find_first_of(" \t", pos)};
+        rest = end == std::string::npos ? "" : std::string(line.substr(end));
+        return std::string(
+            line.substr(pos, end == std::string::npos ? end : end - pos));
+    }
+
+    // file name out of ` "name"` or ` <name>`
+    auto include_name(const std::string& rest) -> std::string
+    {
+        const size_t begin {rest.find_first_of("\"<")};
+        if (begin == std::string::npos) {
+            return "";
+        }
+        const char close {rest[begin] == '"' ? '"' : '>'};
+        const size_t end {rest.find(close, begin + 1)};
+        if (end == std::string::npos) {
+            return "";
+        }
+        return rest.substr(begin + 1, end - begin - 1);
+    }
+
+    auto add_defines(
+        const std::vector<std::string>& defines,
+        unsigned next_line,
+        std::string& code) -> void
+    {
+        for (const std::string& define : defines) {
+            code += "#define " + define + "\n";
+        }
+        code += "#line " + std::to_string(next_line) + " 0\n";
+    }
+
+    auto add_file(
+        const std::string& path,
+        const std::vector<std::string>& defines,
+        unsigned depth,
+        glsl::Source& source) -> bool
+    {
+        if (depth > max_depth) {
+            logs::err("includes nested too deep at ", path);
+            return false;
+        }
+
+        std::string_view text;
+        if (!assets::get(path, text)) {
+            logs::err("can not open ", path);
+            return false;
+        }
+
+        std::vector<std::string_view> lines;
+        while (!text.empty()) {
+            const size_t end {text.find('\n')};
+            lines.push_back(text.substr(0, end));
+            text.remove_prefix(
+                end == std::string_view::npos ? text.size() : end + 1);
+        }
+
+        const size_t index {source.files.size()};
+        const std::string file_no {std::to_string(index)};
+        source.files.push_back(path);
+
+        // defines go into the root file, right after #version if it has one
+        size_t version_line {lines.size()};
+        if (index == 0) {
+            for (size_t i {0}; i < lines.size(); ++i) {
+                std::string rest;
+                if (directive(lines[i], rest) == "version") {
+                    version_line = i;
+                    break;
+                }
+            }
+            if (version_line == lines.size()) {
+                add_defines(defines, 1, source.code);
+            }
+        } else {
+            source.code += "#line 1 " + file_no + "\n";
+        }
+
+        for (size_t i {0}; i < lines.size(); ++i) {
+            const unsigned line_no {static_cast<unsigned>(i + 1)};
+            std::string rest;
+            if (directive(lines[i], rest) != "include") {
+                source.code += lines[i];
+                source.code += '\n';
+                if (i == version_line) {
+                    add_defines(defines, line_no + 1, source.code);
+                }
+                continue;
+            }
+
+            const std::string inc {include_name(rest)};
+            if (inc.empty()) {
+                logs::err(path, ":", line_no, ": malformed #include");
+                return false;
+            }
+
+            const std::string inc_path {include_path(path, inc)};
+            const auto& files {source.files};
+            if (std::find(files.begin(), files.end(), inc_path) != files.end()) {
+                continue; // already in there
+            }
+            if (!add_file(inc_path, defines, depth + 1, source)) {
+                logs::err("included from ", path, ":", line_no);
+                return false;
+            }
+            source.code +=
+                "#line " + std::to_string(line_no + 1) + " " + file_no + "\n";
+        }
+        return true;
+    }
+} // namespace
+
+namespace glsl {
+    auto preprocess(
+        const std::string& path,
+        const std::vector<std::string>& defines,
+        Source& source) -> bool
+    {
+        source.code.clear();
+        source.files.clear();
+        const std::string root {
+            std::filesystem::path(path).lexically_normal().generic_string()};
+        return add_file(root, defines, 0, source);
+    }
+
+    auto file_table(const Source& source) -> std::string
+    {
+        std::string table;
+        for (size_t i {0}; i < source.files.size(); ++i) {
+            table += (i == 0 ? "" : ", ") + std::to_string(i) + ": "
+                + source.files[i];
+        }
+        return table;
+    }
+} // namespace glsl
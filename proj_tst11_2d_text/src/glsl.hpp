@@ -0,0 +1,40 @@
+#ifndef SRC_GLSL_HPP_
+#define SRC_GLSL_HPP_
+
+/*******************************************************************************
+ * GLSL source preprocessing, done before the source reaches the driver.
+ *
+ *  - `#include "file"` is replaced by the file (relative to the including
+ *    one). Every file is included at most once per shader, so there is no need
+ *    for include guards and cycles are harmless.
+ *  - `defines` are injected right after `#version`, "NAME" becomes
+ *    `#define NAME` and "NAME VALUE" becomes `#define NAME VALUE`, so feature
+ *    toggles are compile time specialisations instead of runtime branches.
+ *  - `#line` directives keep compiler messages pointing at the right line,
+ *    the source string number in them is the index into `Source::files`.
+ *
+ * Directives are only recognised at the start of a line (after whitespace),
+ * an #include inside a block comment is still included. Files are read through
+ * assets::get(), so embedded shaders include embedded files.
+ ******************************************************************************/
+
+#include <string>
+#include <vector>
+
+namespace glsl {
+    struct Source {
+        std::string code; // ready for glShaderSource
+        std::vector<std::string> files; // every file read, [0] is the root
+    };
+
+    // false (and an error logged) if a file can not be read
+    auto preprocess(
+        const std::string& path,
+        const std::vector<std::string>& defines,
+        Source& source) -> bool;
+
+    // "0: a.glsl, 1: b.glsl", to decode the source numbers in compiler logs
+    auto file_table(const Source& source) -> std::string;
+} // namespace glsl
+
+#endif // SRC_GLSL_HPP_
@@ -1,8 +1,23 @@
 #include "logs.hpp"
 
 #include <array>
+#include <atomic>
 #include <sstream>
 
+namespace {
+    std::atomic<logs::Sink> cur_sink {nullptr};
+} // namespace
+
+auto logs::set_sink(Sink sink) -> void
+{
+    cur_sink = sink;
+}
+
+auto logs::get_sink() -> Sink
+{
+    return cur_sink;
+}
+
 #if 0
 auto logs::timestamp() -> std::string
 {
@@ -9,6 +9,11 @@ namespace logs {
     // returns current time in [HH::MM:SS.ssssss] format
     auto timestamp() -> std::string;
 
+    // gets a copy of every printed line (may be called from any thread)
+    using Sink = void (*)(const std::string& line);
+    auto set_sink(Sink sink) -> void;
+    auto get_sink() -> Sink;
+
     // general logging print
     template<typename... Ts>
     auto log_print(Ts... args) -> void
@@ -18,7 +23,11 @@ namespace logs {
         buf << timestamp();
         (buf << ... << args);
 
-        std::cout << buf.str() << std::endl;
+        const std::string line {buf.str()};
+        std::cout << line << std::endl;
+        if (Sink sink {get_sink()}) {
+            sink(line);
+        }
     }
 
     // print info message
@@ -1,21 +1,67 @@
-#include <GL/glew.h>
+#include "gl_loader.hpp"
 #include <GLFW/glfw3.h>
 // #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <array>
+#include <memory>
+#include <string>
 
 #include "tutorial_libs/text2D.hpp"
 
 #include "FPS_manager.hpp"
+#include "Perf_counters.hpp"
+#include "Flight_recorder.hpp"
+#include "Init_graph.hpp"
+#include "Input_latency.hpp"
 #include "Randomizer.hpp"
+#include "Shader_manager.hpp"
+#include "Texture_arrays.hpp"
+#include "Texture_manager.hpp"
+#include "Thread_pool.hpp"
+#include "Uniform.hpp"
+#include "assets.hpp"
+#include "mipmaps.hpp"
+#include "png.hpp"
 #include "utils.hpp"
+#include "warmup.hpp"
 #include "logs.hpp"
+#include "bench.hpp"
+#include "gl_capture.hpp"
+#include "gl_debug.hpp"
+#include "gl_stats.hpp"
+#include "gl_intercept.hpp"
+
+struct Args {
+    std::string bench_path; // write a benchmark summary here at exit
+    bool perf {false}; // sample hardware counters per frame phase
+    std::string hitch_prefix; // flight recorder dumps, off if empty
+    bool latency {false}; // measure input to photon latency
+    bool watch_shaders {false}; // reload shaders when their sources change
+    bool disk_assets {false}; // files on disk override the embedded ones
+    std::string pack_path; // asset pack to mount, the default one if empty
+};
+
+// a font's 16x16 glyph grid as a layer of the font sample array
+struct Font_layer {
+    const char* path;
+    const char* name;
+    std::vector<unsigned char> rgba;
+    std::vector<mipmaps::Level> levels;
+    Texture_arrays::Handle handle;
+};
 
-auto process_args(int argc, char** argv) -> void;
+auto process_args(int argc, char** argv) -> Args;
+auto read_font_layer(Font_layer& layer, unsigned size) -> bool;
+auto write_bench(const std::string& path, unsigned frames, double seconds)
+    -> void;
 auto init() -> GLFWwindow*;
 auto deinit(GLFWwindow* window) -> void;
 
@@ -36,29 +82,11 @@ struct Camera {
 
 auto main(int argc, char** argv) -> int
 {
-    if (argc > 1) {
-        process_args(argc, argv);
-    }
-
-    GLFWwindow* window{init()};
-    if (window == nullptr) {
-        deinit(window);
-        return -1;
-    }
-
-    glClearColor(0.2f, 0.0f, 0.4f, 0.0f);
-
-    GLuint vert_array_id;
-    glGenVertexArrays(1, &vert_array_id);
-    glBindVertexArray(vert_array_id);
+    const auto process_start {std::chrono::steady_clock::now()};
 
-    GLuint shader {load_shaders(
-        "data/shaders/vertex_simple_shader.glsl",
-        "data/shaders/fragment_simple_shader.glsl")};
-    if (shader == 0) {
-        logs::err("errors while loading shaders");
-        deinit(window);
-        return -1;
+    Args args;
+    if (argc > 1) {
+        args = process_args(argc, argv);
     }
 
     // cube (made of tris - 2 per face)
@@ -101,30 +129,167 @@ auto main(int argc, char** argv) -> int
         1.0f,-1.0f, 1.0f
     };
 
-    GLuint vert_buf_id;
-    glGenBuffers(1, &vert_buf_id);
-    glBindBuffer(GL_ARRAY_BUFFER, vert_buf_id);
-    glBufferData(
-        GL_ARRAY_BUFFER, sizeof(cube_verts), cube_verts, GL_STATIC_DRAW);
+    /* startup as a graph: file reads, parsing and mesh generation run on the
+     * workers while the window and the GL context are being created, GL calls
+     * only happen on this thread */
+    using Thread = Init_graph::Thread;
+    Thread_pool pool;
+    Init_graph startup;
+
+    GLFWwindow* window {nullptr};
+    const auto context {startup.add("window", Thread::context, {}, [&] {
+        window = init();
+        if (window != nullptr) {
+            glClearColor(0.2f, 0.0f, 0.4f, 0.0f);
+        }
+        return window != nullptr;
+    })};
+
+    const auto assets {startup.add("assets", Thread::worker, {}, [&] {
+        // the default pack is optional, one given with --pack is not
+        if (!args.pack_path.empty()) {
+            assets::mount(args.pack_path);
+        } else if (std::filesystem::exists(assets::default_pack)) {
+            assets::mount(assets::default_pack);
+        }
+        // edits only show up if the files are read from disk
+        assets::prefer_disk(args.disk_assets || args.watch_shaders);
+        return true;
+    })};
+
+    Shader_manager::Sources simple_sources;
+    Shader_manager::Sources text_array_sources;
+    const auto sources {startup.add(
+        "shader_sources", Thread::worker, {assets}, [&] {
+            simple_sources = Shader_manager::read(
+                "data/shaders/vertex_simple_shader.glsl",
+                "data/shaders/fragment_simple_shader.glsl");
+            text_array_sources = Shader_manager::read(
+                "data/shaders/TextArrayShader.vertexshader",
+                "data/shaders/TextArrayShader.fragmentshader");
+            return simple_sources.ok && text_array_sources.ok;
+        })};
 
     /* some random generated colors (so it is easier to see the tris that make
      * up the cube) */
     std::array<GLfloat, 6*2*3*3> cube_vert_colors{};
-    {
+    const auto mesh {startup.add("cube_mesh", Thread::worker, {}, [&] {
         Randomizer random;
         for (auto& vert : cube_vert_colors) {
             vert = random.get(0.0f, 1.0f);
         }
-    }
+        return true;
+    })};
+
+    /* the font sample line: two fonts as layers of one texture array, drawn
+     * in one draw call (see Texture_arrays.hpp); .png sources as the .dds
+     * ones differ in format and size */
+    std::array<Font_layer, 2> font_layers {{
+        {"data/textures/holstein.png", "holstein", {}, {}, {}},
+        {"data/textures/mononoki.png", "mononoki", {}, {}, {}},
+    }};
+    bool font_sample {true};
+    const auto font_images {startup.add(
+        "font_images", Thread::worker, {assets}, [&] {
+            for (Font_layer& layer : font_layers) {
+                font_sample = read_font_layer(layer, 1024) && font_sample;
+            }
+            return true; // the line is left out without them
+        })};
+
+    const auto warmup_list {startup.add("warmup_list", Thread::worker, {}, [] {
+        warmup::load();
+        return true;
+    })};
+
+    // compiling overlaps with everything below until the program is needed
+    std::unique_ptr<Shader_manager> shaders;
+    Shader_manager::Handle simple_shader {0};
+    Shader_manager::Handle text_array_shader {0};
+    const auto shader_build {startup.add(
+        "shaders", Thread::context, {context, sources}, [&] {
+            shaders = std::make_unique<Shader_manager>();
+            simple_shader = shaders->submit(simple_sources);
+            text_array_shader = shaders->submit(text_array_sources);
+            if (args.watch_shaders) {
+                shaders->watch();
+            }
+            return true;
+        })};
+
+    // read on the workers and uploaded over the first frames, text shows a
+    // placeholder until then
+    std::unique_ptr<Texture_manager> textures;
+    Texture_manager::Handle font {0};
+    const auto text {startup.add(
+        "text", Thread::context, {context, assets}, [&] {
+            textures = std::make_unique<Texture_manager>(pool);
+            //    font = textures->load("data/textures/holstein.dds");
+            font = textures->load("data/textures/mononoki.dds");
+            initText2D(textures->texture(font));
+            return true;
+        })};
+
+    std::unique_ptr<Texture_arrays> font_array;
+    const auto fonts {startup.add(
+        "font_array", Thread::context, {context, font_images}, [&] {
+            font_array = std::make_unique<Texture_arrays>(
+                static_cast<GLsizei>(font_layers.size()));
+            for (Font_layer& layer : font_layers) {
+                if (font_sample) {
+                    font_sample = font_array->add(
+                        layer.rgba, layer.levels, layer.handle);
+                }
+                // only needed for the upload
+                layer.rgba = {};
+            }
+            return true;
+        })};
+
+    GLuint vert_array_id {0};
+    GLuint vert_buf_id {0};
+    GLuint vert_color_buf_id {0};
+    const auto cube {startup.add(
+        "cube_buffers", Thread::context, {context, mesh}, [&] {
+            glGenVertexArrays(1, &vert_array_id);
+            glBindVertexArray(vert_array_id);
+
+            glGenBuffers(1, &vert_buf_id);
+            glBindBuffer(GL_ARRAY_BUFFER, vert_buf_id);
+            glBufferData(
+                GL_ARRAY_BUFFER, sizeof(cube_verts), cube_verts,
+                GL_STATIC_DRAW);
+
+            glGenBuffers(1, &vert_color_buf_id);
+            glBindBuffer(GL_ARRAY_BUFFER, vert_color_buf_id);
+            glBufferData(
+                GL_ARRAY_BUFFER,
+                sizeof(cube_vert_colors),
+                &cube_vert_colors[0],
+                GL_STATIC_DRAW);
+            return true;
+        })};
+
+    /* draw what earlier runs drew once, offscreen, so the driver finishes
+     * compiling and specialising now instead of on the first frames */
+    startup.add(
+        "warmup", Thread::context,
+        {shader_build, text, fonts, cube, warmup_list},
+        [&] {
+            if (!shaders->wait_all()) {
+                logs::err("errors while loading shaders");
+                return false;
+            }
+            warmup::run();
+            return true;
+        });
 
-    GLuint vert_color_buf_id;
-    glGenBuffers(1, &vert_color_buf_id);
-    glBindBuffer(GL_ARRAY_BUFFER, vert_color_buf_id);
-    glBufferData(
-        GL_ARRAY_BUFFER,
-        sizeof(cube_vert_colors),
-        &cube_vert_colors[0],
-        GL_STATIC_DRAW);
+    const bool started {startup.run(pool)};
+    startup.report();
+    if (!started) {
+        deinit(window);
+        return -1;
+    }
 
     // ------
     float h_angle {3.14f}; // horizontal angle (3.14 = towards -z)
@@ -189,14 +354,10 @@ auto main(int argc, char** argv) -> int
     glm::mat4 model {glm::mat4(1.0f)};
 
     glm::mat4 mvp {projection * view * model};
-    constexpr char mvp_name[] {"MVP"};
-    GLint mvp_matrix_id {glGetUniformLocation(shader, mvp_name)};
-    if (glGetError() != GL_NO_ERROR) {
-        logs::err("error while getting uniform '", mvp_name, "' location");
-    }
 
-    //    initText2D("data/textures/holstein.dds");
-    initText2D("data/textures/mononoki.dds");
+    // stays valid when the shader is reloaded, only uploads changed values
+    Uniform<glm::mat4>& mvp_uniform {
+        shaders->uniform<glm::mat4>(simple_shader, "MVP")};
 
     Size2 window_size;
     glfwGetWindowSize(window, &window_size.w, &window_size.h);
@@ -205,19 +366,42 @@ auto main(int argc, char** argv) -> int
 
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
+
     FPS_manager fps_man;
+    Perf_counters perf(args.perf);
+    std::unique_ptr<Flight_recorder> recorder;
+    if (!args.hitch_prefix.empty()) {
+        recorder = std::make_unique<Flight_recorder>(args.hitch_prefix);
+    }
+    std::unique_ptr<Input_latency> latency;
+    if (args.latency) {
+        latency = std::make_unique<Input_latency>(window);
+    }
+    auto enter_phase = [&](Frame_phase phase) {
+        perf.enter(phase);
+        if (recorder) {
+            recorder->enter(phase);
+        }
+    };
     char text_buf[256];
     float delta_time {0.0f};
     bool fps_cap_toggle {false};
+    unsigned frames {0};
+    double frames_seconds {0.0}; // sum of all frame times
     while (glfwWindowShouldClose(window) == 0) {
 
         // ----- input phase -----
+        enter_phase(Frame_phase::input);
 
+        glfwPollEvents();
+        if (latency) {
+            latency->begin_frame();
+        }
+
+        // read after polling, the motion just dispatched steers this frame
         Pos2d mouse_pos;
         glfwGetCursorPos(window, &mouse_pos.x, &mouse_pos.y);
         glfwSetCursorPos(window, window_center.x, window_center.y);
-
-        glfwPollEvents();
         if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
             break;
         }
@@ -254,6 +438,10 @@ auto main(int argc, char** argv) -> int
         }
 
         // ----- update phase -----
+        enter_phase(Frame_phase::update);
+
+        shaders->update();
+        textures->update();
 
         cam.pos += cam.vel * delta_time;
 
@@ -294,9 +482,10 @@ auto main(int argc, char** argv) -> int
             GL_STATIC_DRAW);
 
         // ----- render phase -----
+        enter_phase(Frame_phase::render);
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glUseProgram(shader);
+        glUseProgram(shaders->program(simple_shader));
 
         // attribute buffer 1 : vertices
         glEnableVertexAttribArray(0);
@@ -323,39 +512,190 @@ auto main(int argc, char** argv) -> int
             (void*)0
         );
 
-        glUniformMatrix4fv(mvp_matrix_id, 1, GL_FALSE, &mvp[0][0]);
-        if (glGetError() != GL_NO_ERROR) {
-            logs::err("error while sending mvp");
-        }
+        mvp_uniform.set(mvp);
 
         glDrawArrays(GL_TRIANGLES, 0, sizeof(cube_verts));
         glDisableVertexAttribArray(0);
         glDisableVertexAttribArray(1);
 
+        // the font's 16x16 glyph grid, every glyph drawn 16 pixels high
+        textures->use(font, 16 * 16.0f);
+        setText2DTexture(textures->texture(font));
         sprintf(text_buf, "%.2f sec", glfwGetTime());
         printText2D(text_buf, 10, 540, 8, 16);
         sprintf(text_buf, "%u fps", fps_man.get_fps());
         printText2D(text_buf, 10, 570, 8, 16);
         sprintf(text_buf, "%.4fs frametime", fps_man.get_delta_seconds());
         printText2D(text_buf, 10, 510, 8, 16);
+#ifdef GL_STATS
+        {
+            // previous frame, this one is still being issued
+            const gl_stats::Counters& gl {gl_stats::last_frame()};
+            using gl_stats::Call;
+            sprintf(
+                text_buf, "%u draw %u bind %u state %u unif %.1fKiB %u redundant",
+                gl[Call::draw], gl[Call::bind], gl[Call::state],
+                gl[Call::uniform], gl.upload_bytes / 1024.0, gl.redundant);
+            printText2D(text_buf, 10, 480, 8, 16);
+        }
+#endif
+        if (latency) {
+            sprintf(
+                text_buf, "input latency p50 %.1fms p99 %.1fms",
+                latency->recent_ms(Input_latency::gpu, 0.5),
+                latency->recent_ms(Input_latency::gpu, 0.99));
+            printText2D(text_buf, 10, 450, 8, 16);
+        }
+        if (font_sample) {
+            setText2DArrayShader(shaders->program(text_array_shader));
+            int x {10};
+            for (const Font_layer& layer : font_layers) {
+                printLayerText2D(
+                    font_array->texture(layer.handle), layer.handle.layer,
+                    layer.name, x, 420, 8, 16);
+                x += static_cast<int>(std::strlen(layer.name) + 1) * 8;
+            }
+        }
+        const int text_draws {flushText2D()};
+        // the main font's text and the sample line, both fonts of which are
+        // layers of the same array, so one draw call each
+        if (frames == 0 && text_draws > (font_sample ? 2 : 1)) {
+            logs::err(
+                "text took ", text_draws,
+                " draw calls, the font layers were not batched");
+        }
 
+        enter_phase(Frame_phase::present);
+        if (latency) {
+            latency->submitted();
+        }
         glfwSwapBuffers(window);
+        if (latency) {
+            latency->swapped();
+        }
+        gl_intercept::end_frame();
 
         fps_man.end_frame();
         delta_time = static_cast<float>(fps_man.get_delta_seconds());
+        if (recorder) {
+            recorder->end_frame(
+                fps_man.get_delta_seconds(),
+                fps_man.get_median_seconds(),
+                fps_man.has_full_history());
+        }
+        if (frames == 0) {
+            // the one that pays for anything the warm-up missed
+            bench::set(
+                "frames", "first_ms", fps_man.get_delta_seconds() * 1000.0);
+
+            const double first_frame_ms {
+                std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - process_start).count()};
+            logs::info("time to first frame: ", first_frame_ms, "ms");
+            bench::set("startup", "first_frame_ms", first_frame_ms);
+        }
+        ++frames;
+        frames_seconds += fps_man.get_delta_seconds();
     }
 
+    warmup::save();
+    perf.report();
+    if (latency) {
+        latency->report();
+    }
+    if (recorder) {
+        bench::set("frames", "hitches", recorder->hitches());
+    }
+    if (!args.bench_path.empty()) {
+        write_bench(args.bench_path, frames, frames_seconds);
+    }
+
+    // their GL objects go while the context is still there
+    textures.reset();
+    font_array.reset();
+    shaders.reset();
     deinit(window);
     return 0;
 }
 
-auto process_args(int argc, char** argv) -> void
+auto process_args(int argc, char** argv) -> Args
 {
-    std::cout << "args processing is not implemented yet" << std::endl;
+    Args args;
+    std::string capture_path;
+    unsigned capture_frame {100};
+    bool record_warmup {false};
+
+    for (int i {1}; i < argc; ++i) {
+        const std::string arg {argv[i]};
+        const bool has_value {i + 1 < argc};
+
+        if (arg == "--bench" && has_value) {
+            args.bench_path = argv[++i];
+        } else if (arg == "--perf") {
+            args.perf = true;
+        } else if (arg == "--latency") {
+            args.latency = true;
+        } else if (arg == "--watch-shaders") {
+            args.watch_shaders = true;
+        } else if (arg == "--disk-assets") {
+            args.disk_assets = true;
+        } else if (arg == "--pack" && has_value) {
+            args.pack_path = argv[++i];
+        } else if (arg == "--hitch-trace" && has_value) {
+            args.hitch_prefix = argv[++i];
+        } else if (arg == "--record-warmup") {
+            record_warmup = true;
+        } else if (arg == "--capture" && has_value) {
+            capture_path = argv[++i];
+        } else if (arg == "--capture-frame" && has_value) {
+            capture_frame = static_cast<unsigned>(
+                std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            logs::err("unknown argument (or missing value): ", arg);
+        }
+    }
 
-    for (int i {0}; i < argc; ++i) {
-        std::cout << "arg #" << i << ": " << argv[i] << std::endl;
+    if (!capture_path.empty()) {
+#ifdef GL_CAPTURE
+        gl_capture::start(capture_path, capture_frame);
+#else
+        static_cast<void>(capture_frame);
+        logs::err("GL capture is not compiled in, rebuild with CAPTURE=1");
+#endif
     }
+
+    if (record_warmup) {
+#ifdef GL_INTERCEPT_ENABLED
+        warmup::record(true);
+#else
+        logs::err(
+            "draws are only seen by debug and CAPTURE=1 builds, "
+            "the warm-up list is not recorded");
+#endif
+    }
+
+    return args;
+}
+
+auto write_bench(const std::string& path, unsigned frames, double seconds)
+    -> void
+{
+    bench::set("frames", "count", frames);
+    bench::set("frames", "mean_ms", frames > 0 ? seconds * 1000.0 / frames : 0.0);
+
+#ifdef GL_STATS
+    // per frame averages
+    const gl_stats::Counters& gl {gl_stats::totals()};
+    const double gl_frames {gl_stats::frames() > 0 ? gl_stats::frames() : 1.0};
+    for (size_t i {0}; i < gl.calls.size(); ++i) {
+        const auto call {static_cast<gl_stats::Call>(i)};
+        bench::set("gl", gl_stats::name(call), gl[call] / gl_frames);
+    }
+    bench::set("gl", "upload_bytes", gl.upload_bytes / gl_frames);
+    bench::set("gl", "redundant", gl.redundant / gl_frames);
+#endif
+
+    bench::write(path);
 }
 
 auto init() -> GLFWwindow*
@@ -374,6 +714,9 @@ auto init() -> GLFWwindow*
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, opengl_v_min); // we want OpenGL 3.3
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // for MacOS; otherwise should not be needed
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); // no old OpenGL
+#ifdef DEBUG
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE); // for gl_debug
+#endif
 
     Size2 win_res {.w = 1366, .h = 768};
 
@@ -388,12 +731,13 @@ auto init() -> GLFWwindow*
     }
     glfwMakeContextCurrent(window);
 
-    glewExperimental = true; // needed for core profile
-    if (glewInit() != GLEW_OK) {
-        logs::err("ERROR: could not initialise glew!");
+    if (!gl_loader::init()) {
         return nullptr;
     }
 
+    // GL errors are reported by the driver from here on (no glGetError)
+    gl_debug::init();
+
     glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
     glfwSwapInterval(0); // turn off v-sync (so we can have unlimited FPS)
 
@@ -403,6 +747,37 @@ auto init() -> GLFWwindow*
 auto deinit(GLFWwindow* window) -> void
 {
     std::cout << "terminating" << std::endl;
+    gl_debug::deinit();
     glfwDestroyWindow(window);
     glfwTerminate();
 }
+
+auto read_font_layer(Font_layer& layer, unsigned size) -> bool
+{
+    std::string_view file;
+    png::Image image;
+    if (!assets::get(layer.path, file)) {
+        logs::err("can not read ", layer.path);
+        return false;
+    }
+    if (!png::decode(layer.path, file, image)) {
+        return false;
+    }
+    // a narrower grid (mononoki's glyphs are twice as tall as wide) is
+    // widened by repeating pixels, the layers of an array share one size
+    if (image.height != size || image.width == 0 || size % image.width != 0) {
+        logs::err(layer.path, " does not fit a ", size, "x", size, " layer");
+        return false;
+    }
+    const unsigned repeat {size / image.width};
+    layer.rgba.resize(size_t{size} * size * 4);
+    for (unsigned y {0}; y < size; ++y) {
+        for (unsigned x {0}; x < size; ++x) {
+            std::memcpy(
+                &layer.rgba[(size_t{y} * size + x) * 4],
+                &image.rgba[(size_t{y} * image.width + x / repeat) * 4], 4);
+        }
+    }
+    layer.levels = mipmaps::generate(layer.rgba, size, size, mipmaps::defaults);
+    return true;
+}
@@ -0,0 +1,332 @@
+#include "mipmaps.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+    using mipmaps::Filter;
+
+    // the Kaiser window of NVIDIA's texture tools: 3 mipmap pixels either
+    // side of the centre, alpha 4
+    constexpr double kaiser_width {3.0};
+    constexpr double kaiser_alpha {4.0};
+    constexpr double pi {3.14159265358979323846};
+
+    // a level in floats, 4 a pixel, colour linear
+    struct Image {
+        unsigned width;
+        unsigned height;
+        std::vector<float> rgba;
+    };
+
+    // resampling along one axis: pixel `d` of the result is the sum of
+    // `count[d]` pixels from `first[d]`, weighted by the `stride` weights
+    // from `weights[d * stride]`
+    struct Taps {
+        unsigned stride;
+        std::vector<unsigned> first;
+        std::vector<unsigned> count;
+        std::vector<float> weights;
+    };
+
+#if defined(__SSE2__)
+    using Pixel = __m128;
+
+    auto zero() -> Pixel
+    {
+        return _mm_setzero_ps();
+    }
+
+    auto load(const float* p) -> Pixel
+    {
+        return _mm_loadu_ps(p);
+    }
+
+    auto store(float* p, Pixel pixel) -> void
+    {
+        _mm_storeu_ps(p, pixel);
+    }
+
+    // `sum` + `pixel` * `weight`
+    auto madd(Pixel sum, Pixel pixel, float weight) -> Pixel
+    {
+        return _mm_add_ps(sum, _mm_mul_ps(pixel, _mm_set1_ps(weight)));
+    }
+#else
+    struct Pixel {
+        float c[4];
+    };
+
+    auto zero() -> Pixel
+    {
+        return Pixel{{0.0f, 0.0f, 0.0f, 0.0f}};
+    }
+
+    auto load(const float* p) -> Pixel
+    {
+        return Pixel{{p[0], p[1], p[2], p[3]}};
+    }
+
+    auto store(float* p, Pixel pixel) -> void
+    {
+        std::copy(pixel.c, pixel.c + 4, p);
+    }
+
+    auto madd(Pixel sum, Pixel pixel, float weight) -> Pixel
+    {
+        for (unsigned i {0}; i < 4; ++i) {
+            sum.c[i] += pixel.c[i] * weight;
+        }
+        return sum;
+    }
+#endif
+
+    // modified Bessel function of the first kind, order 0
+    auto bessel_i0(double x) -> double
+    {
+        double sum {1.0};
+        double term {1.0};
+        for (int k {1}; k < 50 && term > sum * 1e-12; ++k) {
+            const double half {x / (2 * k)};
+            term *= half * half;
+            sum += term;
+        }
+        return sum;
+    }
+
+    // `x` in pixels of the result
+    auto kaiser(double x) -> double
+    {
+        if (std::abs(x) >= kaiser_width) {
+            return 0.0;
+        }
+        const double sinc {x == 0.0 ? 1.0 : std::sin(pi * x) / (pi * x)};
+        const double t {x / kaiser_width};
+        return sinc * bessel_i0(kaiser_alpha * std::sqrt(1.0 - t * t))
+            / bessel_i0(kaiser_alpha);
+    }
+
+    auto make_taps(unsigned from, unsigned to, Filter filter) -> Taps
+    {
+        const double scale {static_cast<double>(from) / to};
+        // in source pixels
+        const double radius {
+            (filter == Filter::box ? 0.5 : kaiser_width) * scale};
+
+        Taps taps {};
+        taps.stride = static_cast<unsigned>(std::ceil(2 * radius)) + 1;
+        taps.first.resize(to);
+        taps.count.resize(to);
+        taps.weights.assign(size_t{to} * taps.stride, 0.0f);
+        std::vector<double> weights;
+        for (unsigned d {0}; d < to; ++d) {
+            const double centre {(d + 0.5) * scale};
+            const auto lo {static_cast<int>(std::floor(centre - radius))};
+            const auto hi {static_cast<int>(std::ceil(centre + radius))};
+            // pixels past the edges repeat the edge
+            const int first {std::max(lo, 0)};
+            const int last {std::min(hi, static_cast<int>(from)) - 1};
+
+            weights.assign(static_cast<size_t>(last - first + 1), 0.0);
+            double sum {0.0};
+            for (int i {lo}; i < hi; ++i) {
+                double weight;
+                if (filter == Filter::box) {
+                    // how much of the pixel the footprint covers
+                    weight = std::max(
+                        0.0,
+                        std::min(i + 1.0, centre + radius)
+                            - std::max(static_cast<double>(i),
+                                       centre - radius));
+                } else {
+                    weight = kaiser((i + 0.5 - centre) / scale);
+                }
+                const int at {std::clamp(i, first, last)};
+                weights[static_cast<size_t>(at - first)] += weight;
+                sum += weight;
+            }
+
+            taps.first[d] = static_cast<unsigned>(first);
+            taps.count[d] = static_cast<unsigned>(weights.size());
+            for (size_t k {0}; k < weights.size(); ++k) {
+                taps.weights[d * taps.stride + k] =
+                    static_cast<float>(weights[k] / sum);
+            }
+        }
+        return taps;
+    }
+
+    auto resample(const Image& from, unsigned width, unsigned height,
+                  Filter filter) -> Image
+    {
+        const Taps across {make_taps(from.width, width, filter)};
+        const Taps down {make_taps(from.height, height, filter)};
+
+        // rows first, into `width` x `from.height`
+        std::vector<float> narrow(size_t{width} * from.height * 4);
+        for (unsigned y {0}; y < from.height; ++y) {
+            const float* row {from.rgba.data() + size_t{y} * from.width * 4};
+            float* out {narrow.data() + size_t{y} * width * 4};
+            for (unsigned x {0}; x < width; ++x) {
+                const float* weights {&across.weights[x * across.stride]};
+                const float* pixels {row + size_t{across.first[x]} * 4};
+                Pixel sum {zero()};
+                for (unsigned k {0}; k < across.count[x]; ++k) {
+                    sum = madd(sum, load(pixels + k * 4), weights[k]);
+                }
+                store(out + x * 4, sum);
+            }
+        }
+
+        // then columns, a whole row of them at a time
+        const size_t row_floats {size_t{width} * 4};
+        Image to {width, height, std::vector<float>(row_floats * height)};
+        for (unsigned y {0}; y < height; ++y) {
+            float* out {to.rgba.data() + y * row_floats};
+            const float* weights {&down.weights[y * down.stride]};
+            for (unsigned k {0}; k < down.count[y]; ++k) {
+                const float* row {
+                    narrow.data() + (down.first[y] + k) * row_floats};
+                for (size_t i {0}; i < row_floats; i += 4) {
+                    store(out + i, madd(load(out + i), load(row + i),
+                                        weights[k]));
+                }
+            }
+        }
+        return to;
+    }
+
+    // linear light is stored to 8 bits through a table this fine, which is
+    // within a fifth of an sRGB step everywhere
+    constexpr unsigned encode_steps {16384};
+
+    struct Tables {
+        std::array<float, 256> decode; // sRGB to linear
+        std::array<unsigned char, encode_steps> encode; // and back
+    };
+
+    auto tables() -> const Tables&
+    {
+        static const Tables tables {[] {
+            Tables t {};
+            for (unsigned i {0}; i < 256; ++i) {
+                const double c {i / 255.0};
+                t.decode[i] = static_cast<float>(
+                    c <= 0.04045 ? c / 12.92
+                                 : std::pow((c + 0.055) / 1.055, 2.4));
+            }
+            for (unsigned i {0}; i < encode_steps; ++i) {
+                const double l {i / (encode_steps - 1.0)};
+                const double c {l <= 0.0031308
+                    ? l * 12.92
+                    : 1.055 * std::pow(l, 1 / 2.4) - 0.055};
+                t.encode[i] = static_cast<unsigned char>(std::lround(c * 255));
+            }
+            return t;
+        }()};
+        return tables;
+    }
+
+    auto to_float(const unsigned char* rgba, unsigned width, unsigned height,
+                  bool srgb) -> Image
+    {
+        const Tables& t {tables()};
+        Image image {width, height, std::vector<float>(
+            size_t{width} * height * 4)};
+        for (size_t i {0}; i < image.rgba.size(); ++i) {
+            image.rgba[i] = srgb && i % 4 != 3
+                ? t.decode[rgba[i]]
+                : rgba[i] * (1.0f / 255);
+        }
+        return image;
+    }
+
+    auto to_bytes(const Image& image, bool srgb, float alpha_scale,
+                  unsigned char* rgba) -> void
+    {
+        const Tables& t {tables()};
+        for (size_t i {0}; i < image.rgba.size(); ++i) {
+            const bool alpha {i % 4 == 3};
+            // the Kaiser filter's negative lobes overshoot
+            const float v {std::clamp(
+                alpha ? image.rgba[i] * alpha_scale : image.rgba[i],
+                0.0f, 1.0f)};
+            rgba[i] = srgb && !alpha
+                ? t.encode[static_cast<size_t>(v * (encode_steps - 1) + 0.5f)]
+                : static_cast<unsigned char>(v * 255 + 0.5f);
+        }
+    }
+
+    // the share of pixels with alpha above `cutoff`
+    auto coverage(const Image& image, float cutoff) -> float
+    {
+        size_t above {0};
+        for (size_t i {3}; i < image.rgba.size(); i += 4) {
+            above += image.rgba[i] > cutoff ? 1 : 0;
+        }
+        return static_cast<float>(above) / (image.rgba.size() / 4);
+    }
+
+    // what to scale the alpha of `image` by for `target` coverage at `cutoff`
+    // (Castano's method, as in NVIDIA's texture tools: find the threshold
+    // with that coverage, then scale it to the cutoff)
+    auto coverage_scale(const Image& image, float cutoff, float target)
+        -> float
+    {
+        const auto pixels {static_cast<float>(image.rgba.size() / 4)};
+        if (std::abs(coverage(image, cutoff) - target) * pixels < 1.0f) {
+            return 1.0f;
+        }
+        float lo {0.0f};
+        float hi {1.0f};
+        for (int i {0}; i < 16; ++i) {
+            const float mid {(lo + hi) / 2};
+            if (coverage(image, mid) >= target) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        return cutoff / std::max((lo + hi) / 2, 1.0f / 255);
+    }
+} // namespace
+
+auto mipmaps::generate(
+    std::vector<unsigned char>& rgba, unsigned width, unsigned height,
+    const Options& options) -> std::vector<Level>
+{
+    std::vector<Level> levels {Level{width, height, 0}};
+    const auto done {[&] {
+        return (options.levels != 0 && levels.size() >= options.levels)
+            || (levels.back().width <= 1 && levels.back().height <= 1);
+    }};
+    if (done()) {
+        return levels;
+    }
+
+    Image level {to_float(rgba.data(), width, height, options.srgb)};
+    const bool keep_coverage {options.alpha_cutoff > 0.0f};
+    const float target {
+        keep_coverage ? coverage(level, options.alpha_cutoff) : 0.0f};
+    rgba.reserve(rgba.size() + rgba.size() / 3 + 4 * 16);
+
+    while (!done()) {
+        // filtered from the float level above, not the rounded one
+        level = resample(
+            level, std::max(level.width / 2, 1u),
+            std::max(level.height / 2, 1u), options.filter);
+        const float scale {keep_coverage
+            ? coverage_scale(level, options.alpha_cutoff, target)
+            : 1.0f};
+        const size_t offset {rgba.size()};
+        rgba.resize(offset + size_t{level.width} * level.height * 4);
+        to_bytes(level, options.srgb, scale, rgba.data() + offset);
+        levels.push_back(Level{level.width, level.height, offset});
+    }
+    return levels;
+}
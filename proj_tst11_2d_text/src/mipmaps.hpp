@@ -0,0 +1,59 @@
+#ifndef SRC_MIPMAPS_HPP_
+#define SRC_MIPMAPS_HPP_
+
+/*******************************************************************************
+ * Mipmap chains made on the CPU, the same on every driver.
+ *
+ * generate() appends all mipmaps below an 8 bit RGBA image to its buffer,
+ * each half the size of the one above (rounded down, at least 1) down to 1x1.
+ * It needs no OpenGL, so it runs on a worker (Texture_manager) or in the
+ * cooker, instead of glGenerateMipmap() on the context thread.
+ *
+ *  - filter: a box (the average of the pixels a mipmap pixel covers) or a
+ *    Kaiser windowed sinc (sharper, what texture tools default to); both work
+ *    for odd sizes too
+ *  - srgb: colour channels are sRGB encoded and averaged in linear light, so
+ *    mipmaps do not get darker; alpha is always linear
+ *  - alpha_cutoff: above 0, alpha is scaled in every mipmap so that the same
+ *    share of pixels as in the image stays above the cutoff, which keeps thin
+ *    glyphs of a font atlas from fading out when minified
+ *  - levels: stop after that many levels (the image included), for atlas
+ *    pages whose gutters only keep the first few apart (see Atlas.hpp)
+ *
+ * Each mipmap is filtered from the one above in floats, a pixel (4 channels)
+ * at a time with SSE2 where the compiler targets it.
+ ******************************************************************************/
+
+#include <cstddef>
+#include <vector>
+
+namespace mipmaps {
+    enum class Filter {
+        box,
+        kaiser
+    };
+
+    struct Options {
+        Filter filter;
+        bool srgb;
+        float alpha_cutoff; // 0 for none
+        unsigned levels {0}; // 0 for all, down to 1x1
+    };
+
+    // for colour textures
+    constexpr Options defaults {Filter::kaiser, true, 0.0f};
+
+    struct Level {
+        unsigned width;
+        unsigned height;
+        size_t offset; // into the buffer
+    };
+
+    // `rgba` holds a `width` x `height` image (4 bytes a pixel), its mipmaps
+    // are appended to it; returns where every level is, the image included
+    auto generate(
+        std::vector<unsigned char>& rgba, unsigned width, unsigned height,
+        const Options& options) -> std::vector<Level>;
+} // namespace mipmaps
+
+#endif // SRC_MIPMAPS_HPP_
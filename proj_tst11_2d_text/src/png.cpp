@@ -0,0 +1,942 @@
+#include "png.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "logs.hpp"
+
+namespace {
+    constexpr unsigned char signature[8] {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    constexpr unsigned max_dimension {16384};
+
+    enum Colour_type : unsigned {
+        grey = 0,
+        rgb = 2,
+        palette = 3,
+        grey_alpha = 4,
+        rgb_alpha = 6
+    };
+
+    // PNG is big endian
+    auto be32(const unsigned char* p) -> uint32_t
+    {
+        return uint32_t{p[0]} << 24 | uint32_t{p[1]} << 16
+            | uint32_t{p[2]} << 8 | uint32_t{p[3]};
+    }
+
+    // inflate (RFC 1950 and 1951) ---------------------------------------------
+
+    // the deflate stream, least significant bit first
+    class Bit_reader final {
+     public:
+        Bit_reader(const unsigned char* data, size_t size)
+        : at{data}
+        , end{data + size}
+        , bits{0}
+        , count{0}
+        , padding{0}
+        {}
+
+        // at least 56 bits buffered, zeros past the end of the stream
+        auto refill() -> void
+        {
+            if (this->end - this->at >= 8) {
+                uint64_t word;
+                std::memcpy(&word, this->at, sizeof(word));
+                this->bits |= word << this->count;
+                this->at += (63 - this->count) >> 3;
+                this->count |= 56;
+                return;
+            }
+            while (this->count <= 56) {
+                uint64_t byte {0};
+                if (this->at < this->end) {
+                    byte = *this->at++;
+                } else {
+                    ++this->padding;
+                }
+                this->bits |= byte << this->count;
+                this->count += 8;
+            }
+        }
+
+        auto peek(unsigned n) const -> unsigned
+        {
+            return static_cast<unsigned>(this->bits & ((uint64_t{1} << n) - 1));
+        }
+
+        auto consume(unsigned n) -> void
+        {
+            this->bits >>= n;
+            this->count -= n;
+        }
+
+        // `n` <= 16 bits
+        auto get(unsigned n) -> unsigned
+        {
+            if (this->count < n) {
+                this->refill();
+            }
+            const unsigned value {this->peek(n)};
+            this->consume(n);
+            return value;
+        }
+
+        auto align() -> void
+        {
+            this->consume(this->count % 8);
+        }
+
+        // `n` bytes straight from the stream, after align(), false if it has
+        // fewer left
+        auto copy(unsigned char* to, size_t n) -> bool
+        {
+            for (; n > 0 && this->count >= 8; --n) {
+                *to++ = static_cast<unsigned char>(this->bits);
+                this->consume(8);
+            }
+            if (n == 0) {
+                return true;
+            }
+            if (n > static_cast<size_t>(this->end - this->at)) {
+                return false;
+            }
+            // the buffer is empty, but refill() leaves the bits of `at` above
+            // `count`, which are not what follows any more
+            this->bits = 0;
+            std::memcpy(to, this->at, n);
+            this->at += n;
+            return true;
+        }
+
+        // read past the end of the stream
+        auto exhausted() const -> bool
+        {
+            return this->padding * 8 > this->count;
+        }
+
+     private:
+        const unsigned char* at;
+        const unsigned char* end;
+        uint64_t bits;
+        unsigned count;
+        size_t padding; // zero bytes fed in past the end
+    };
+
+    struct Huffman {
+        // codes up to this long are decoded with one lookup
+        static constexpr unsigned fast_bits {10};
+
+        std::array<uint16_t, 1u << fast_bits> fast; // symbol << 4 | length
+        std::array<uint16_t, 16> counts; // codes of each length
+        std::array<uint16_t, 288> symbols; // sorted by code
+    };
+
+    // canonical codes from their lengths, false if over-subscribed
+    // (incomplete sets are fine, a single distance code is one)
+    auto build(Huffman& huffman, const uint8_t* lengths, unsigned n) -> bool
+    {
+        huffman.counts.fill(0);
+        for (unsigned symbol {0}; symbol < n; ++symbol) {
+            ++huffman.counts[lengths[symbol]];
+        }
+        huffman.counts[0] = 0;
+
+        int left {1};
+        for (unsigned length {1}; length < 16; ++length) {
+            left = left * 2 - huffman.counts[length];
+            if (left < 0) {
+                return false;
+            }
+        }
+
+        std::array<uint16_t, 16> offsets {};
+        for (unsigned length {1}; length < 15; ++length) {
+            offsets[length + 1] = offsets[length] + huffman.counts[length];
+        }
+        for (unsigned symbol {0}; symbol < n; ++symbol) {
+            if (lengths[symbol] != 0) {
+                huffman.symbols[offsets[lengths[symbol]]++] =
+                    static_cast<uint16_t>(symbol);
+            }
+        }
+
+        // every entry whose low bits are a short code (sent most significant
+        // bit first, so reversed here) decodes to its symbol
+        huffman.fast.fill(0);
+        unsigned code {0};
+        unsigned index {0};
+        for (unsigned length {1}; length <= Huffman::fast_bits; ++length) {
+            for (unsigned i {0}; i < huffman.counts[length]; ++i, ++code) {
+                unsigned reversed {0};
+                for (unsigned bit {0}; bit < length; ++bit) {
+                    reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+                }
+                const auto entry {static_cast<uint16_t>(
+                    huffman.symbols[index++] << 4 | length)};
+                for (unsigned at {reversed}; at < huffman.fast.size();
+                     at += 1u << length) {
+                    huffman.fast[at] = entry;
+                }
+            }
+            code <<= 1;
+        }
+        return true;
+    }
+
+    // the next symbol, -1 if the bits are no code
+    auto decode(Bit_reader& in, const Huffman& huffman) -> int
+    {
+        in.refill();
+        const uint16_t entry {huffman.fast[in.peek(Huffman::fast_bits)]};
+        if (entry != 0) {
+            in.consume(entry & 15);
+            return entry >> 4;
+        }
+
+        // longer codes a bit at a time
+        int code {0};
+        int first {0};
+        int index {0};
+        for (unsigned length {1}; length < 16; ++length) {
+            code |= static_cast<int>(in.get(1));
+            const int count {huffman.counts[length]};
+            if (code - first < count) {
+                return huffman.symbols[static_cast<size_t>(
+                    index + code - first)];
+            }
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+    constexpr uint16_t length_base[29] {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    constexpr uint8_t length_extra[29] {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    constexpr uint16_t distance_base[30] {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+        8193, 12289, 16385, 24577};
+    constexpr uint8_t distance_extra[30] {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    struct Output {
+        unsigned char* data;
+        size_t size;
+        size_t at;
+    };
+
+    // the symbols of one block, up to its end code
+    auto inflate_codes(
+        Bit_reader& in, const Huffman& literals, const Huffman& distances,
+        Output& out) -> bool
+    {
+        for (;;) {
+            if (in.exhausted()) {
+                return false;
+            }
+            int symbol {decode(in, literals)};
+            if (symbol < 0) {
+                return false;
+            }
+            if (symbol < 256) {
+                if (out.at == out.size) {
+                    return false;
+                }
+                out.data[out.at++] = static_cast<unsigned char>(symbol);
+                continue;
+            }
+            if (symbol == 256) {
+                return true;
+            }
+
+            symbol -= 257;
+            if (symbol >= 29) {
+                return false;
+            }
+            const size_t length {
+                length_base[symbol] + in.get(length_extra[symbol])};
+            const int code {decode(in, distances)};
+            if (code < 0 || code >= 30) {
+                return false;
+            }
+            const size_t distance {
+                distance_base[code] + in.get(distance_extra[code])};
+            if (distance > out.at || length > out.size - out.at) {
+                return false;
+            }
+
+            unsigned char* to {out.data + out.at};
+            const unsigned char* from {to - distance};
+            if (distance >= 8 && out.size - out.at - length >= 8) {
+                // 8 bytes at a time, overshooting by up to 7 (the next
+                // symbols overwrite them); with a distance of 8 or more every
+                // word read is written already
+                for (size_t i {0}; i < length; i += 8) {
+                    uint64_t word;
+                    std::memcpy(&word, from + i, sizeof(word));
+                    std::memcpy(to + i, &word, sizeof(word));
+                }
+            } else if (distance == 1) {
+                std::memset(to, *from, length);
+            } else if (distance >= length) {
+                std::memcpy(to, from, length);
+            } else {
+                // overlapping: repeats the last `distance` bytes
+                for (size_t i {0}; i < length; ++i) {
+                    to[i] = from[i];
+                }
+            }
+            out.at += length;
+        }
+    }
+
+    auto fixed_codes(Huffman& literals, Huffman& distances) -> void
+    {
+        uint8_t lengths[288];
+        std::fill(lengths, lengths + 144, 8);
+        std::fill(lengths + 144, lengths + 256, 9);
+        std::fill(lengths + 256, lengths + 280, 7);
+        std::fill(lengths + 280, lengths + 288, 8);
+        build(literals, lengths, 288);
+        std::fill(lengths, lengths + 30, 5);
+        build(distances, lengths, 30);
+    }
+
+    auto dynamic_codes(Bit_reader& in, Huffman& literals, Huffman& distances)
+        -> bool
+    {
+        constexpr uint8_t order[19] {
+            16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+        const unsigned literal_count {in.get(5) + 257};
+        const unsigned distance_count {in.get(5) + 1};
+        const unsigned length_count {in.get(4) + 4};
+        if (literal_count > 286 || distance_count > 30) {
+            return false;
+        }
+
+        uint8_t code_lengths[19] {};
+        for (unsigned i {0}; i < length_count; ++i) {
+            code_lengths[order[i]] = static_cast<uint8_t>(in.get(3));
+        }
+        Huffman lengths_code;
+        if (!build(lengths_code, code_lengths, 19)) {
+            return false;
+        }
+
+        uint8_t lengths[286 + 30] {};
+        const unsigned total {literal_count + distance_count};
+        unsigned index {0};
+        while (index < total) {
+            const int symbol {decode(in, lengths_code)};
+            if (symbol < 0) {
+                return false;
+            }
+            if (symbol < 16) {
+                lengths[index++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            uint8_t value {0};
+            unsigned repeat;
+            if (symbol == 16) {
+                if (index == 0) {
+                    return false;
+                }
+                value = lengths[index - 1];
+                repeat = 3 + in.get(2);
+            } else if (symbol == 17) {
+                repeat = 3 + in.get(3);
+            } else {
+                repeat = 11 + in.get(7);
+            }
+            if (index + repeat > total) {
+                return false;
+            }
+            std::fill(lengths + index, lengths + index + repeat, value);
+            index += repeat;
+        }
+
+        // a block without an end code could not end
+        return lengths[256] != 0
+            && build(literals, lengths, literal_count)
+            && build(distances, lengths + literal_count, distance_count);
+    }
+
+    // a zlib stream that has to fill `size` bytes exactly
+    auto inflate(
+        const unsigned char* data, size_t data_size,
+        unsigned char* to, size_t size) -> bool
+    {
+        // CM 8 (deflate), no preset dictionary, FCHECK
+        if (data_size < 2 || (data[0] & 0x0f) != 8 || (data[1] & 0x20) != 0
+            || (data[0] << 8 | data[1]) % 31 != 0) {
+            return false;
+        }
+
+        Bit_reader in {data + 2, data_size - 2};
+        Output out {to, size, 0};
+        Huffman literals;
+        Huffman distances;
+        bool last {false};
+        while (!last) {
+            last = in.get(1) != 0;
+            switch (in.get(2)) {
+            case 0: {
+                in.align();
+                const unsigned length {in.get(16)};
+                if (length != (~in.get(16) & 0xffff)
+                    || length > out.size - out.at
+                    || !in.copy(out.data + out.at, length)) {
+                    return false;
+                }
+                out.at += length;
+                break;
+            }
+            case 1:
+                fixed_codes(literals, distances);
+                if (!inflate_codes(in, literals, distances, out)) {
+                    return false;
+                }
+                break;
+            case 2:
+                if (!dynamic_codes(in, literals, distances)
+                    || !inflate_codes(in, literals, distances, out)) {
+                    return false;
+                }
+                break;
+            default:
+                return false;
+            }
+            if (in.exhausted()) {
+                return false;
+            }
+        }
+        return out.at == out.size;
+    }
+
+    // PNG -----------------------------------------------------------------
+
+    struct Header {
+        unsigned width;
+        unsigned height;
+        unsigned depth; // bits per channel
+        unsigned colour_type;
+        unsigned channels;
+        size_t stride; // bytes per row, without the filter byte
+        unsigned pixel_bytes; // for the filters, at least 1
+    };
+
+    auto paeth(int a, int b, int c) -> int
+    {
+        const int p {a + b - c};
+        const int pa {std::abs(p - a)};
+        const int pb {std::abs(p - b)};
+        const int pc {std::abs(p - c)};
+        if (pa <= pb && pa <= pc) {
+            return a;
+        }
+        return pb <= pc ? b : c;
+    }
+
+#if defined(__SSE2__)
+    // Sub, Avg and Paeth go from pixel to pixel, but the 3 or 4 bytes of a
+    // pixel are independent: each kernel below does a whole pixel at once
+    // (the 4th byte of an RGB pixel is loaded and dropped again)
+
+    auto load_pixel(const unsigned char* p, unsigned bpp) -> __m128i
+    {
+        int32_t v {0};
+        std::memcpy(&v, p, bpp);
+        return _mm_cvtsi32_si128(v);
+    }
+
+    auto store_pixel(unsigned char* p, unsigned bpp, __m128i pixel) -> void
+    {
+        const int32_t v {_mm_cvtsi128_si32(pixel)};
+        std::memcpy(p, &v, bpp);
+    }
+
+    auto sub_sse2(unsigned char* row, size_t stride, unsigned bpp) -> void
+    {
+        __m128i left {_mm_setzero_si128()};
+        for (size_t i {0}; i < stride; i += bpp) {
+            left = _mm_add_epi8(load_pixel(row + i, bpp), left);
+            store_pixel(row + i, bpp, left);
+        }
+    }
+
+    auto avg_sse2(
+        unsigned char* row, const unsigned char* prior, size_t stride,
+        unsigned bpp) -> void
+    {
+        const __m128i one {_mm_set1_epi8(1)};
+        __m128i left {_mm_setzero_si128()};
+        for (size_t i {0}; i < stride; i += bpp) {
+            const __m128i up {load_pixel(prior + i, bpp)};
+            // pavgb rounds up, the filter rounds down
+            const __m128i average {_mm_sub_epi8(
+                _mm_avg_epu8(left, up),
+                _mm_and_si128(_mm_xor_si128(left, up), one))};
+            left = _mm_add_epi8(load_pixel(row + i, bpp), average);
+            store_pixel(row + i, bpp, left);
+        }
+    }
+
+    auto abs_epi16(__m128i x) -> __m128i
+    {
+        return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+    }
+
+    // `a` where `mask` is set, `b` elsewhere
+    auto select(__m128i mask, __m128i a, __m128i b) -> __m128i
+    {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    auto paeth_sse2(
+        unsigned char* row, const unsigned char* prior, size_t stride,
+        unsigned bpp) -> void
+    {
+        // 16 bit lanes, the predictor's differences need 9 bits and a sign
+        const __m128i zero {_mm_setzero_si128()};
+        __m128i left {zero};
+        __m128i corner {zero};
+        for (size_t i {0}; i < stride; i += bpp) {
+            const __m128i up {
+                _mm_unpacklo_epi8(load_pixel(prior + i, bpp), zero)};
+            const __m128i d {
+                _mm_unpacklo_epi8(load_pixel(row + i, bpp), zero)};
+
+            // p - a = b - c, p - b = a - c, p - c = both
+            const __m128i pa_signed {_mm_sub_epi16(up, corner)};
+            const __m128i pb_signed {_mm_sub_epi16(left, corner)};
+            const __m128i pa {abs_epi16(pa_signed)};
+            const __m128i pb {abs_epi16(pb_signed)};
+            const __m128i pc {
+                abs_epi16(_mm_add_epi16(pa_signed, pb_signed))};
+            const __m128i smallest {
+                _mm_min_epi16(pc, _mm_min_epi16(pa, pb))};
+            const __m128i nearest {select(
+                _mm_cmpeq_epi16(smallest, pa), left,
+                select(_mm_cmpeq_epi16(smallest, pb), up, corner))};
+
+            // the high bytes are zero, so adding bytes wraps like the filter
+            left = _mm_add_epi8(d, nearest);
+            store_pixel(row + i, bpp, _mm_packus_epi16(left, left));
+            corner = up;
+        }
+    }
+#endif
+
+    // undo the filter of one row in place, `prior` is the row above
+    // (unfiltered already) or zeros
+    auto unfilter(
+        unsigned filter, unsigned char* row, const unsigned char* prior,
+        size_t stride, unsigned bpp) -> bool
+    {
+#if defined(__SSE2__)
+        const bool pixels {bpp == 3 || bpp == 4};
+#endif
+        switch (filter) {
+        case 0:
+            break;
+        case 1:
+#if defined(__SSE2__)
+            if (pixels) {
+                sub_sse2(row, stride, bpp);
+                break;
+            }
+#endif
+            for (size_t i {bpp}; i < stride; ++i) {
+                row[i] = static_cast<unsigned char>(row[i] + row[i - bpp]);
+            }
+            break;
+        case 2: {
+            size_t i {0};
+#if defined(__SSE2__)
+            for (; i + 16 <= stride; i += 16) {
+                const auto* up {reinterpret_cast<const __m128i*>(prior + i)};
+                auto* at {reinterpret_cast<__m128i*>(row + i)};
+                _mm_storeu_si128(
+                    at, _mm_add_epi8(_mm_loadu_si128(at), _mm_loadu_si128(up)));
+            }
+#endif
+            for (; i < stride; ++i) {
+                row[i] = static_cast<unsigned char>(row[i] + prior[i]);
+            }
+            break;
+        }
+        case 3:
+#if defined(__SSE2__)
+            if (pixels) {
+                avg_sse2(row, prior, stride, bpp);
+                break;
+            }
+#endif
+            for (size_t i {0}; i < stride; ++i) {
+                const unsigned left {i >= bpp ? row[i - bpp] : 0u};
+                row[i] = static_cast<unsigned char>(
+                    row[i] + ((left + prior[i]) >> 1));
+            }
+            break;
+        case 4:
+#if defined(__SSE2__)
+            if (pixels) {
+                paeth_sse2(row, prior, stride, bpp);
+                break;
+            }
+#endif
+            for (size_t i {0}; i < stride; ++i) {
+                const int left {i >= bpp ? row[i - bpp] : 0};
+                const int corner {i >= bpp ? prior[i - bpp] : 0};
+                row[i] = static_cast<unsigned char>(
+                    row[i] + paeth(left, prior[i], corner));
+            }
+            break;
+        default:
+            return false;
+        }
+        return true;
+    }
+
+    // sample `x` of a row of `depth` bit samples, as stored
+    auto sample(const unsigned char* row, size_t x, unsigned depth) -> unsigned
+    {
+        switch (depth) {
+        case 8:
+            return row[x];
+        case 16:
+            return unsigned{row[2 * x]} << 8 | row[2 * x + 1];
+        default:
+            const size_t bit {x * depth};
+            const unsigned shift {8 - depth - static_cast<unsigned>(bit % 8)};
+            return (row[bit / 8] >> shift) & ((1u << depth) - 1);
+        }
+    }
+
+    auto to_8bit(unsigned value, unsigned depth) -> unsigned char
+    {
+        if (depth == 16) {
+            return static_cast<unsigned char>(value >> 8);
+        }
+        return static_cast<unsigned char>(value * 255 / ((1u << depth) - 1));
+    }
+
+    struct Colours {
+        const unsigned char* palette; // RGB
+        unsigned palette_size;
+        const unsigned char* transparency; // tRNS chunk
+        unsigned transparency_size;
+    };
+
+    auto to_rgba(
+        const Header& header, const Colours& colours,
+        const unsigned char* row, unsigned char* out) -> void
+    {
+        const unsigned depth {header.depth};
+        // a tRNS colour key for grey and RGB images, as stored
+        const bool keyed {colours.transparency != nullptr
+            && header.colour_type != palette};
+        const unsigned char* key {colours.transparency};
+
+        // the usual 8 bit layouts, without the dispatch per sample
+        if (depth == 8 && !keyed && header.colour_type != palette) {
+            const size_t width {header.width};
+            switch (header.colour_type) {
+            case rgb_alpha:
+                std::memcpy(out, row, width * 4);
+                break;
+            case rgb:
+                for (size_t x {0}; x < width; ++x, row += 3, out += 4) {
+                    out[0] = row[0];
+                    out[1] = row[1];
+                    out[2] = row[2];
+                    out[3] = 255;
+                }
+                break;
+            case grey_alpha:
+                for (size_t x {0}; x < width; ++x, row += 2, out += 4) {
+                    out[0] = out[1] = out[2] = row[0];
+                    out[3] = row[1];
+                }
+                break;
+            default: // grey
+                for (size_t x {0}; x < width; ++x, ++row, out += 4) {
+                    out[0] = out[1] = out[2] = row[0];
+                    out[3] = 255;
+                }
+                break;
+            }
+            return;
+        }
+
+        for (size_t x {0}; x < header.width; ++x, out += 4) {
+            switch (header.colour_type) {
+            case grey: {
+                const unsigned v {sample(row, x, depth)};
+                out[0] = out[1] = out[2] = to_8bit(v, depth);
+                out[3] = keyed && v == (unsigned{key[0]} << 8 | key[1])
+                    ? 0 : 255;
+                break;
+            }
+            case rgb: {
+                unsigned v[3];
+                for (unsigned c {0}; c < 3; ++c) {
+                    v[c] = sample(row, 3 * x + c, depth);
+                    out[c] = to_8bit(v[c], depth);
+                }
+                out[3] = keyed && v[0] == (unsigned{key[0]} << 8 | key[1])
+                        && v[1] == (unsigned{key[2]} << 8 | key[3])
+                        && v[2] == (unsigned{key[4]} << 8 | key[5])
+                    ? 0 : 255;
+                break;
+            }
+            case palette: {
+                const unsigned i {sample(row, x, depth)};
+                if (i < colours.palette_size) {
+                    std::memcpy(out, colours.palette + 3 * i, 3);
+                } else {
+                    out[0] = out[1] = out[2] = 0;
+                }
+                out[3] = i < colours.transparency_size
+                    ? colours.transparency[i] : 255;
+                break;
+            }
+            case grey_alpha:
+                out[0] = out[1] = out[2] =
+                    to_8bit(sample(row, 2 * x, depth), depth);
+                out[3] = to_8bit(sample(row, 2 * x + 1, depth), depth);
+                break;
+            default: // rgb_alpha
+                for (unsigned c {0}; c < 4; ++c) {
+                    out[c] = to_8bit(sample(row, 4 * x + c, depth), depth);
+                }
+                break;
+            }
+        }
+    }
+
+    auto read_header(const unsigned char* data, Header& header) -> bool
+    {
+        header.width = be32(data);
+        header.height = be32(data + 4);
+        header.depth = data[8];
+        header.colour_type = data[9];
+        if (header.width == 0 || header.height == 0
+            || header.width > max_dimension || header.height > max_dimension
+            || data[10] != 0 || data[11] != 0) {
+            return false;
+        }
+
+        const unsigned d {header.depth};
+        switch (header.colour_type) {
+        case grey:
+            header.channels = 1;
+            if (d != 1 && d != 2 && d != 4 && d != 8 && d != 16) {
+                return false;
+            }
+            break;
+        case palette:
+            header.channels = 1;
+            if (d != 1 && d != 2 && d != 4 && d != 8) {
+                return false;
+            }
+            break;
+        case rgb:
+        case grey_alpha:
+        case rgb_alpha:
+            header.channels = header.colour_type == rgb ? 3
+                : header.colour_type == grey_alpha ? 2 : 4;
+            if (d != 8 && d != 16) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+
+        const size_t bits {size_t{header.width} * header.channels * d};
+        header.stride = (bits + 7) / 8;
+        header.pixel_bytes = std::max(header.channels * d / 8, 1u);
+        return true;
+    }
+
+    // the chunks decoding needs
+    struct Chunks {
+        Header header;
+        Colours colours;
+        std::string_view stream; // the zlib stream
+        std::vector<unsigned char> joined; // of several IDAT chunks
+    };
+
+    auto parse_header(
+        const std::string& name, std::string_view file, Header& header)
+        -> bool
+    {
+        const auto* data {reinterpret_cast<const unsigned char*>(file.data())};
+        if (file.size() < sizeof(signature)
+            || std::memcmp(data, signature, sizeof(signature)) != 0) {
+            logs::err(name, " is not a PNG file");
+            return false;
+        }
+        // IHDR comes first: length, type, 13 bytes, CRC
+        if (file.size() < sizeof(signature) + 25
+            || be32(data + 8) != 13 || std::memcmp(data + 12, "IHDR", 4) != 0
+            || !read_header(data + 16, header)) {
+            logs::err(name, ": unsupported or corrupt PNG header");
+            return false;
+        }
+        if (data[16 + 12] != 0) {
+            logs::err(name, ": interlaced PNGs are not supported");
+            return false;
+        }
+        return true;
+    }
+
+    auto parse(const std::string& name, std::string_view file, Chunks& chunks)
+        -> bool
+    {
+        if (!parse_header(name, file, chunks.header)) {
+            return false;
+        }
+        const auto* data {reinterpret_cast<const unsigned char*>(file.data())};
+        const size_t size {file.size()};
+        const Header& header {chunks.header};
+        Colours& colours {chunks.colours};
+        colours = Colours{nullptr, 0, nullptr, 0};
+        std::vector<std::string_view> idat;
+
+        // chunks after IHDR: length, type, data, CRC
+        size_t at {sizeof(signature) + 25};
+        bool ended {false};
+        while (!ended && size - at >= 12) {
+            const uint32_t length {be32(data + at)};
+            const unsigned char* type {data + at + 4};
+            const char* chunk {file.data() + at + 8};
+            if (length > size - at - 12) {
+                break;
+            }
+            at += 12 + size_t{length};
+
+            if (std::memcmp(type, "PLTE", 4) == 0) {
+                colours.palette = reinterpret_cast<const unsigned char*>(chunk);
+                colours.palette_size = std::min(length / 3, 256u);
+            } else if (std::memcmp(type, "tRNS", 4) == 0) {
+                // a grey key is 2 bytes, an RGB one 6
+                const uint32_t key_size {header.colour_type == rgb ? 6u : 2u};
+                if (header.colour_type == palette || length >= key_size) {
+                    colours.transparency =
+                        reinterpret_cast<const unsigned char*>(chunk);
+                    colours.transparency_size = length;
+                }
+            } else if (std::memcmp(type, "IDAT", 4) == 0) {
+                idat.emplace_back(chunk, length);
+            } else if (std::memcmp(type, "IEND", 4) == 0) {
+                ended = true;
+            }
+        }
+        if (!ended || idat.empty()) {
+            logs::err(name, " is truncated");
+            return false;
+        }
+        if (header.colour_type == palette && colours.palette == nullptr) {
+            logs::err(name, ": palette missing");
+            return false;
+        }
+
+        // the stream is inflated where it is if it is in one piece
+        if (idat.size() == 1) {
+            chunks.stream = idat.front();
+            return true;
+        }
+        for (std::string_view part : idat) {
+            chunks.joined.insert(chunks.joined.end(), part.begin(), part.end());
+        }
+        chunks.stream = std::string_view{
+            reinterpret_cast<const char*>(chunks.joined.data()),
+            chunks.joined.size()};
+        return true;
+    }
+} // namespace
+
+auto png::info(const std::string& name, std::string_view file, Info& info)
+    -> bool
+{
+    Header header {};
+    if (!parse_header(name, file, header)) {
+        return false;
+    }
+    info.width = header.width;
+    info.height = header.height;
+    return true;
+}
+
+auto png::decode(
+    const std::string& name, std::string_view file, unsigned char* rgba,
+    size_t size) -> bool
+{
+    Chunks chunks {};
+    if (!parse(name, file, chunks)) {
+        return false;
+    }
+    const Header& header {chunks.header};
+    const size_t out_stride {size_t{header.width} * 4};
+    if (size != out_stride * header.height) {
+        logs::err(name, ": ", size, " bytes is the wrong size for the image");
+        return false;
+    }
+
+    const size_t row_size {header.stride + 1}; // with the filter type
+    std::vector<unsigned char> raw(header.height * row_size);
+    if (!inflate(
+            reinterpret_cast<const unsigned char*>(chunks.stream.data()),
+            chunks.stream.size(), raw.data(), raw.size())) {
+        logs::err(name, ": corrupt image data");
+        return false;
+    }
+
+    // row by row, each converted while it is in the cache
+    const std::vector<unsigned char> zeros(header.stride, 0);
+    const unsigned char* prior {zeros.data()};
+    for (unsigned y {0}; y < header.height; ++y) {
+        unsigned char* row {raw.data() + y * row_size};
+        if (!unfilter(
+                row[0], row + 1, prior, header.stride, header.pixel_bytes)) {
+            logs::err(name, ": corrupt image data");
+            return false;
+        }
+        to_rgba(header, chunks.colours, row + 1, rgba + y * out_stride);
+        prior = row + 1;
+    }
+    DBG(2, name, ": ", header.width, "x", header.height, " PNG, colour type ",
+        header.colour_type, ", ", header.depth, " bits");
+    return true;
+}
+
+auto png::decode(const std::string& name, std::string_view file, Image& image)
+    -> bool
+{
+    Info info {};
+    if (!png::info(name, file, info)) {
+        return false;
+    }
+    image.width = info.width;
+    image.height = info.height;
+    image.rgba.resize(size_t{info.width} * info.height * 4);
+    return png::decode(name, file, image.rgba.data(), image.rgba.size());
+}
@@ -0,0 +1,59 @@
+#ifndef SRC_PNG_HPP_
+#define SRC_PNG_HPP_
+
+/*******************************************************************************
+ * PNG decoding, without a library.
+ *
+ * decode() inflates the image data (its own inflate, zlib is not a dependency
+ * of the project), undoes the row filters and converts every pixel to 8 bit
+ * RGBA, whatever the file's colour type and bit depth (16 bit channels keep
+ * their high byte, palettes and tRNS transparency are applied). It writes
+ * into the caller's memory, so a texture can be decoded straight to where it
+ * is uploaded from: info() reads the size from the header first.
+ *
+ * The work is done a row at a time, each row converted right after it is
+ * unfiltered, while it is in the cache. Long matches are inflated 8 bytes at
+ * a time, and the Sub, Avg and Paeth filters of RGB and RGBA rows a whole
+ * pixel at a time with SSE2 (Up 16 bytes at a time) where the compiler
+ * targets it. decode() keeps no state, so images decode in parallel on
+ * different threads.
+ *
+ * Interlaced files are rejected. Chunk CRCs and the zlib checksum are not
+ * verified, but every read is bounds checked, so a corrupt file fails to
+ * decode (or decodes to garbage) rather than reading or writing out of bounds.
+ ******************************************************************************/
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace png {
+    struct Image {
+        unsigned width;
+        unsigned height;
+        std::vector<unsigned char> rgba; // rows top to bottom, 4 bytes a pixel
+    };
+
+    struct Info {
+        unsigned width;
+        unsigned height;
+    };
+
+    // the size of the image in `file`, from its header, false (and an error
+    // about `name` logged) if it is not a PNG this can decode
+    auto info(const std::string& name, std::string_view file, Info& info)
+        -> bool;
+
+    // decode the image in `file` into `rgba`, `size` bytes that have to be
+    // exactly width * height * 4, false (and an error logged) if it fails
+    auto decode(
+        const std::string& name, std::string_view file, unsigned char* rgba,
+        size_t size) -> bool;
+
+    // the same into `image`, sized to fit
+    auto decode(const std::string& name, std::string_view file, Image& image)
+        -> bool;
+} // namespace png
+
+#endif // SRC_PNG_HPP_
@@ -0,0 +1,244 @@
+#include "program_cache.hpp"
+
+#include "gl_loader.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "logs.hpp"
+#include "gl_capture.hpp"
+#include "gl_intercept.hpp"
+
+namespace {
+    constexpr char file_magic[8] {"GLPROG1"};
+    constexpr uint32_t max_binary_size {64 << 20}; // anything over is garbage
+
+    // layout of the file, followed by `size` bytes of binary
+    struct File_header {
+        char magic[8];
+        uint64_t key;
+        uint32_t format;
+        uint32_t size;
+    };
+
+    enum class Support {
+        unknown,
+        yes,
+        no
+    };
+
+    Support support {Support::unknown};
+
+    // programs loaded or stored during this run, both ways
+    std::unordered_map<uint64_t, GLuint> programs;
+    std::unordered_map<GLuint, uint64_t> keys;
+
+    // FNV-1a, fine for keying files, not for anything adversarial
+    constexpr uint64_t fnv_basis {0xcbf29ce484222325};
+    constexpr uint64_t fnv_prime {0x100000001b3};
+
+    auto fnv(uint64_t hash, std::string_view data) -> uint64_t
+    {
+        for (const char c : data) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= fnv_prime;
+        }
+        // separator, so {"ab", "c"} and {"a", "bc"} differ
+        hash ^= 0xff;
+        hash *= fnv_prime;
+        return hash;
+    }
+
+    auto gl_string(GLenum name) -> std::string_view
+    {
+        const auto* str {reinterpret_cast<const char*>(glGetString(name))};
+        return str != nullptr ? str : "";
+    }
+
+    auto supported() -> bool
+    {
+        if (support == Support::unknown) {
+            GLint formats {0};
+            if (gl_loader::has("GL_ARB_get_program_binary")
+                || gl_loader::version(4, 1)) {
+                glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            }
+            support = formats > 0 ? Support::yes : Support::no;
+            if (support == Support::no) {
+                logs::info("program binaries not supported, shader cache off");
+            }
+        }
+
+        // the replayer rebuilds programs from the captured sources
+        return support == Support::yes && !gl_capture::is_recording();
+    }
+
+    auto remember(uint64_t key, GLuint program) -> void
+    {
+        programs[key] = program;
+        keys[program] = key;
+    }
+
+    auto path(uint64_t key) -> std::string
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016" PRIx64 ".bin", key);
+        return std::string(program_cache::dir) + "/" + name;
+    }
+} // namespace
+
+namespace program_cache {
+    auto key(std::initializer_list<std::string_view> parts) -> uint64_t
+    {
+        uint64_t hash {fnv_basis};
+        hash = fnv(hash, gl_string(GL_VENDOR));
+        hash = fnv(hash, gl_string(GL_RENDERER));
+        hash = fnv(hash, gl_string(GL_VERSION));
+        for (const auto& part : parts) {
+            hash = fnv(hash, part);
+        }
+        return hash;
+    }
+
+    auto load(uint64_t key) -> GLuint
+    {
+        if (!supported()) {
+            return 0;
+        }
+
+        const std::string file_path {path(key)};
+        std::ifstream file(file_path, std::ios::in | std::ios::binary);
+        if (!file.is_open()) {
+            DBG(1, "shader cache miss: ", file_path);
+            return 0;
+        }
+
+        File_header header {};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        const bool valid {
+            file
+            && memcmp(header.magic, file_magic, sizeof(file_magic)) == 0
+            && header.key == key
+            && header.size <= max_binary_size};
+        std::vector<char> binary(valid ? header.size : 0);
+        file.read(binary.data(), binary.size());
+        if (!valid || !file) {
+            logs::err("broken shader cache file ", file_path, ", removing");
+            file.close();
+            std::error_code ec;
+            std::filesystem::remove(file_path, ec);
+            return 0;
+        }
+        file.close();
+
+        GLuint program {glCreateProgram()};
+        glProgramBinary(
+            program, header.format, binary.data(),
+            static_cast<GLsizei>(binary.size()));
+
+        GLint linked {GL_FALSE};
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked != GL_TRUE) {
+            // happens after driver updates the version string did not catch
+            logs::info("driver rejected cached program ", file_path);
+            glDeleteProgram(program);
+            std::error_code ec;
+            std::filesystem::remove(file_path, ec);
+            return 0;
+        }
+
+        DBG(1, "shader program loaded from cache: ", file_path);
+        remember(key, program);
+        return program;
+    }
+
+    auto prepare(GLuint program) -> void
+    {
+        if (supported()) {
+            glProgramParameteri(
+                program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+    }
+
+    auto store(uint64_t key, GLuint program) -> bool
+    {
+        GLint linked {GL_FALSE};
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked != GL_TRUE) {
+            return false;
+        }
+        remember(key, program);
+
+        if (!supported()) {
+            return false;
+        }
+
+        GLint size {0};
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+        if (size <= 0) {
+            return false;
+        }
+
+        File_header header {};
+        memcpy(header.magic, file_magic, sizeof(file_magic));
+        header.key = key;
+        std::vector<char> binary(size);
+        GLsizei written {0};
+        GLenum format {0};
+        glGetProgramBinary(program, size, &written, &format, binary.data());
+        header.format = format;
+        header.size = static_cast<uint32_t>(written);
+
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if (ec) {
+            logs::err("can not create ", dir, ": ", ec.message());
+            return false;
+        }
+
+        // written under a temporary name and renamed, so an interrupted write
+        // never leaves a truncated file behind
+        const std::string file_path {path(key)};
+        const std::string tmp_path {file_path + ".tmp"};
+        std::ofstream file(tmp_path, std::ios::out | std::ios::binary);
+        if (!file.is_open()) {
+            logs::err("can not open ", tmp_path, " for writing");
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), written);
+        file.close();
+        if (!file) {
+            logs::err("could not write ", tmp_path);
+            std::filesystem::remove(tmp_path, ec);
+            return false;
+        }
+
+        std::filesystem::rename(tmp_path, file_path, ec);
+        if (ec) {
+            logs::err("could not move ", tmp_path, ": ", ec.message());
+            return false;
+        }
+
+        DBG(1, "shader program stored in cache: ", file_path);
+        return true;
+    }
+
+    auto program_of(uint64_t key) -> GLuint
+    {
+        const auto it {programs.find(key)};
+        return it == programs.end() ? 0 : it->second;
+    }
+
+    auto key_of(GLuint program) -> uint64_t
+    {
+        const auto it {keys.find(program)};
+        return it == keys.end() ? 0 : it->second;
+    }
+} // namespace program_cache
@@ -0,0 +1,58 @@
+#ifndef SRC_PROGRAM_CACHE_HPP_
+#define SRC_PROGRAM_CACHE_HPP_
+
+/*******************************************************************************
+ * On-disk cache of linked shader programs (glGetProgramBinary/glProgramBinary).
+ *
+ * A program is keyed by a hash of everything it is built from (sources, defines)
+ * together with the GL vendor, renderer and version strings, so a driver update
+ * or a different GPU never picks up a stale binary. Binaries live in
+ * `cache/shaders/<key>.bin`, one file per program.
+ *
+ * Drivers are free to reject a binary they produced earlier, so a failed load
+ * just deletes the file and the caller compiles from source as usual:
+ *
+ *     const auto key {program_cache::key({vert_src, frag_src})};
+ *     GLuint program {program_cache::load(key)};
+ *     if (program == 0) {
+ *         program = glCreateProgram();
+ *         program_cache::prepare(program);
+ *         ... attach, link ...
+ *         program_cache::store(key, program);
+ *     }
+ *
+ * Without GL_ARB_get_program_binary (or while a GL capture is recording, the
+ * replayer needs the sources) everything is a miss and store() does nothing.
+ *
+ * Either way load() and store() remember which program was built from which
+ * key, so the key can stand in for the program across runs (see warmup.hpp).
+ ******************************************************************************/
+
+#include "gl_loader.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+
+namespace program_cache {
+    constexpr const char* dir {"cache/shaders"};
+
+    // hash of `parts` and the driver identity, needs a current GL context
+    auto key(std::initializer_list<std::string_view> parts) -> uint64_t;
+
+    // a linked program from the cache, 0 if it is not there or was rejected
+    auto load(uint64_t key) -> GLuint;
+
+    // call before linking a program that is going to be stored
+    auto prepare(GLuint program) -> void;
+
+    // saves a successfully linked program, returns false if it was not saved
+    auto store(uint64_t key, GLuint program) -> bool;
+
+    /* programs loaded or stored (linked) during this run, 0 if unknown, the
+     * entries of deleted programs are not removed */
+    auto program_of(uint64_t key) -> GLuint;
+    auto key_of(GLuint program) -> uint64_t;
+} // namespace program_cache
+
+#endif // SRC_PROGRAM_CACHE_HPP_
@@ -0,0 +1,348 @@
+/*******************************************************************************
+ * Offline texture cooker: PNG in, block compressed DDS with mipmaps out.
+ *
+ * usage: cook_textures [--bc1|--bc3|--bc5|--bc7] [--srgb] [--no-mipmaps]
+ *                      [--box] [--linear] [--alpha-coverage=<cutoff>]
+ *                      <input.png> <output.dds>
+ *
+ * Without a format option images with any transparency become BC3, opaque ones
+ * BC1. The mipmaps (see mipmaps.hpp) go down to 1x1, made with a Kaiser filter
+ * (--box for a box filter) in linear light; --linear filters the values as
+ * stored, for data that is not colour (BC5 always does). --alpha-coverage
+ * keeps the share of pixels with alpha above the cutoff (0 to 1) the same in
+ * every mipmap, for font atlases and alpha tested cutouts. Every mipmap is
+ * encoded by all cores (bands of block rows on a Thread_pool) with the
+ * encoders of bc.hpp. BC1, BC3 and BC5 are written with the legacy FourCC
+ * header every DDS reader knows, BC7 and the sRGB variants with the DX10
+ * header. The result is what dds::parse() (and so Texture_manager) loads.
+ *
+ * `make cook` cooks every PNG in data/textures next to it.
+ ******************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../Thread_pool.hpp"
+#include "../bc.hpp"
+#include "../dds_format.hpp"
+#include "../logs.hpp"
+#include "../mipmaps.hpp"
+#include "../png.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+    struct Options {
+        bool format_given;
+        bc::Format format;
+        bool srgb;
+        bool mipmaps;
+        mipmaps::Options filtering;
+        std::string input;
+        std::string output;
+    };
+
+    struct Level {
+        unsigned width;
+        unsigned height;
+        const unsigned char* rgba;
+    };
+
+    auto parse_options(int argc, char** argv, Options& options) -> bool
+    {
+        options = Options{
+            false, bc::Format::bc1, false, true, mipmaps::defaults, "", ""};
+        std::vector<std::string> files;
+        for (int i {1}; i < argc; ++i) {
+            const std::string arg {argv[i]};
+            if (arg == "--bc1" || arg == "--bc3" || arg == "--bc5"
+                || arg == "--bc7") {
+                options.format_given = true;
+                options.format = arg == "--bc1" ? bc::Format::bc1
+                    : arg == "--bc3" ? bc::Format::bc3
+                    : arg == "--bc5" ? bc::Format::bc5
+                    : bc::Format::bc7;
+            } else if (arg == "--srgb") {
+                options.srgb = true;
+            } else if (arg == "--no-mipmaps") {
+                options.mipmaps = false;
+            } else if (arg == "--box") {
+                options.filtering.filter = mipmaps::Filter::box;
+            } else if (arg == "--linear") {
+                options.filtering.srgb = false;
+            } else if (arg.compare(0, 17, "--alpha-coverage=") == 0) {
+                const char* value {arg.c_str() + 17};
+                char* end;
+                const float cutoff {std::strtof(value, &end)};
+                if (end == value || *end != '\0' || !(cutoff > 0.0f)
+                    || cutoff >= 1.0f) {
+                    logs::err("the alpha coverage cutoff has to be in (0, 1)");
+                    return false;
+                }
+                options.filtering.alpha_cutoff = cutoff;
+            } else if (arg.compare(0, 2, "--") == 0) {
+                logs::err("unknown option ", arg);
+                return false;
+            } else {
+                files.push_back(arg);
+            }
+        }
+        if (files.size() != 2) {
+            return false;
+        }
+        options.input = files[0];
+        options.output = files[1];
+        return true;
+    }
+
+    auto read_file(const std::string& path, std::string& contents) -> bool
+    {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        contents.assign(
+            std::istreambuf_iterator<char>(file),
+            std::istreambuf_iterator<char>());
+        return !file.bad();
+    }
+
+    auto has_alpha(const Level& image) -> bool
+    {
+        const size_t size {size_t{image.width} * image.height * 4};
+        for (size_t i {3}; i < size; i += 4) {
+            if (image.rgba[i] != 255) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // the 4x4 block at `bx`, `by`, edge pixels repeated past the border
+    auto gather(const Level& level, unsigned bx, unsigned by,
+                unsigned char block[64]) -> void
+    {
+        for (unsigned y {0}; y < 4; ++y) {
+            const unsigned py {std::min(by * 4 + y, level.height - 1)};
+            for (unsigned x {0}; x < 4; ++x) {
+                const unsigned px {std::min(bx * 4 + x, level.width - 1)};
+                std::memcpy(
+                    block + (y * 4 + x) * 4,
+                    level.rgba + (size_t{py} * level.width + px) * 4, 4);
+            }
+        }
+    }
+
+    // all block rows of `level`, in bands spread over the pool
+    auto encode(Thread_pool& pool, const Level& level, bc::Format format)
+        -> std::vector<unsigned char>
+    {
+        const unsigned blocks_x {(level.width + 3) / 4};
+        const unsigned blocks_y {(level.height + 3) / 4};
+        const unsigned block_bytes {bc::block_bytes(format)};
+        std::vector<unsigned char> out(
+            size_t{blocks_x} * blocks_y * block_bytes);
+
+        // a few bands per thread, so uneven ones even out
+        const unsigned bands {std::min(blocks_y, pool.size() * 4)};
+        std::vector<std::future<void>> jobs;
+        for (unsigned band {0}; band < bands; ++band) {
+            const unsigned first {blocks_y * band / bands};
+            const unsigned last {blocks_y * (band + 1) / bands};
+            jobs.push_back(pool.submit([&, first, last] {
+                unsigned char block[64];
+                for (unsigned by {first}; by < last; ++by) {
+                    for (unsigned bx {0}; bx < blocks_x; ++bx) {
+                        gather(level, bx, by, block);
+                        bc::encode(
+                            format, block,
+                            out.data()
+                                + (size_t{by} * blocks_x + bx) * block_bytes);
+                    }
+                }
+            }));
+        }
+        for (std::future<void>& job : jobs) {
+            job.get();
+        }
+        return out;
+    }
+
+    auto put32(std::string& file, size_t at, uint32_t value) -> void
+    {
+        std::memcpy(file.data() + at, &value, sizeof(value));
+    }
+
+    auto dds_header(const Options& options, const std::vector<Level>& levels,
+                    size_t top_size) -> std::string
+    {
+        using namespace dds;
+
+        // the legacy header where it can say everything
+        const bool dx10 {options.srgb || options.format == bc::Format::bc7};
+        std::string header(
+            magic_size + header_size + (dx10 ? dx10_header_size : 0), '\0');
+        std::memcpy(header.data(), file_magic, magic_size);
+
+        const bool mipmapped {levels.size() > 1};
+        put32(header, at_header_size, header_size);
+        put32(header, at_flags,
+            flags_caps | flags_height | flags_width | flags_pixel_format
+                | flags_linear_size | (mipmapped ? flags_mipmap_count : 0));
+        put32(header, at_height, levels[0].height);
+        put32(header, at_width, levels[0].width);
+        put32(header, at_pitch, static_cast<uint32_t>(top_size));
+        put32(header, at_mipmap_count, static_cast<uint32_t>(levels.size()));
+        put32(header, at_pf_size, pf_size);
+        put32(header, at_pf_flags, pf_fourcc);
+        put32(header, at_caps,
+            caps_texture | (mipmapped ? caps_complex | caps_mipmap : 0));
+
+        if (!dx10) {
+            put32(header, at_pf_fourcc,
+                options.format == bc::Format::bc1 ? fourcc("DXT1")
+                : options.format == bc::Format::bc3 ? fourcc("DXT5")
+                : fourcc("ATI2"));
+            return header;
+        }
+
+        Dxgi format {dxgi_bc7};
+        switch (options.format) {
+        case bc::Format::bc1:
+            format = options.srgb ? dxgi_bc1_srgb : dxgi_bc1;
+            break;
+        case bc::Format::bc3:
+            format = options.srgb ? dxgi_bc3_srgb : dxgi_bc3;
+            break;
+        case bc::Format::bc5:
+            format = dxgi_bc5;
+            break;
+        case bc::Format::bc7:
+            format = options.srgb ? dxgi_bc7_srgb : dxgi_bc7;
+            break;
+        }
+        put32(header, at_pf_fourcc, fourcc("DX10"));
+        put32(header, at_dxgi_format, format);
+        put32(header, at_dimension, dimension_texture2d);
+        put32(header, at_array_size, 1);
+        return header;
+    }
+
+    auto format_name(bc::Format format) -> const char*
+    {
+        switch (format) {
+        case bc::Format::bc1:
+            return "BC1";
+        case bc::Format::bc3:
+            return "BC3";
+        case bc::Format::bc5:
+            return "BC5";
+        case bc::Format::bc7:
+            return "BC7";
+        }
+        return "?";
+    }
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        logs::err(
+            "usage: ", argv[0], " [--bc1|--bc3|--bc5|--bc7] [--srgb]",
+            " [--no-mipmaps] [--box] [--linear] [--alpha-coverage=<cutoff>]",
+            " <input.png> <output.dds>");
+        return -1;
+    }
+    const auto start {std::chrono::steady_clock::now()};
+
+    std::string file;
+    png::Image image;
+    if (!read_file(options.input, file)) {
+        logs::err("can not read ", options.input);
+        return -1;
+    }
+    if (!png::decode(options.input, file, image)) {
+        return -1;
+    }
+
+    if (!options.format_given) {
+        const Level top {image.width, image.height, image.rgba.data()};
+        options.format = has_alpha(top) ? bc::Format::bc3 : bc::Format::bc1;
+    }
+    if (options.format == bc::Format::bc5) {
+        if (options.srgb) {
+            logs::info("BC5 holds two linear channels, ignoring --srgb");
+            options.srgb = false;
+        }
+        options.filtering.srgb = false;
+    }
+
+    std::vector<mipmaps::Level> chain {
+        mipmaps::Level{image.width, image.height, 0}};
+    if (options.mipmaps) {
+        chain = mipmaps::generate(
+            image.rgba, image.width, image.height, options.filtering);
+    }
+    std::vector<Level> levels;
+    for (const mipmaps::Level& level : chain) {
+        levels.push_back(Level{
+            level.width, level.height, image.rgba.data() + level.offset});
+    }
+
+    // the caller is waiting, every hardware thread encodes
+    Thread_pool pool {std::max(std::thread::hardware_concurrency(), 1u)};
+    std::vector<std::vector<unsigned char>> encoded;
+    for (const Level& level : levels) {
+        encoded.push_back(encode(pool, level, options.format));
+    }
+
+    // written under a temporary name, the running program may be reading it
+    const std::string tmp_path {options.output + ".tmp"};
+    std::ofstream out(tmp_path, std::ios::out | std::ios::binary);
+    if (!out.is_open()) {
+        logs::err("can not open ", tmp_path, " for writing");
+        return -1;
+    }
+    const std::string header {
+        dds_header(options, levels, encoded.front().size())};
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    size_t bytes {header.size()};
+    for (const std::vector<unsigned char>& level : encoded) {
+        out.write(
+            reinterpret_cast<const char*>(level.data()),
+            static_cast<std::streamsize>(level.size()));
+        bytes += level.size();
+    }
+    out.close();
+    if (!out) {
+        logs::err("could not write ", tmp_path);
+        return -1;
+    }
+
+    std::error_code ec;
+    fs::rename(tmp_path, options.output, ec);
+    if (ec) {
+        logs::err("could not move ", tmp_path, ": ", ec.message());
+        return -1;
+    }
+    logs::info(
+        "cooked ", options.output, ": ", format_name(options.format),
+        options.srgb ? " sRGB " : " ", levels[0].width, "x", levels[0].height,
+        ", ", levels.size(), " mipmaps, ", bytes / 1024, "KiB in ",
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count(),
+        "ms on ", pool.size(), " threads");
+    return 0;
+}
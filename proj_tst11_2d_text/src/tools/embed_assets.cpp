@@ -0,0 +1,125 @@
+/*******************************************************************************
+ * Build step that compiles files into the executable (see assets.hpp).
+ *
+ * usage: embed_assets <output.cpp> <file>...
+ *
+ * Writes a source file with one constant byte array per file and the table
+ * assets::get() searches, sorted by path. The paths are stored the way they are
+ * given, so call it from the directory the program runs in.
+ ******************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+    constexpr unsigned bytes_per_line {16};
+
+    struct File {
+        std::string path;
+        std::vector<unsigned char> data;
+    };
+
+    auto string_literal(const std::string& text) -> std::string
+    {
+        std::string out {"\""};
+        for (const char c : text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+            }
+            out += c;
+        }
+        return out + "\"";
+    }
+
+    auto write_array(std::ostream& out, size_t index, const File& file) -> void
+    {
+        // aligned so uploads can read straight from it
+        out << "    // " << file.path << "\n"
+            << "    alignas(16) constexpr unsigned char file_" << index
+            << "[] {";
+        char hex[8];
+        for (size_t i {0}; i < file.data.size(); ++i) {
+            if (i % bytes_per_line == 0) {
+                out << "\n        ";
+            }
+            snprintf(hex, sizeof(hex), "0x%02x,", file.data[i]);
+            out << hex;
+        }
+        // a zero-sized array is not allowed
+        out << (file.data.empty() ? "\n        0" : "") << "\n    };\n\n";
+    }
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <output.cpp> <file>...\n";
+        return -1;
+    }
+
+    std::vector<File> files;
+    for (int i {2}; i < argc; ++i) {
+        File file;
+        file.path = std::filesystem::path(argv[i])
+            .lexically_normal().generic_string();
+        std::ifstream in(argv[i], std::ios::in | std::ios::binary);
+        if (!in.is_open()) {
+            std::cerr << argv[0] << ": can not open " << argv[i] << "\n";
+            return -1;
+        }
+        file.data.assign(
+            std::istreambuf_iterator<char>(in),
+            std::istreambuf_iterator<char>());
+        files.push_back(std::move(file));
+    }
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) {
+        return a.path < b.path;
+    });
+
+    // written under a temporary name, make must never see half a file
+    const std::string tmp_path {std::string(argv[1]) + ".tmp"};
+    std::ofstream out(tmp_path, std::ios::out);
+    if (!out.is_open()) {
+        std::cerr << argv[0] << ": can not open " << tmp_path << "\n";
+        return -1;
+    }
+
+    out << "// generated by tools/embed_assets.cpp, do not edit\n\n"
+        << "#include \"assets.hpp\"\n\n"
+        << "namespace {\n";
+    for (size_t i {0}; i < files.size(); ++i) {
+        write_array(out, i, files[i]);
+    }
+    out << "} // namespace\n\n"
+        << "namespace assets {\n"
+        << "    const Embedded embedded[] {\n";
+    for (size_t i {0}; i < files.size(); ++i) {
+        out << "        {" << string_literal(files[i].path) << ", file_" << i
+            << ", " << files[i].data.size() << "},\n";
+    }
+    out << "        {nullptr, nullptr, 0} // so the array is never empty\n"
+        << "    };\n"
+        << "    const size_t embedded_count {" << files.size() << "};\n"
+        << "} // namespace assets\n";
+    out.close();
+    if (!out) {
+        std::cerr << argv[0] << ": could not write " << tmp_path << "\n";
+        return -1;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, argv[1], ec);
+    if (ec) {
+        std::cerr << argv[0] << ": could not move " << tmp_path << ": "
+            << ec.message() << "\n";
+        return -1;
+    }
+    return 0;
+}
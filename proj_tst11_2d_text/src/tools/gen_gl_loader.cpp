@@ -0,0 +1,270 @@
+/*******************************************************************************
+ * Build step that generates the GL entry points the sources use (see
+ * gl_loader.hpp).
+ *
+ * usage: gen_gl_loader <output.cpp> <glcorearb.h> <core version> <source>...
+ *
+ * Collects every gl* identifier in the sources, looks its prototype up in
+ * glcorearb.h and writes the function pointers into <output.cpp> and the
+ * matching declarations into the .hpp next to it. Functions of GL versions up
+ * to <core version> ("3.3") are resolved by gl_loader::init(), the others start
+ * out pointing at a stub resolving them on the first call. Identifiers that
+ * are no GL function (glm, glfw*, names in comments) are ignored. The header is
+ * only rewritten when it changes, so editing a source does not rebuild
+ * everything.
+ ******************************************************************************/
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Function {
+        std::string return_type;
+        std::string params;             // as declared, "GLenum mode"
+        std::vector<std::string> args; // parameter names
+        bool core;
+    };
+
+    auto read_file(const std::string& path, std::string& text) -> bool
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            return false;
+        }
+        text.assign(std::istreambuf_iterator<char>(in), {});
+        return true;
+    }
+
+    auto trim(const std::string& s) -> std::string
+    {
+        const auto first {s.find_first_not_of(" \t")};
+        if (first == std::string::npos) {
+            return "";
+        }
+        return s.substr(first, s.find_last_not_of(" \t") - first + 1);
+    }
+
+    // the name is the last identifier of each parameter
+    auto arg_names(const std::string& params) -> std::vector<std::string>
+    {
+        std::vector<std::string> names;
+        if (trim(params) == "void") {
+            return names;
+        }
+        static const std::regex last_ident {R"(([A-Za-z_]\w*)\s*$)"};
+        std::stringstream list(params);
+        std::string param;
+        while (std::getline(list, param, ',')) {
+            std::smatch m;
+            if (std::regex_search(param, m, last_ident)) {
+                names.push_back(m[1]);
+            }
+        }
+        return names;
+    }
+
+    auto parse_header(
+        const std::string& text,
+        int core_major,
+        int core_minor,
+        std::map<std::string, Function>& functions) -> void
+    {
+        static const std::regex block {R"(^#ifndef (GL_\w+)\s*$)"};
+        static const std::regex gl_version {R"(GL_VERSION_(\d+)_(\d+))"};
+        static const std::regex prototype {
+            R"(^GLAPI\s+(.+?)\s*APIENTRY\s+(gl\w+)\s*\((.*)\);\s*$)"};
+
+        bool core {false};
+        std::stringstream lines(text);
+        std::string line;
+        while (std::getline(lines, line)) {
+            std::smatch m;
+            if (std::regex_match(line, m, block)) {
+                std::smatch v;
+                const std::string name {m[1]};
+                core = false;
+                if (std::regex_match(name, v, gl_version)) {
+                    const int major {std::stoi(v[1])};
+                    const int minor {std::stoi(v[2])};
+                    core = major < core_major
+                        || (major == core_major && minor <= core_minor);
+                }
+            } else if (std::regex_match(line, m, prototype)) {
+                functions[m[2]] = Function{
+                    .return_type = m[1],
+                    .params = m[3],
+                    .args = arg_names(m[3]),
+                    .core = core,
+                };
+            }
+        }
+    }
+
+    auto pfn_type(const std::string& name) -> std::string
+    {
+        std::string type {"PFN"};
+        for (const char c : name) {
+            type += static_cast<char>(
+                std::toupper(static_cast<unsigned char>(c)));
+        }
+        return type + "PROC";
+    }
+
+    auto write_if_changed(const std::string& path, const std::string& text)
+        -> bool
+    {
+        std::string old;
+        {
+            std::ifstream in(path, std::ios::binary);
+            old.assign(std::istreambuf_iterator<char>(in), {});
+        }
+        if (old == text) {
+            return true;
+        }
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << text;
+        return static_cast<bool>(out);
+    }
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    if (argc < 4) {
+        std::cerr << "usage: " << argv[0]
+            << " <output.cpp> <glcorearb.h> <core version> <source>...\n";
+        return 1;
+    }
+    const std::string out_cpp {argv[1]};
+    const std::string out_hpp {
+        out_cpp.substr(0, out_cpp.rfind('.')) + ".hpp"};
+
+    int core_major {0};
+    int core_minor {0};
+    if (std::sscanf(argv[3], "%d.%d", &core_major, &core_minor) != 2) {
+        std::cerr << argv[0] << ": bad core version " << argv[3] << "\n";
+        return 1;
+    }
+
+    std::string text;
+    if (!read_file(argv[2], text)) {
+        std::cerr << argv[0] << ": can not open " << argv[2] << "\n";
+        return 1;
+    }
+    std::map<std::string, Function> known;
+    parse_header(text, core_major, core_minor, known);
+    if (known.empty()) {
+        std::cerr << argv[0] << ": no prototypes in " << argv[2] << "\n";
+        return 1;
+    }
+
+    // sorted, so the output only changes when the set does
+    std::set<std::string> used;
+    static const std::regex identifier {R"(\bgl[A-Z]\w*)"};
+    for (int i {4}; i < argc; ++i) {
+        if (!read_file(argv[i], text)) {
+            std::cerr << argv[0] << ": can not open " << argv[i] << "\n";
+            return 1;
+        }
+        for (std::sregex_iterator it(text.begin(), text.end(), identifier), end;
+             it != end; ++it) {
+            if (known.count(it->str()) != 0) {
+                used.insert(it->str());
+            }
+        }
+    }
+
+    std::ostringstream hpp;
+    hpp << "// generated by tools/gen_gl_loader.cpp, do not edit\n"
+        << "#ifndef GEN_GL_FUNCTIONS_HPP_\n"
+        << "#define GEN_GL_FUNCTIONS_HPP_\n\n"
+        << "namespace gl_loader::fn {\n";
+    for (const std::string& name : used) {
+        hpp << "    extern " << pfn_type(name) << ' ' << name << ";\n";
+    }
+    hpp << "} // namespace gl_loader::fn\n\n";
+    for (const std::string& name : used) {
+        hpp << "using gl_loader::fn::" << name << ";\n";
+    }
+    hpp << "\n#endif // GEN_GL_FUNCTIONS_HPP_\n";
+
+    unsigned core_count {0};
+    std::ostringstream stubs;
+    std::ostringstream pointers;
+    std::ostringstream load;
+    for (const std::string& name : used) {
+        const Function& f {known[name]};
+        const std::string type {pfn_type(name)};
+        if (f.core) {
+            ++core_count;
+            pointers << "    " << type << ' ' << name << " {nullptr};\n";
+            load << "    ok = load(fn::" << name << ", \"" << name
+                << "\") && ok;\n";
+            continue;
+        }
+        pointers << "    " << type << ' ' << name << " {lazy_" << name
+            << "};\n";
+        stubs << "    " << f.return_type << " APIENTRY lazy_" << name << '('
+            << f.params << ")\n"
+            << "    {\n"
+            << "        gl_loader::fn::" << name << " = reinterpret_cast<"
+            << type << ">(\n"
+            << "            gl_loader::resolve_lazily(\"" << name << "\"));\n"
+            << "        return gl_loader::fn::" << name << '(';
+        for (size_t i {0}; i < f.args.size(); ++i) {
+            stubs << (i > 0 ? ", " : "") << f.args[i];
+        }
+        stubs << ");\n"
+            << "    }\n\n";
+    }
+
+    std::ostringstream cpp;
+    cpp << "// generated by tools/gen_gl_loader.cpp, do not edit\n"
+        << "#include \"gl_loader.hpp\"\n\n"
+        << "#include \"logs.hpp\"\n\n"
+        << "namespace {\n"
+        << stubs.str()
+        << "    template<typename F>\n"
+        << "    auto load(F& fn, const char* name) -> bool\n"
+        << "    {\n"
+        << "        fn = reinterpret_cast<F>(gl_loader::resolve(name));\n"
+        << "        if (fn == nullptr) {\n"
+        << "            logs::err(\"missing GL entry point \", name);\n"
+        << "        }\n"
+        << "        return fn != nullptr;\n"
+        << "    }\n"
+        << "} // namespace\n\n"
+        << "namespace gl_loader::fn {\n"
+        << pointers.str()
+        << "} // namespace gl_loader::fn\n\n"
+        << "const unsigned gl_loader::core_count {" << core_count << "};\n"
+        << "const unsigned gl_loader::optional_count {"
+        << used.size() - core_count << "};\n\n"
+        << "auto gl_loader::load_core() -> bool\n"
+        << "{\n"
+        << "    bool ok {true};\n"
+        << load.str()
+        << "    return ok;\n"
+        << "}\n";
+
+    // the .cpp is always written, it is the target make checks
+    if (!write_if_changed(out_hpp, hpp.str())) {
+        std::cerr << argv[0] << ": could not write " << out_hpp << "\n";
+        return 1;
+    }
+    std::ofstream out(out_cpp, std::ios::binary | std::ios::trunc);
+    out << cpp.str();
+    if (!out) {
+        std::cerr << argv[0] << ": could not write " << out_cpp << "\n";
+        return 1;
+    }
+    return 0;
+}
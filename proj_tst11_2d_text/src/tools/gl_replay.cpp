@@ -0,0 +1,703 @@
+/*******************************************************************************
+ * Replays a GL call-stream capture (see gl_capture.hpp) as fast as the driver
+ * allows: the setup stream once, then the captured frame in a loop.
+ *
+ * usage: gl_replay <capture file> [frames]
+ *
+ * The reported times only contain the cost of issuing the captured calls and
+ * swapping, so runs against different drivers (e.g. Mesa versions) can be
+ * compared directly.
+ ******************************************************************************/
+
+#include "../gl_loader.hpp"
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../gl_capture_format.hpp"
+#include "../logs.hpp"
+
+using gl_capture::Op;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    // bounds checked cursor over a command stream
+    class Reader final {
+     public:
+        Reader(const uint8_t* data, size_t size)
+        : pos{data}
+        , end{data + size}
+        , failed{false}
+        {}
+
+        template<typename T>
+        auto get() -> T
+        {
+            T value {};
+            const void* src {this->bytes(sizeof(value))};
+            if (src != nullptr) {
+                memcpy(&value, src, sizeof(value));
+            }
+            return value;
+        }
+
+        // returns nullptr if there are not enough bytes left
+        auto bytes(size_t size) -> const uint8_t*
+        {
+            if (static_cast<size_t>(this->end - this->pos) < size) {
+                this->failed = true;
+                return nullptr;
+            }
+            const uint8_t* p {this->pos};
+            this->pos += size;
+            return p;
+        }
+
+        auto at_end() const -> bool { return this->pos == this->end; }
+        auto ok() const -> bool { return !this->failed; }
+
+     private:
+        const uint8_t* pos;
+        const uint8_t* end;
+        bool failed;
+    };
+
+    class Replayer final {
+     public:
+        // execute commands until the end of a frame or of the stream,
+        // returns false on a malformed stream
+        auto run_frame(Reader& in) -> bool;
+
+     private:
+        auto map(std::unordered_map<GLuint, GLuint>& names, GLuint name)
+            -> GLuint;
+        auto gen(
+            Reader& in,
+            std::unordered_map<GLuint, GLuint>& names,
+            void (*gen_fn)(GLsizei, GLuint*)) -> void;
+        auto del(
+            Reader& in,
+            std::unordered_map<GLuint, GLuint>& names,
+            void (*del_fn)(GLsizei, const GLuint*)) -> void;
+        auto location(GLint captured) -> GLint;
+
+        std::unordered_map<GLuint, GLuint> vertex_arrays;
+        std::unordered_map<GLuint, GLuint> buffers;
+        std::unordered_map<GLuint, GLuint> textures;
+        std::unordered_map<GLuint, GLuint> programs; // shaders and programs
+        // (captured program << 32 | captured location) -> location
+        std::unordered_map<uint64_t, GLint> locations;
+        GLuint cur_program {0}; // captured name of the program in use
+    };
+
+    // wrappers so the gl_loader function pointers can be passed around
+    auto gen_vertex_arrays(GLsizei n, GLuint* names) -> void
+    {
+        glGenVertexArrays(n, names);
+    }
+
+    auto gen_buffers(GLsizei n, GLuint* names) -> void
+    {
+        glGenBuffers(n, names);
+    }
+
+    auto delete_buffers(GLsizei n, const GLuint* names) -> void
+    {
+        glDeleteBuffers(n, names);
+    }
+
+    auto gen_textures(GLsizei n, GLuint* names) -> void
+    {
+        glGenTextures(n, names);
+    }
+
+    auto delete_textures(GLsizei n, const GLuint* names) -> void
+    {
+        glDeleteTextures(n, names);
+    }
+
+    auto init(const gl_capture::File_header& header) -> GLFWwindow*;
+    auto percentile(std::vector<double>& samples, double p) -> double;
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    if (argc < 2) {
+        logs::err("usage: ", argv[0], " <capture file> [frames]");
+        return -1;
+    }
+    const unsigned frames {
+        argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10))
+                 : 1000u};
+
+    std::ifstream file(argv[1], std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        logs::err("can not open ", argv[1]);
+        return -1;
+    }
+    std::vector<uint8_t> data(
+        (std::istreambuf_iterator<char>(file)),
+        std::istreambuf_iterator<char>());
+
+    gl_capture::File_header header {};
+    if (data.size() < sizeof(header)) {
+        logs::err(argv[1], " is not a GL capture");
+        return -1;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if (memcmp(header.magic, gl_capture::file_magic, sizeof(header.magic)) != 0
+        || header.version != gl_capture::file_version
+        || data.size() - sizeof(header) != header.setup_size + header.frame_size)
+    {
+        logs::err(argv[1], " is not a GL capture (or has an unknown version)");
+        return -1;
+    }
+
+    GLFWwindow* window {init(header)};
+    if (window == nullptr) {
+        glfwTerminate();
+        return -1;
+    }
+
+    logs::info(
+        "replaying frame ", header.frame_number, " of ", argv[1],
+        " on ", glGetString(GL_RENDERER), " / ", glGetString(GL_VERSION));
+
+    const uint8_t* setup {data.data() + sizeof(header)};
+    const uint8_t* frame {setup + header.setup_size};
+
+    Replayer replayer;
+    Reader setup_in(setup, header.setup_size);
+    while (!setup_in.at_end()) {
+        if (!replayer.run_frame(setup_in)) {
+            logs::err("malformed setup stream");
+            glfwTerminate();
+            return -1;
+        }
+        glfwSwapBuffers(window);
+    }
+    glFinish();
+
+    // submit: time spent issuing the captured calls, frame: submit + swap
+    std::vector<double> submit_ms;
+    std::vector<double> frame_ms;
+    submit_ms.reserve(frames);
+    frame_ms.reserve(frames);
+    for (unsigned i {0}; i < frames && !glfwWindowShouldClose(window); ++i) {
+        const auto begin {Clock::now()};
+        Reader frame_in(frame, header.frame_size);
+        if (!replayer.run_frame(frame_in)) {
+            logs::err("malformed frame stream");
+            break;
+        }
+        const auto submitted {Clock::now()};
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+        const auto end {Clock::now()};
+
+        using Ms = std::chrono::duration<double, std::milli>;
+        submit_ms.push_back(Ms(submitted - begin).count());
+        frame_ms.push_back(Ms(end - begin).count());
+    }
+    glFinish();
+
+    if (!frame_ms.empty()) {
+        logs::info("replayed ", frame_ms.size(), " frames");
+        logs::info(
+            "submit ms: p50 ", percentile(submit_ms, 0.5),
+            " p90 ", percentile(submit_ms, 0.9),
+            " p99 ", percentile(submit_ms, 0.99));
+        logs::info(
+            "frame ms:  p50 ", percentile(frame_ms, 0.5),
+            " p90 ", percentile(frame_ms, 0.9),
+            " p99 ", percentile(frame_ms, 0.99));
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
+
+auto Replayer::run_frame(Reader& in) -> bool
+{
+    while (!in.at_end()) {
+        const auto op {in.get<Op>()};
+        switch (op) {
+        case Op::end_frame:
+            return in.ok();
+
+        // objects
+        case Op::gen_vertex_arrays:
+            this->gen(in, this->vertex_arrays, gen_vertex_arrays);
+            break;
+        case Op::bind_vertex_array:
+            glBindVertexArray(this->map(this->vertex_arrays, in.get<GLuint>()));
+            break;
+        case Op::gen_buffers:
+            this->gen(in, this->buffers, gen_buffers);
+            break;
+        case Op::bind_buffer: {
+            const auto target {in.get<GLenum>()};
+            glBindBuffer(target, this->map(this->buffers, in.get<GLuint>()));
+            break;
+        }
+        case Op::buffer_data: {
+            const auto target {in.get<GLenum>()};
+            const auto usage {in.get<GLenum>()};
+            const auto has_data {in.get<uint8_t>()};
+            const auto size {in.get<uint64_t>()};
+            const uint8_t* src {has_data ? in.bytes(size) : nullptr};
+            if (!in.ok()) {
+                return false;
+            }
+            glBufferData(target, static_cast<GLsizeiptr>(size), src, usage);
+            break;
+        }
+        case Op::delete_buffers:
+            this->del(in, this->buffers, delete_buffers);
+            break;
+        case Op::gen_textures:
+            this->gen(in, this->textures, gen_textures);
+            break;
+        case Op::bind_texture: {
+            const auto target {in.get<GLenum>()};
+            glBindTexture(target, this->map(this->textures, in.get<GLuint>()));
+            break;
+        }
+        case Op::delete_textures:
+            this->del(in, this->textures, delete_textures);
+            break;
+        case Op::active_texture:
+            glActiveTexture(in.get<GLenum>());
+            break;
+        case Op::tex_image_2d: {
+            const auto target {in.get<GLenum>()};
+            const auto level {in.get<GLint>()};
+            const auto internal_format {in.get<GLint>()};
+            const auto width {in.get<GLsizei>()};
+            const auto height {in.get<GLsizei>()};
+            const auto border {in.get<GLint>()};
+            const auto format {in.get<GLenum>()};
+            const auto type {in.get<GLenum>()};
+            const auto has_data {in.get<uint8_t>()};
+            const auto size {in.get<uint64_t>()};
+            const uint8_t* src {has_data ? in.bytes(size) : nullptr};
+            if (!in.ok()) {
+                return false;
+            }
+            glTexImage2D(
+                target, level, internal_format,
+                width, height, border, format, type, src);
+            break;
+        }
+        case Op::compressed_tex_image_2d: {
+            const auto target {in.get<GLenum>()};
+            const auto level {in.get<GLint>()};
+            const auto internal_format {in.get<GLenum>()};
+            const auto width {in.get<GLsizei>()};
+            const auto height {in.get<GLsizei>()};
+            const auto border {in.get<GLint>()};
+            const auto has_data {in.get<uint8_t>()};
+            const auto size {in.get<uint64_t>()};
+            const uint8_t* src {has_data ? in.bytes(size) : nullptr};
+            if (!in.ok()) {
+                return false;
+            }
+            glCompressedTexImage2D(
+                target, level, internal_format, width, height, border,
+                static_cast<GLsizei>(size), src);
+            break;
+        }
+        case Op::tex_image_3d: {
+            const auto target {in.get<GLenum>()};
+            const auto level {in.get<GLint>()};
+            const auto internal_format {in.get<GLint>()};
+            const auto width {in.get<GLsizei>()};
+            const auto height {in.get<GLsizei>()};
+            const auto depth {in.get<GLsizei>()};
+            const auto border {in.get<GLint>()};
+            const auto format {in.get<GLenum>()};
+            const auto type {in.get<GLenum>()};
+            const auto has_data {in.get<uint8_t>()};
+            const auto size {in.get<uint64_t>()};
+            const uint8_t* src {has_data ? in.bytes(size) : nullptr};
+            if (!in.ok()) {
+                return false;
+            }
+            glTexImage3D(
+                target, level, internal_format,
+                width, height, depth, border, format, type, src);
+            break;
+        }
+        case Op::compressed_tex_image_3d: {
+            const auto target {in.get<GLenum>()};
+            const auto level {in.get<GLint>()};
+            const auto internal_format {in.get<GLenum>()};
+            const auto width {in.get<GLsizei>()};
+            const auto height {in.get<GLsizei>()};
+            const auto depth {in.get<GLsizei>()};
+            const auto border {in.get<GLint>()};
+            const auto has_data {in.get<uint8_t>()};
+            const auto size {in.get<uint64_t>()};
+            const uint8_t* src {has_data ? in.bytes(size) : nullptr};
+            if (!in.ok()) {
+                return false;
+            }
+            glCompressedTexImage3D(
+                target, level, internal_format, width, height, depth, border,
+                static_cast<GLsizei>(size), src);
+            break;
+        }
+        case Op::tex_sub_image_3d: {
+            const auto target {in.get<GLenum>()};
+            const auto level {in.get<GLint>()};
+            const auto x {in.get<GLint>()};
+            const auto y {in.get<GLint>()};
+            const auto z {in.get<GLint>()};
+            const auto width {in.get<GLsizei>()};
+            const auto height {in.get<GLsizei>()};
+            const auto depth {in.get<GLsizei>()};
+            const auto format {in.get<GLenum>()};
+            const auto type {in.get<GLenum>()};
+            const auto has_data {in.get<uint8_t>()};
+            const auto size {in.get<uint64_t>()};
+            const uint8_t* src {has_data ? in.bytes(size) : nullptr};
+            if (!in.ok()) {
+                return false;
+            }
+            // from a pixel buffer, the contents are not in the capture
+            if (src != nullptr) {
+                glTexSubImage3D(
+                    target, level, x, y, z, width, height, depth, format,
+                    type, src);
+            }
+            break;
+        }
+        case Op::compressed_tex_sub_image_3d: {
+            const auto target {in.get<GLenum>()};
+            const auto level {in.get<GLint>()};
+            const auto x {in.get<GLint>()};
+            const auto y {in.get<GLint>()};
+            const auto z {in.get<GLint>()};
+            const auto width {in.get<GLsizei>()};
+            const auto height {in.get<GLsizei>()};
+            const auto depth {in.get<GLsizei>()};
+            const auto format {in.get<GLenum>()};
+            const auto has_data {in.get<uint8_t>()};
+            const auto size {in.get<uint64_t>()};
+            const uint8_t* src {has_data ? in.bytes(size) : nullptr};
+            if (!in.ok()) {
+                return false;
+            }
+            if (src != nullptr) {
+                glCompressedTexSubImage3D(
+                    target, level, x, y, z, width, height, depth, format,
+                    static_cast<GLsizei>(size), src);
+            }
+            break;
+        }
+        case Op::tex_parameter_i: {
+            const auto target {in.get<GLenum>()};
+            const auto pname {in.get<GLenum>()};
+            glTexParameteri(target, pname, in.get<GLint>());
+            break;
+        }
+        case Op::generate_mipmap:
+            glGenerateMipmap(in.get<GLenum>());
+            break;
+        case Op::pixel_store_i: {
+            const auto pname {in.get<GLenum>()};
+            glPixelStorei(pname, in.get<GLint>());
+            break;
+        }
+
+        // shaders
+        case Op::create_shader: {
+            const auto type {in.get<GLenum>()};
+            this->programs[in.get<GLuint>()] = glCreateShader(type);
+            break;
+        }
+        case Op::shader_source: {
+            const GLuint shader {this->map(this->programs, in.get<GLuint>())};
+            const auto count {in.get<int32_t>()};
+            std::vector<const GLchar*> strings;
+            std::vector<GLint> lengths;
+            for (int32_t i {0}; i < count && in.ok(); ++i) {
+                const auto size {in.get<uint64_t>()};
+                strings.push_back(reinterpret_cast<const GLchar*>(in.bytes(size)));
+                lengths.push_back(static_cast<GLint>(size));
+            }
+            if (!in.ok()) {
+                return false;
+            }
+            glShaderSource(shader, count, strings.data(), lengths.data());
+            break;
+        }
+        case Op::compile_shader:
+            glCompileShader(this->map(this->programs, in.get<GLuint>()));
+            break;
+        case Op::delete_shader:
+            glDeleteShader(this->map(this->programs, in.get<GLuint>()));
+            break;
+        case Op::create_program:
+            this->programs[in.get<GLuint>()] = glCreateProgram();
+            break;
+        case Op::attach_shader: {
+            const GLuint program {this->map(this->programs, in.get<GLuint>())};
+            glAttachShader(program, this->map(this->programs, in.get<GLuint>()));
+            break;
+        }
+        case Op::detach_shader: {
+            const GLuint program {this->map(this->programs, in.get<GLuint>())};
+            glDetachShader(program, this->map(this->programs, in.get<GLuint>()));
+            break;
+        }
+        case Op::link_program:
+            glLinkProgram(this->map(this->programs, in.get<GLuint>()));
+            break;
+        case Op::use_program:
+            this->cur_program = in.get<GLuint>();
+            glUseProgram(this->map(this->programs, this->cur_program));
+            break;
+        case Op::delete_program:
+            glDeleteProgram(this->map(this->programs, in.get<GLuint>()));
+            break;
+        case Op::get_uniform_location: {
+            const auto program {in.get<GLuint>()};
+            const auto size {in.get<uint64_t>()};
+            const uint8_t* name {in.bytes(size)};
+            const auto captured {in.get<GLint>()};
+            if (!in.ok()) {
+                return false;
+            }
+            const std::string name_str(reinterpret_cast<const char*>(name), size);
+            const uint64_t key {
+                static_cast<uint64_t>(program) << 32u
+                | static_cast<uint32_t>(captured)};
+            this->locations[key] = glGetUniformLocation(
+                this->map(this->programs, program), name_str.c_str());
+            break;
+        }
+
+        // fixed function state
+        case Op::clear_color: {
+            const auto r {in.get<GLfloat>()};
+            const auto g {in.get<GLfloat>()};
+            const auto b {in.get<GLfloat>()};
+            glClearColor(r, g, b, in.get<GLfloat>());
+            break;
+        }
+        case Op::clear:
+            glClear(in.get<GLbitfield>());
+            break;
+        case Op::enable:
+            glEnable(in.get<GLenum>());
+            break;
+        case Op::disable:
+            glDisable(in.get<GLenum>());
+            break;
+        case Op::depth_func:
+            glDepthFunc(in.get<GLenum>());
+            break;
+        case Op::blend_func: {
+            const auto sfactor {in.get<GLenum>()};
+            glBlendFunc(sfactor, in.get<GLenum>());
+            break;
+        }
+        case Op::enable_vertex_attrib_array:
+            glEnableVertexAttribArray(in.get<GLuint>());
+            break;
+        case Op::disable_vertex_attrib_array:
+            glDisableVertexAttribArray(in.get<GLuint>());
+            break;
+        case Op::vertex_attrib_pointer: {
+            const auto index {in.get<GLuint>()};
+            const auto size {in.get<GLint>()};
+            const auto type {in.get<GLenum>()};
+            const auto normalized {in.get<uint8_t>()};
+            const auto stride {in.get<GLsizei>()};
+            const auto offset {in.get<uint64_t>()};
+            glVertexAttribPointer(
+                index, size, type, normalized, stride,
+                reinterpret_cast<const void*>(static_cast<uintptr_t>(offset)));
+            break;
+        }
+
+        // uniforms
+        case Op::uniform_1i: {
+            const GLint location {this->location(in.get<GLint>())};
+            glUniform1i(location, in.get<GLint>());
+            break;
+        }
+        case Op::uniform_1f: {
+            const GLint location {this->location(in.get<GLint>())};
+            glUniform1f(location, in.get<GLfloat>());
+            break;
+        }
+        case Op::uniform_2fv:
+        case Op::uniform_3fv:
+        case Op::uniform_4fv: {
+            const GLint location {this->location(in.get<GLint>())};
+            const auto count {in.get<int32_t>()};
+            const size_t size {
+                op == Op::uniform_2fv ? 2u : op == Op::uniform_3fv ? 3u : 4u};
+            const uint8_t* values {
+                in.bytes(sizeof(GLfloat) * size * static_cast<size_t>(count))};
+            if (!in.ok()) {
+                return false;
+            }
+            std::vector<GLfloat> vectors(size * static_cast<size_t>(count));
+            memcpy(vectors.data(), values, sizeof(GLfloat) * vectors.size());
+            if (op == Op::uniform_2fv) {
+                glUniform2fv(location, count, vectors.data());
+            } else if (op == Op::uniform_3fv) {
+                glUniform3fv(location, count, vectors.data());
+            } else {
+                glUniform4fv(location, count, vectors.data());
+            }
+            break;
+        }
+        case Op::uniform_matrix_4fv: {
+            const GLint location {this->location(in.get<GLint>())};
+            const auto count {in.get<int32_t>()};
+            const auto transpose {in.get<uint8_t>()};
+            const uint8_t* values {
+                in.bytes(sizeof(GLfloat) * 16 * static_cast<size_t>(count))};
+            if (!in.ok()) {
+                return false;
+            }
+            // the capture is not necessarily float aligned
+            std::vector<GLfloat> matrices(16 * static_cast<size_t>(count));
+            memcpy(matrices.data(), values, sizeof(GLfloat) * matrices.size());
+            glUniformMatrix4fv(location, count, transpose, matrices.data());
+            break;
+        }
+
+        // draws
+        case Op::draw_arrays: {
+            const auto mode {in.get<GLenum>()};
+            const auto first {in.get<GLint>()};
+            glDrawArrays(mode, first, in.get<GLsizei>());
+            break;
+        }
+
+        default:
+            logs::err("unknown op ", static_cast<unsigned>(op));
+            return false;
+        }
+
+        if (!in.ok()) {
+            return false;
+        }
+    }
+
+    return in.ok();
+}
+
+auto Replayer::map(std::unordered_map<GLuint, GLuint>& names, GLuint name)
+    -> GLuint
+{
+    if (name == 0) {
+        return 0;
+    }
+    auto it {names.find(name)};
+    if (it == names.end()) {
+        logs::err("capture references unknown object ", name);
+        return 0;
+    }
+    return it->second;
+}
+
+auto Replayer::gen(
+    Reader& in,
+    std::unordered_map<GLuint, GLuint>& names,
+    void (*gen_fn)(GLsizei, GLuint*)) -> void
+{
+    const auto n {in.get<int32_t>()};
+    if (n <= 0) {
+        return;
+    }
+    std::vector<GLuint> replay_names(static_cast<size_t>(n));
+    gen_fn(n, replay_names.data());
+    for (GLuint replay_name : replay_names) {
+        names[in.get<GLuint>()] = replay_name;
+    }
+}
+
+auto Replayer::del(
+    Reader& in,
+    std::unordered_map<GLuint, GLuint>& names,
+    void (*del_fn)(GLsizei, const GLuint*)) -> void
+{
+    const auto n {in.get<int32_t>()};
+    std::vector<GLuint> replay_names;
+    for (int32_t i {0}; i < n && in.ok(); ++i) {
+        const auto name {in.get<GLuint>()};
+        replay_names.push_back(this->map(names, name));
+        names.erase(name);
+    }
+    del_fn(static_cast<GLsizei>(replay_names.size()), replay_names.data());
+}
+
+auto Replayer::location(GLint captured) -> GLint
+{
+    if (captured < 0) {
+        return captured;
+    }
+    const uint64_t key {
+        static_cast<uint64_t>(this->cur_program) << 32u
+        | static_cast<uint32_t>(captured)};
+    auto it {this->locations.find(key)};
+    return it == this->locations.end() ? -1 : it->second;
+}
+
+namespace {
+    auto init(const gl_capture::File_header& header) -> GLFWwindow*
+    {
+        if (!glfwInit()) {
+            logs::err("ERROR: glfw init failed!");
+            return nullptr;
+        }
+
+        // same context as the captured application
+        glfwWindowHint(GLFW_SAMPLES, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+        const std::string title {
+            "GL replay - frame " + std::to_string(header.frame_number)};
+        GLFWwindow* window {
+            glfwCreateWindow(1366, 768, title.c_str(), NULL, NULL)};
+        if (window == nullptr) {
+            logs::err("could not create glfw window");
+            return nullptr;
+        }
+        glfwMakeContextCurrent(window);
+
+        if (!gl_loader::init()) {
+            return nullptr;
+        }
+
+        glfwSwapInterval(0); // as fast as the driver allows
+
+        return window;
+    }
+
+    auto percentile(std::vector<double>& samples, double p) -> double
+    {
+        const auto n {static_cast<size_t>(p * (samples.size() - 1))};
+        std::nth_element(samples.begin(), samples.begin() + n, samples.end());
+        return samples[n];
+    }
+} // namespace
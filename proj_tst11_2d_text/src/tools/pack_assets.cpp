@@ -0,0 +1,153 @@
+/*******************************************************************************
+ * Builds an asset pack (see asset_pack_format.hpp) out of files and
+ * directories, directories are packed recursively.
+ *
+ * usage: pack_assets <output pack> <file or directory>...
+ *
+ * Files are stored under their path as given (normalised, e.g.
+ * "data/textures/mononoki.dds"), so run it from the directory the program runs
+ * in and the names match what the program asks assets::get() for.
+ ******************************************************************************/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../asset_pack_format.hpp"
+#include "../logs.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+    struct File {
+        std::string name;
+        uint64_t size;
+    };
+
+    auto add(const fs::path& path, std::vector<File>& files) -> bool
+    {
+        std::error_code ec;
+        const uint64_t size {fs::file_size(path, ec)};
+        if (ec) {
+            logs::err("can not read ", path.string(), ": ", ec.message());
+            return false;
+        }
+        files.push_back(File{path.lexically_normal().generic_string(), size});
+        return true;
+    }
+
+    auto pad(std::ofstream& out, uint64_t offset) -> void
+    {
+        const uint64_t at {static_cast<uint64_t>(out.tellp())};
+        const std::vector<char> zeros(offset - at);
+        out.write(zeros.data(), zeros.size());
+    }
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    if (argc < 3) {
+        logs::err("usage: ", argv[0], " <output pack> <file or directory>...");
+        return -1;
+    }
+    const fs::path output {argv[1]};
+
+    std::vector<File> files;
+    for (int i {2}; i < argc; ++i) {
+        const fs::path path {argv[i]};
+        if (!fs::is_directory(path)) {
+            if (!add(path, files)) {
+                return -1;
+            }
+            continue;
+        }
+        for (const auto& entry : fs::recursive_directory_iterator(path)) {
+            std::error_code ec;
+            if (entry.is_regular_file() && !fs::equivalent(entry, output, ec)
+                && !add(entry.path(), files)) {
+                return -1;
+            }
+        }
+    }
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) {
+        return a.name < b.name;
+    });
+    files.erase(
+        std::unique(files.begin(), files.end(),
+            [](const File& a, const File& b) { return a.name == b.name; }),
+        files.end());
+
+    // header, table of contents, names, contents, each part aligned
+    using asset_pack::align;
+    std::vector<asset_pack::Entry> toc(files.size());
+    uint64_t offset {align(sizeof(asset_pack::File_header))};
+    const uint64_t toc_offset {offset};
+    offset = align(offset + toc.size() * sizeof(asset_pack::Entry));
+    for (size_t i {0}; i < files.size(); ++i) {
+        toc[i].name_offset = offset;
+        toc[i].name_size = files[i].name.size();
+        offset += files[i].name.size();
+    }
+    for (size_t i {0}; i < files.size(); ++i) {
+        offset = align(offset);
+        toc[i].offset = offset;
+        toc[i].size = files[i].size;
+        offset += files[i].size;
+    }
+
+    asset_pack::File_header header {};
+    memcpy(header.magic, asset_pack::file_magic, sizeof(header.magic));
+    header.version = asset_pack::file_version;
+    header.count = static_cast<uint32_t>(files.size());
+    header.toc_offset = toc_offset;
+    header.size = offset;
+
+    // written under a temporary name, a running program may have it mapped
+    const std::string tmp_path {output.string() + ".tmp"};
+    std::ofstream out(tmp_path, std::ios::out | std::ios::binary);
+    if (!out.is_open()) {
+        logs::err("can not open ", tmp_path, " for writing");
+        return -1;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    pad(out, toc_offset);
+    out.write(
+        reinterpret_cast<const char*>(toc.data()),
+        toc.size() * sizeof(asset_pack::Entry));
+    for (size_t i {0}; i < files.size(); ++i) {
+        pad(out, toc[i].name_offset);
+        out.write(files[i].name.data(), files[i].name.size());
+    }
+    for (size_t i {0}; i < files.size(); ++i) {
+        pad(out, toc[i].offset);
+        std::ifstream in(files[i].name, std::ios::in | std::ios::binary);
+        if (in.is_open() && files[i].size > 0) {
+            out << in.rdbuf();
+        }
+        const uint64_t end {static_cast<uint64_t>(out.tellp())};
+        if (!in.is_open() || end != toc[i].offset + toc[i].size) {
+            logs::err("could not pack ", files[i].name);
+            return -1;
+        }
+    }
+    out.close();
+    if (!out) {
+        logs::err("could not write ", tmp_path);
+        return -1;
+    }
+
+    std::error_code ec;
+    fs::rename(tmp_path, output, ec);
+    if (ec) {
+        logs::err("could not move ", tmp_path, ": ", ec.message());
+        return -1;
+    }
+    logs::info(
+        "packed ", files.size(), " files into ", output.string(), " (",
+        header.size / 1024, "KiB)");
+    return 0;
+}
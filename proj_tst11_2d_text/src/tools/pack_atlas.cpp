@@ -0,0 +1,249 @@
+/*******************************************************************************
+ * Offline atlas packer: PNGs in, atlas pages and their index out.
+ *
+ * usage: pack_atlas [--page-size=<pixels>] [--gutter=<pixels>] [--srgb]
+ *                   <output> <input.png>...
+ *
+ * The images are packed (see Atlas.hpp) tallest first, which packs tightest,
+ * into as many pages as they need, each written as <output>_<n>.dds with the
+ * mipmaps its gutters allow (box filtered in linear light). The pages are
+ * uncompressed RGBA8: a block compressed page would mix neighbours in every
+ * 4x4 block a gutter does not align, and cook_textures can still compress
+ * them when that is acceptable. Like the textures Texture_manager makes at
+ * runtime they are plain UNORM, the renderer draws without an sRGB
+ * framebuffer; --srgb marks them sRGB, for colour images and a renderer that
+ * enables GL_FRAMEBUFFER_SRGB. <output>.atlas is the index,
+ * Atlas::load_index() reads it back and names every image by its file name
+ * without the extension; the page files in it are the paths written, so run
+ * the packer from where the program runs.
+ ******************************************************************************/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../Atlas.hpp"
+#include "../dds_format.hpp"
+#include "../logs.hpp"
+#include "../mipmaps.hpp"
+#include "../png.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+    struct Options {
+        unsigned page_size;
+        unsigned gutter;
+        bool srgb;
+        std::string output;
+        std::vector<std::string> inputs;
+    };
+
+    struct Input {
+        std::string name;
+        png::Image image;
+    };
+
+    auto parse_number(const std::string& arg, size_t skip, unsigned& value)
+        -> bool
+    {
+        const char* text {arg.c_str() + skip};
+        char* end;
+        const unsigned long number {std::strtoul(text, &end, 10)};
+        if (end == text || *end != '\0' || number > 1u << 16) {
+            logs::err("not a number of pixels: ", arg);
+            return false;
+        }
+        value = static_cast<unsigned>(number);
+        return true;
+    }
+
+    auto parse_options(int argc, char** argv, Options& options) -> bool
+    {
+        options = Options{
+            Atlas::default_page_size, Atlas::default_gutter, false, "", {}};
+        std::vector<std::string> files;
+        for (int i {1}; i < argc; ++i) {
+            const std::string arg {argv[i]};
+            if (arg.compare(0, 12, "--page-size=") == 0) {
+                if (!parse_number(arg, 12, options.page_size)
+                    || options.page_size == 0) {
+                    return false;
+                }
+            } else if (arg.compare(0, 9, "--gutter=") == 0) {
+                if (!parse_number(arg, 9, options.gutter)) {
+                    return false;
+                }
+            } else if (arg == "--srgb") {
+                options.srgb = true;
+            } else if (arg.compare(0, 2, "--") == 0) {
+                logs::err("unknown option ", arg);
+                return false;
+            } else {
+                files.push_back(arg);
+            }
+        }
+        if (files.size() < 2) {
+            return false;
+        }
+        options.output = files[0];
+        options.inputs.assign(files.begin() + 1, files.end());
+        return true;
+    }
+
+    auto read_file(const std::string& path, std::string& contents) -> bool
+    {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        contents.assign(
+            std::istreambuf_iterator<char>(file),
+            std::istreambuf_iterator<char>());
+        return !file.bad();
+    }
+
+    // written under a temporary name, the running program may be reading it
+    auto write_file(const std::string& path, const std::string& contents)
+        -> bool
+    {
+        const std::string tmp_path {path + ".tmp"};
+        std::ofstream out(tmp_path, std::ios::out | std::ios::binary);
+        if (!out.is_open()) {
+            logs::err("can not open ", tmp_path, " for writing");
+            return false;
+        }
+        out.write(
+            contents.data(), static_cast<std::streamsize>(contents.size()));
+        out.close();
+        if (!out) {
+            logs::err("could not write ", tmp_path);
+            return false;
+        }
+
+        std::error_code ec;
+        fs::rename(tmp_path, path, ec);
+        if (ec) {
+            logs::err("could not move ", tmp_path, ": ", ec.message());
+            return false;
+        }
+        return true;
+    }
+
+    auto put32(std::string& file, size_t at, uint32_t value) -> void
+    {
+        std::memcpy(file.data() + at, &value, sizeof(value));
+    }
+
+    // a page and its mipmaps as an uncompressed DDS
+    auto dds_file(
+        const std::vector<unsigned char>& rgba,
+        const std::vector<mipmaps::Level>& levels, bool srgb) -> std::string
+    {
+        using namespace dds;
+
+        std::string file(magic_size + header_size + dx10_header_size, '\0');
+        std::memcpy(file.data(), file_magic, magic_size);
+
+        const bool mipmapped {levels.size() > 1};
+        put32(file, at_header_size, header_size);
+        put32(file, at_flags,
+            flags_caps | flags_height | flags_width | flags_pixel_format
+                | flags_pitch | (mipmapped ? flags_mipmap_count : 0));
+        put32(file, at_height, levels[0].height);
+        put32(file, at_width, levels[0].width);
+        put32(file, at_pitch, levels[0].width * 4);
+        put32(file, at_mipmap_count, static_cast<uint32_t>(levels.size()));
+        put32(file, at_pf_size, pf_size);
+        put32(file, at_pf_flags, pf_fourcc);
+        put32(file, at_pf_fourcc, fourcc("DX10"));
+        put32(file, at_caps,
+            caps_texture | (mipmapped ? caps_complex | caps_mipmap : 0));
+        put32(file, at_dxgi_format, srgb ? dxgi_rgba8_srgb : dxgi_rgba8);
+        put32(file, at_dimension, dimension_texture2d);
+        put32(file, at_array_size, 1);
+
+        file.append(rgba.begin(), rgba.end());
+        return file;
+    }
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        logs::err(
+            "usage: ", argv[0], " [--page-size=<pixels>] [--gutter=<pixels>]",
+            " [--srgb] <output> <input.png>...");
+        return -1;
+    }
+
+    std::vector<Input> inputs;
+    std::set<std::string> names;
+    for (const std::string& path : options.inputs) {
+        Input input {fs::path(path).stem().string(), {}};
+        if (!names.insert(input.name).second) {
+            logs::err("two images are named ", input.name);
+            return -1;
+        }
+        std::string file;
+        if (!read_file(path, file)) {
+            logs::err("can not read ", path);
+            return -1;
+        }
+        if (!png::decode(path, file, input.image)) {
+            return -1;
+        }
+        inputs.push_back(std::move(input));
+    }
+    std::stable_sort(
+        inputs.begin(), inputs.end(), [](const Input& a, const Input& b) {
+            return a.image.height > b.image.height;
+        });
+
+    Atlas atlas {options.page_size, options.gutter};
+    size_t pixels {0};
+    for (const Input& input : inputs) {
+        Atlas::Handle handle;
+        if (!atlas.add(
+                input.name, input.image.rgba.data(), input.image.width,
+                input.image.height, handle)) {
+            return -1;
+        }
+        pixels += size_t{input.image.width} * input.image.height;
+    }
+
+    std::vector<std::string> page_files;
+    for (size_t i {0}; i < atlas.pages().size(); ++i) {
+        std::vector<unsigned char> rgba {atlas.pages()[i].rgba};
+        const std::vector<mipmaps::Level> levels {mipmaps::generate(
+            rgba, atlas.page_size(), atlas.page_size(),
+            atlas.mipmap_options())};
+        page_files.push_back(
+            options.output + "_" + std::to_string(i) + ".dds");
+        if (!write_file(
+                page_files.back(), dds_file(rgba, levels, options.srgb))) {
+            return -1;
+        }
+    }
+    if (!write_file(options.output + ".atlas", atlas.index(page_files))) {
+        return -1;
+    }
+
+    const double area {
+        static_cast<double>(atlas.page_size()) * atlas.page_size()
+        * static_cast<double>(page_files.size())};
+    logs::info(
+        "packed ", inputs.size(), " images into ", page_files.size(), " ",
+        atlas.page_size(), "x", atlas.page_size(), " pages, ",
+        static_cast<int>(100.0 * static_cast<double>(pixels) / area),
+        "% of them used");
+    return 0;
+}
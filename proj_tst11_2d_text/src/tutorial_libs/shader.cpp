@@ -2,47 +2,42 @@
 #include <string>
 #include <vector>
 #include <iostream>
-#include <fstream>
 #include <algorithm>
-#include <sstream>
+#include <string_view>
 using namespace std;
 
 #include <stdlib.h>
 #include <string.h>
 
-#include <GL/glew.h>
+#include "../gl_loader.hpp"
 
 #include "shader.hpp"
+#include "../assets.hpp"
+#include "../program_cache.hpp"
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+#include "../gl_intercept.hpp"
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
 
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if(VertexShaderStream.is_open()){
-		std::stringstream sstr;
-		sstr << VertexShaderStream.rdbuf();
-		VertexShaderCode = sstr.str();
-		VertexShaderStream.close();
-	}else{
+	// Get the shader sources, embedded in the executable or from disk (see assets.hpp)
+	std::string_view VertexShaderCode;
+	if(!assets::get(vertex_file_path, VertexShaderCode)){
 		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
 		getchar();
 		return 0;
 	}
+	std::string_view FragmentShaderCode;
+	assets::get(fragment_file_path, FragmentShaderCode);
 
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::stringstream sstr;
-		sstr << FragmentShaderStream.rdbuf();
-		FragmentShaderCode = sstr.str();
-		FragmentShaderStream.close();
-	}
+	// Reuse the linked program from a previous run if the driver takes it
+	const uint64_t CacheKey = program_cache::key({VertexShaderCode, FragmentShaderCode});
+	GLuint CachedProgramID = program_cache::load(CacheKey);
+	if (CachedProgramID != 0)
+		return CachedProgramID;
+
+	// Create the shaders
+	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
 
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
@@ -50,8 +45,9 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 
 	// Compile Vertex Shader
 	printf("Compiling shader : %s\n", vertex_file_path);
-	char const * VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
+	char const * VertexSourcePointer = VertexShaderCode.data();
+	GLint VertexSourceLength = VertexShaderCode.size();
+	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , &VertexSourceLength);
 	glCompileShader(VertexShaderID);
 
 	// Check Vertex Shader
@@ -67,8 +63,9 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 
 	// Compile Fragment Shader
 	printf("Compiling shader : %s\n", fragment_file_path);
-	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
+	char const * FragmentSourcePointer = FragmentShaderCode.data();
+	GLint FragmentSourceLength = FragmentShaderCode.size();
+	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , &FragmentSourceLength);
 	glCompileShader(FragmentShaderID);
 
 	// Check Fragment Shader
@@ -85,6 +82,7 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 	// Link the program
 	printf("Linking program\n");
 	GLuint ProgramID = glCreateProgram();
+	program_cache::prepare(ProgramID);
 	glAttachShader(ProgramID, VertexShaderID);
 	glAttachShader(ProgramID, FragmentShaderID);
 	glLinkProgram(ProgramID);
@@ -105,6 +103,7 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 	glDeleteShader(VertexShaderID);
 	glDeleteShader(FragmentShaderID);
 
+	program_cache::store(CacheKey, ProgramID);
 	return ProgramID;
 }
 
@@ -1,7 +1,7 @@
 #include <vector>
 #include <cstring>
 
-#include <GL/glew.h>
+#include "../gl_loader.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -11,83 +11,168 @@ using namespace glm;
 #include "texture.hpp"
 
 #include "text2D.hpp"
+#include "../Uniform.hpp"
+
+#include "../gl_intercept.hpp"
 
 unsigned int Text2DTextureID;
+bool Text2DOwnsTexture;
 unsigned int Text2DVertexBufferID;
 unsigned int Text2DUVBufferID;
+unsigned int Text2DLayerBufferID;
 unsigned int Text2DShaderID;
-unsigned int Text2DUniformID;
+unsigned int Text2DArrayShaderID; // the caller's, 0 until it is built
+Uniform<GLint> Text2DSampler;
+Uniform<GLint> Text2DArraySampler;
+glm::vec4 Text2DRegion(0.0f, 0.0f, 1.0f, 1.0f);
+
+// Quads queued since the last flushText2D(), and which texture each run of them uses
+struct Text2DBatch {
+	GLenum target; // GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+	GLuint textureID;
+	GLsizei first;
+	GLsizei count;
+};
+std::vector<glm::vec2> Text2DVertices;
+std::vector<glm::vec2> Text2DUVs;
+std::vector<float> Text2DLayers; // per vertex, 0 for 2D textures
+bool Text2DLayered; // whether any batch uses a texture array, the layers are only uploaded then
+std::vector<Text2DBatch> Text2DBatches;
 
 void initText2D(const char * texturePath){
 
 	// Initialize texture
-	Text2DTextureID = loadDDS(texturePath);
+	initText2D(loadDDS(texturePath));
+	Text2DOwnsTexture = true;
+}
+
+void initText2D(GLuint textureID){
+
+	Text2DTextureID = textureID;
+	Text2DOwnsTexture = false;
 
 	// Initialize VBO
 	glGenBuffers(1, &Text2DVertexBufferID);
 	glGenBuffers(1, &Text2DUVBufferID);
+	glGenBuffers(1, &Text2DLayerBufferID);
 
 	// Initialize Shader
 	Text2DShaderID = LoadShaders( "data/shaders/TextVertexShader.vertexshader",
                                  "data/shaders/TextVertexShader.fragmentshader"
 );
 
-	// Initialize uniforms' IDs
-	Text2DUniformID = glGetUniformLocation( Text2DShaderID, "myTextureSampler" );
+	// Initialize uniforms (looked up once, unchanged values are not re-sent)
+	Text2DSampler = Uniform<GLint>(gl_reflect::reflect(Text2DShaderID), "myTextureSampler");
 
 }
 
-void printText2D(const char * text, int x, int y, int size_x, int size_y){
+void setText2DTexture(GLuint textureID){
 
-	unsigned int length = strlen(text);
+	Text2DTextureID = textureID;
+}
 
-	// Fill buffers
-	std::vector<glm::vec2> vertices;
-	std::vector<glm::vec2> UVs;
-	for ( unsigned int i=0 ; i<length ; i++ ){
+void setText2DArrayShader(GLuint programID){
+
+	if (programID != Text2DArrayShaderID && programID != 0)
+		Text2DArraySampler = Uniform<GLint>(gl_reflect::reflect(programID), "myTextureSampler");
+	Text2DArrayShaderID = programID;
+}
+
+void setText2DRegion(float u0, float v0, float u1, float v1){
+
+	Text2DRegion = glm::vec4(u0, v0, u1, v1);
+}
+
+// Queue one quad, extending the last batch when it uses the same texture
+static void queueQuad2D(GLenum target, GLuint textureID, GLint layer, glm::vec4 uv, int x, int y, int size_x, int size_y){
+
+	glm::vec2 vertex_up_left    = glm::vec2(x         , y+size_y);
+	glm::vec2 vertex_up_right   = glm::vec2(x + size_x, y+size_y);
+	glm::vec2 vertex_down_right = glm::vec2(x + size_x, y       );
+	glm::vec2 vertex_down_left  = glm::vec2(x         , y       );
+
+	Text2DVertices.push_back(vertex_up_left   );
+	Text2DVertices.push_back(vertex_down_left );
+	Text2DVertices.push_back(vertex_up_right  );
+
+	Text2DVertices.push_back(vertex_down_right);
+	Text2DVertices.push_back(vertex_up_right);
+	Text2DVertices.push_back(vertex_down_left);
+
+	glm::vec2 uv_up_left    = glm::vec2( uv.x, uv.y );
+	glm::vec2 uv_up_right   = glm::vec2( uv.z, uv.y );
+	glm::vec2 uv_down_right = glm::vec2( uv.z, uv.w );
+	glm::vec2 uv_down_left  = glm::vec2( uv.x, uv.w );
+	Text2DUVs.push_back(uv_up_left   );
+	Text2DUVs.push_back(uv_down_left );
+	Text2DUVs.push_back(uv_up_right  );
 
-		glm::vec2 vertex_up_left    = glm::vec2(x + i*size_x        , y+size_y);
-		glm::vec2 vertex_up_right   = glm::vec2(x + i*size_x +size_x, y+size_y);
-		glm::vec2 vertex_down_right = glm::vec2(x + i*size_x +size_x, y       );
-		glm::vec2 vertex_down_left  = glm::vec2(x + i*size_x        , y       );
+	Text2DUVs.push_back(uv_down_right);
+	Text2DUVs.push_back(uv_up_right);
+	Text2DUVs.push_back(uv_down_left);
 
-		vertices.push_back(vertex_up_left   );
-		vertices.push_back(vertex_down_left );
-		vertices.push_back(vertex_up_right  );
+	Text2DLayers.insert(Text2DLayers.end(), 6, (float)layer);
+	Text2DLayered = Text2DLayered || target == GL_TEXTURE_2D_ARRAY;
 
-		vertices.push_back(vertex_down_right);
-		vertices.push_back(vertex_up_right);
-		vertices.push_back(vertex_down_left);
+	if (Text2DBatches.empty() || Text2DBatches.back().target != target || Text2DBatches.back().textureID != textureID)
+		Text2DBatches.push_back(Text2DBatch{target, textureID, (GLsizei)Text2DVertices.size() - 6, 0});
+	Text2DBatches.back().count += 6;
+}
+
+// Queue the glyphs of `text` from the grid in Text2DRegion of a texture or array layer
+static void queueText2D(GLenum target, GLuint textureID, GLint layer, const char * text, int x, int y, int size_x, int size_y){
+
+	unsigned int length = strlen(text);
+
+	// The glyph cells, within the region of the texture that holds the grid
+	float cell_u = (Text2DRegion.z - Text2DRegion.x)/16.0f;
+	float cell_v = (Text2DRegion.w - Text2DRegion.y)/16.0f;
+	for ( unsigned int i=0 ; i<length ; i++ ){
 
 		char character = text[i];
-		float uv_x = (character%16)/16.0f;
-		float uv_y = (character/16)/16.0f;
-
-		glm::vec2 uv_up_left    = glm::vec2( uv_x           , uv_y );
-		glm::vec2 uv_up_right   = glm::vec2( uv_x+1.0f/16.0f, uv_y );
-		glm::vec2 uv_down_right = glm::vec2( uv_x+1.0f/16.0f, (uv_y + 1.0f/16.0f) );
-		glm::vec2 uv_down_left  = glm::vec2( uv_x           , (uv_y + 1.0f/16.0f) );
-		UVs.push_back(uv_up_left   );
-		UVs.push_back(uv_down_left );
-		UVs.push_back(uv_up_right  );
-
-		UVs.push_back(uv_down_right);
-		UVs.push_back(uv_up_right);
-		UVs.push_back(uv_down_left);
+		float uv_x = Text2DRegion.x + (character%16)*cell_u;
+		float uv_y = Text2DRegion.y + (character/16)*cell_v;
+
+		queueQuad2D(target, textureID, layer, glm::vec4(uv_x, uv_y, uv_x + cell_u, uv_y + cell_v), x + i*size_x, y, size_x, size_y);
 	}
+}
+
+void printText2D(const char * text, int x, int y, int size_x, int size_y){
+
+	queueText2D(GL_TEXTURE_2D, Text2DTextureID, 0, text, x, y, size_x, size_y);
+}
+
+void printLayerText2D(GLuint arrayID, GLint layer, const char * text, int x, int y, int size_x, int size_y){
+
+	queueText2D(GL_TEXTURE_2D_ARRAY, arrayID, layer, text, x, y, size_x, size_y);
+}
+
+void drawSprite2D(GLuint textureID, float u0, float v0, float u1, float v1, int x, int y, int size_x, int size_y){
+
+	queueQuad2D(GL_TEXTURE_2D, textureID, 0, glm::vec4(u0, v0, u1, v1), x, y, size_x, size_y);
+}
+
+void drawLayer2D(GLuint arrayID, GLint layer, float u0, float v0, float u1, float v1, int x, int y, int size_x, int size_y){
+
+	queueQuad2D(GL_TEXTURE_2D_ARRAY, arrayID, layer, glm::vec4(u0, v0, u1, v1), x, y, size_x, size_y);
+}
+
+int flushText2D(){
+
+	if (Text2DVertices.empty())
+		return 0;
+
+	// Fill buffers, once for everything queued
 	glBindBuffer(GL_ARRAY_BUFFER, Text2DVertexBufferID);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec2), &vertices[0], GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, Text2DVertices.size() * sizeof(glm::vec2), &Text2DVertices[0], GL_STREAM_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, Text2DUVBufferID);
-	glBufferData(GL_ARRAY_BUFFER, UVs.size() * sizeof(glm::vec2), &UVs[0], GL_STATIC_DRAW);
-
-	// Bind shader
-	glUseProgram(Text2DShaderID);
+	glBufferData(GL_ARRAY_BUFFER, Text2DUVs.size() * sizeof(glm::vec2), &Text2DUVs[0], GL_STREAM_DRAW);
+	if (Text2DLayered){
+		glBindBuffer(GL_ARRAY_BUFFER, Text2DLayerBufferID);
+		glBufferData(GL_ARRAY_BUFFER, Text2DLayers.size() * sizeof(float), &Text2DLayers[0], GL_STREAM_DRAW);
+	}
 
-	// Bind texture
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, Text2DTextureID);
-	// Set our "myTextureSampler" sampler to use Texture Unit 0
-	glUniform1i(Text2DUniformID, 0);
 
 	// 1rst attribute buffer : vertices
 	glEnableVertexAttribArray(0);
@@ -99,17 +184,52 @@ void printText2D(const char * text, int x, int y, int size_x, int size_y){
 	glBindBuffer(GL_ARRAY_BUFFER, Text2DUVBufferID);
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0 );
 
+	// 3rd attribute buffer : texture array layers, only when there are any (the 2D shader has no such input)
+	if (Text2DLayered){
+		glEnableVertexAttribArray(2);
+		glBindBuffer(GL_ARRAY_BUFFER, Text2DLayerBufferID);
+		glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 0, (void*)0 );
+	}
+
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	// Draw call
-	glDrawArrays(GL_TRIANGLES, 0, vertices.size() );
+	// One draw call per texture run, all of them when everything is in one atlas page or texture array
+	int draws = 0;
+	GLenum target = GL_NONE;
+	for (const Text2DBatch & batch : Text2DBatches){
+		// Layers are skipped until the caller's array shader is built
+		if (batch.target == GL_TEXTURE_2D_ARRAY && Text2DArrayShaderID == 0)
+			continue;
+		if (batch.target != target){
+			target = batch.target;
+			// Bind shader, and set our "myTextureSampler" sampler to use Texture Unit 0
+			if (target == GL_TEXTURE_2D_ARRAY){
+				glUseProgram(Text2DArrayShaderID);
+				Text2DArraySampler.set(0);
+			} else {
+				glUseProgram(Text2DShaderID);
+				Text2DSampler.set(0);
+			}
+		}
+		glBindTexture(batch.target, batch.textureID);
+		glDrawArrays(GL_TRIANGLES, batch.first, batch.count);
+		++draws;
+	}
 
 	glDisable(GL_BLEND);
 
 	glDisableVertexAttribArray(0);
 	glDisableVertexAttribArray(1);
-
+	if (Text2DLayered)
+		glDisableVertexAttribArray(2);
+
+	Text2DVertices.clear();
+	Text2DUVs.clear();
+	Text2DLayers.clear();
+	Text2DLayered = false;
+	Text2DBatches.clear();
+	return draws;
 }
 
 void cleanupText2D(){
@@ -117,9 +237,11 @@ void cleanupText2D(){
 	// Delete buffers
 	glDeleteBuffers(1, &Text2DVertexBufferID);
 	glDeleteBuffers(1, &Text2DUVBufferID);
+	glDeleteBuffers(1, &Text2DLayerBufferID);
 
-	// Delete texture
-	glDeleteTextures(1, &Text2DTextureID);
+	// Delete texture (unless it was handed in)
+	if (Text2DOwnsTexture)
+		glDeleteTextures(1, &Text2DTextureID);
 
 	// Delete shader
 	glDeleteProgram(Text2DShaderID);
@@ -2,7 +2,18 @@
 #define TEXT2D_HPP
 
 void initText2D(const char * texturePath);
+void initText2D(GLuint textureID); // with a texture loaded elsewhere, stays the caller's
+void setText2DTexture(GLuint textureID); // e.g. once the real one is loaded
+void setText2DRegion(float u0, float v0, float u1, float v1); // the 16x16 glyph grid, e.g. in an atlas page (see Atlas.hpp)
+// queued, drawn by flushText2D() in one draw call per run of the same texture
 void printText2D(const char * text, int x, int y, int size_x, int size_y);
+void drawSprite2D(GLuint textureID, float u0, float v0, float u1, float v1, int x, int y, int size_x, int size_y);
+// the same from a layer of a GL_TEXTURE_2D_ARRAY (see Texture_arrays.hpp), all layers of one array draw together,
+// with the caller's program built from data/shaders/TextArrayShader.* (drawn once it is not 0, follow reloads)
+void setText2DArrayShader(GLuint programID);
+void printLayerText2D(GLuint arrayID, GLint layer, const char * text, int x, int y, int size_x, int size_y);
+void drawLayer2D(GLuint arrayID, GLint layer, float u0, float v0, float u1, float v1, int x, int y, int size_x, int size_y);
+int flushText2D(); // once a frame, after the text and sprites, returns the draw calls it took
 void cleanupText2D();
 
 #endif
@@ -2,12 +2,22 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include <GL/glew.h>
+#include "../gl_loader.hpp"
 
 #include <GLFW/glfw3.h>
 
+#include <string_view>
+#include <vector>
 
-GLuint loadBMP_custom(const char * imagepath){
+#include "texture.hpp"
+#include "../assets.hpp"
+#include "../dds.hpp"
+#include "../mipmaps.hpp"
+
+#include "../gl_intercept.hpp"
+
+
+bool parseBMP(const char * imagepath, BMPImage & image){
 
 	printf("Reading image %s\n", imagepath);
 
@@ -15,54 +25,55 @@ GLuint loadBMP_custom(const char * imagepath){
 	unsigned char header[54];
 	unsigned int dataPos;
 	unsigned int imageSize;
-	unsigned int width, height;
-	// Actual RGB data
-	unsigned char * data;
 
-	// Open the file
-	FILE * file = fopen(imagepath,"rb");
-	if (!file){
+	/* the file is read in one go (see assets.hpp), the pixels are used right where they are */
+	std::string_view file;
+	if (!assets::get(imagepath, file)){
 		printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath);
-		getchar();
-		return 0;
+		return false;
 	}
 
 	// Read the header, i.e. the 54 first bytes
 
 	// If less than 54 bytes are read, problem
-	if ( fread(header, 1, 54, file)!=54 ){ 
+	if ( file.size() < sizeof(header) ){ 
 		printf("Not a correct BMP file\n");
-		fclose(file);
-		return 0;
+		return false;
 	}
+	memcpy(header, file.data(), sizeof(header));
 	// A BMP files always begins with "BM"
 	if ( header[0]!='B' || header[1]!='M' ){
 		printf("Not a correct BMP file\n");
-		fclose(file);
-		return 0;
+		return false;
 	}
 	// Make sure this is a 24bpp file
-	if ( *(int*)&(header[0x1E])!=0  )         {printf("Not a correct BMP file\n");    fclose(file); return 0;}
-	if ( *(int*)&(header[0x1C])!=24 )         {printf("Not a correct BMP file\n");    fclose(file); return 0;}
+	if ( *(int*)&(header[0x1E])!=0  )         {printf("Not a correct BMP file\n");    return false;}
+	if ( *(int*)&(header[0x1C])!=24 )         {printf("Not a correct BMP file\n");    return false;}
 
 	// Read the information about the image
-	dataPos    = *(int*)&(header[0x0A]);
-	imageSize  = *(int*)&(header[0x22]);
-	width      = *(int*)&(header[0x12]);
-	height     = *(int*)&(header[0x16]);
+	dataPos      = *(int*)&(header[0x0A]);
+	imageSize    = *(int*)&(header[0x22]);
+	image.width  = *(int*)&(header[0x12]);
+	image.height = *(int*)&(header[0x16]);
+
+	// Each row is padded to 4 bytes
+	unsigned int rowSize = (image.width*3 + 3) & ~3u; // 3 : one byte for each Red, Green and Blue component
 
 	// Some BMP files are misformatted, guess missing information
-	if (imageSize==0)    imageSize=width*height*3; // 3 : one byte for each Red, Green and Blue component
+	if (imageSize==0)    imageSize=rowSize*image.height;
 	if (dataPos==0)      dataPos=54; // The BMP header is done that way
 
-	// Create a buffer
-	data = new unsigned char [imageSize];
+	if (dataPos > file.size() || imageSize > file.size() - dataPos || imageSize < rowSize*image.height){
+		printf("%s is truncated\n", imagepath);
+		return false;
+	}
+	image.data = (const unsigned char*)file.data() + dataPos;
+	image.size = imageSize;
 
-	// Read the actual data from the file into the buffer
-	fread(data,1,imageSize,file);
+	return true;
+}
 
-	// Everything is in memory now, the file can be closed.
-	fclose (file);
+GLuint uploadBMP(const BMPImage & image){
 
 	// Create one OpenGL texture
 	GLuint textureID;
@@ -71,11 +82,13 @@ GLuint loadBMP_custom(const char * imagepath){
 	// "Bind" the newly created texture : all future texture functions will modify this texture
 	glBindTexture(GL_TEXTURE_2D, textureID);
 
-	// Give the image to OpenGL
-	glTexImage2D(GL_TEXTURE_2D, 0,GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
-
-	// OpenGL has now copied the data. Free our own version
-	delete [] data;
+	// Give the image to OpenGL, with mipmaps made here rather than by the
+	// driver, so they are the same everywhere (see mipmaps.hpp)
+	std::vector<unsigned char> pixels(image.width * image.height * 4);
+	rgbaBMP(image, pixels.data());
+	std::vector<mipmaps::Level> levels = mipmaps::generate(pixels, image.width, image.height, mipmaps::defaults);
+	for (size_t i = 0; i < levels.size(); i++)
+		glTexImage2D(GL_TEXTURE_2D, i, GL_RGB, levels[i].width, levels[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data() + levels[i].offset);
 
 	// Poor filtering, or ...
 	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -86,13 +99,34 @@ GLuint loadBMP_custom(const char * imagepath){
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	// ... which requires mipmaps. Generate them automatically.
-	glGenerateMipmap(GL_TEXTURE_2D);
+	// ... which requires the mipmaps above.
 
 	// Return the ID of the texture we just created
 	return textureID;
 }
 
+void rgbaBMP(const BMPImage & image, unsigned char * rgba){
+
+	unsigned int rowSize = (image.width*3 + 3) & ~3u;
+	for (unsigned int y = 0; y < image.height; y++){
+		const unsigned char * bgr = image.data + y*rowSize;
+		for (unsigned int x = 0; x < image.width; x++, bgr += 3, rgba += 4){
+			rgba[0] = bgr[2];
+			rgba[1] = bgr[1];
+			rgba[2] = bgr[0];
+			rgba[3] = 255;
+		}
+	}
+}
+
+GLuint loadBMP_custom(const char * imagepath){
+
+	BMPImage image;
+	if (!parseBMP(imagepath, image))
+		return 0;
+	return uploadBMP(image);
+}
+
 // Since GLFW 3, glfwLoadTexture2D() has been removed. You have to use another texture loading library, 
 // or do it yourself (just like loadBMP_custom and loadDDS)
 //GLuint loadTGA_glfw(const char * imagepath){
@@ -120,67 +154,69 @@ GLuint loadBMP_custom(const char * imagepath){
 
 
 
-#define FOURCC_DXT1 0x31545844 // Equivalent to "DXT1" in ASCII
-#define FOURCC_DXT3 0x33545844 // Equivalent to "DXT3" in ASCII
-#define FOURCC_DXT5 0x35545844 // Equivalent to "DXT5" in ASCII
-
-GLuint loadDDS(const char * imagepath){
-
-	unsigned char header[124];
+bool parseDDS(const char * imagepath, DDSImage & image){
 
-	FILE *fp; 
- 
-	/* try to open the file */ 
-	fp = fopen(imagepath, "rb"); 
-	if (fp == NULL){
-		printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath); getchar(); 
-		return 0;
+	/* the file is embedded in the executable or read from disk in one go (see assets.hpp) */
+	std::string_view file;
+	if (!assets::get(imagepath, file)){
+		printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath);
+		return false;
 	}
-   
-	/* verify the type of file */ 
-	char filecode[4]; 
-	fread(filecode, 1, 4, fp); 
-	if (strncmp(filecode, "DDS ", 4) != 0) { 
-		fclose(fp); 
-		return 0; 
+
+	/* the header is checked and every mipmap is found in the file by dds::parse */
+	dds::Image dds;
+	if (!dds::parse(imagepath, file, dds))
+		return false;
+	if (dds.target != GL_TEXTURE_2D || dds.format.block_bytes == 0) {
+		printf("%s: only compressed 2D textures here, Texture_manager loads the others\n", imagepath);
+		return false;
 	}
-	
-	/* get the surface desc */ 
-	fread(&header, 124, 1, fp); 
-
-	unsigned int height      = *(unsigned int*)&(header[8 ]);
-	unsigned int width	     = *(unsigned int*)&(header[12]);
-	unsigned int linearSize	 = *(unsigned int*)&(header[16]);
-	unsigned int mipMapCount = *(unsigned int*)&(header[24]);
-	unsigned int fourCC      = *(unsigned int*)&(header[80]);
-
- 
-	unsigned char * buffer;
-	unsigned int bufsize;
-	/* how big is it going to be including all mipmaps? */ 
-	bufsize = mipMapCount > 1 ? linearSize * 2 : linearSize; 
-	buffer = (unsigned char*)malloc(bufsize * sizeof(unsigned char)); 
-	fread(buffer, 1, bufsize, fp); 
-	/* close the file pointer */ 
-	fclose(fp);
-
-	unsigned int components  = (fourCC == FOURCC_DXT1) ? 3 : 4; 
-	unsigned int format;
-	switch(fourCC) 
+
+	image.format      = dds.format.internal_format;
+	image.blockSize   = dds.format.block_bytes;
+	image.width       = dds.width;
+	image.height      = dds.height;
+	image.mipMapCount = dds.levels;
+
+	/* the mipmaps are used right where they are, no copy */
+	image.data = dds.surfaces.front().data;
+	image.size = 0;
+	for (const dds::Surface & surface : dds.surfaces)
+		image.size += surface.size;
+
+	return true;
+}
+
+bool levelDDS(const DDSImage & image, unsigned int level, DDSLevel & out){
+
+	unsigned int blockSize = image.blockSize;
+	unsigned int width = image.width;
+	unsigned int height = image.height;
+	size_t offset = 0;
+
+	if (level >= image.mipMapCount)
+		return false;
+
+	/* skip the bigger mipmaps */ 
+	for (unsigned int i = 0; i < level; ++i) 
 	{ 
-	case FOURCC_DXT1: 
-		format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; 
-		break; 
-	case FOURCC_DXT3: 
-		format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; 
-		break; 
-	case FOURCC_DXT5: 
-		format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; 
-		break; 
-	default: 
-		free(buffer); 
-		return 0; 
-	}
+		offset += ((width+3)/4)*((height+3)/4)*blockSize; 
+		width  /= 2; 
+		height /= 2; 
+
+		// Deal with Non-Power-Of-Two textures. This code is not included in the webpage to reduce clutter.
+		if(width < 1) width = 1;
+		if(height < 1) height = 1;
+	} 
+
+	out.width = width;
+	out.height = height;
+	out.size = ((width+3)/4)*((height+3)/4)*blockSize; 
+	out.data = image.data + offset;
+	return offset + out.size <= image.size;
+}
+
+GLuint uploadDDS(const char * imagepath, const DDSImage & image){
 
 	// Create one OpenGL texture
 	GLuint textureID;
@@ -190,29 +226,25 @@ GLuint loadDDS(const char * imagepath){
 	glBindTexture(GL_TEXTURE_2D, textureID);
 	glPixelStorei(GL_UNPACK_ALIGNMENT,1);	
 	
-	unsigned int blockSize = (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16; 
-	unsigned int offset = 0;
-
 	/* load the mipmaps */ 
-	for (unsigned int level = 0; level < mipMapCount && (width || height); ++level) 
+	for (unsigned int level = 0; level < image.mipMapCount; ++level) 
 	{ 
-		unsigned int size = ((width+3)/4)*((height+3)/4)*blockSize; 
-		glCompressedTexImage2D(GL_TEXTURE_2D, level, format, width, height,  
-			0, size, buffer + offset); 
-	 
-		offset += size; 
-		width  /= 2; 
-		height /= 2; 
-
-		// Deal with Non-Power-Of-Two textures. This code is not included in the webpage to reduce clutter.
-		if(width < 1) width = 1;
-		if(height < 1) height = 1;
-
+		DDSLevel mip;
+		if (!levelDDS(image, level, mip)) {
+			printf("%s is truncated\n", imagepath);
+			break;
+		}
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, image.format, mip.width, mip.height,  
+			0, mip.size, mip.data); 
 	} 
 
-	free(buffer); 
-
 	return textureID;
+}
 
+GLuint loadDDS(const char * imagepath){
 
+	DDSImage image;
+	if (!parseDDS(imagepath, image))
+		return 0;
+	return uploadDDS(imagepath, image);
 }
\ No newline at end of file
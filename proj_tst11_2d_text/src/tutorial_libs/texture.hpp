@@ -1,9 +1,27 @@
 #ifndef TEXTURE_HPP
 #define TEXTURE_HPP
 
+#include <stddef.h>
+
 // Load a .BMP file using our custom loader
 GLuint loadBMP_custom(const char * imagepath);
 
+// A parsed .BMP file (24 bits, bottom-up BGR rows), the pixels point into the file's data
+struct BMPImage {
+	unsigned int width;
+	unsigned int height;
+	const unsigned char * data;
+	size_t size;
+};
+
+// The two halves of loadBMP_custom, like the ones of loadDDS below
+bool parseBMP(const char * imagepath, BMPImage & image);
+GLuint uploadBMP(const BMPImage & image);
+
+// The pixels of a parsed .BMP file as RGBA (alpha 255), width * height * 4
+// bytes, the rows still bottom-up
+void rgbaBMP(const BMPImage & image, unsigned char * rgba);
+
 //// Since GLFW 3, glfwLoadTexture2D() has been removed. You have to use another texture loading library, 
 //// or do it yourself (just like loadBMP_custom and loadDDS)
 //// Load a .TGA file using GLFW's own loader
@@ -12,5 +30,33 @@ GLuint loadBMP_custom(const char * imagepath);
 // Load a .DDS file using GLFW's own loader
 GLuint loadDDS(const char * imagepath);
 
+// A parsed .DDS file, the mipmaps point into the file's data (see assets.hpp)
+struct DDSImage {
+	unsigned int format;
+	unsigned int blockSize;
+	unsigned int width;
+	unsigned int height;
+	unsigned int mipMapCount;
+	const unsigned char * data;
+	size_t size;
+};
+
+// The two halves of loadDDS: parsing needs no OpenGL and works on any thread,
+// the upload has to happen where the context is current. Only compressed 2D
+// textures, see dds.hpp for the rest
+bool parseDDS(const char * imagepath, DDSImage & image);
+GLuint uploadDDS(const char * imagepath, const DDSImage & image);
+
+// One mipmap of a parsed .DDS file
+struct DDSLevel {
+	unsigned int width;
+	unsigned int height;
+	const unsigned char * data;
+	unsigned int size;
+};
+
+// Where mipmap `level` is, false if the file is too short for it
+bool levelDDS(const DDSImage & image, unsigned int level, DDSLevel & out);
+
 
 #endif
\ No newline at end of file
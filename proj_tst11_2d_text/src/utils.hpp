@@ -9,7 +9,7 @@
  * things that are only one or two of a kind.
  ******************************************************************************/
 
-#include <GL/glew.h>
+#include "gl_loader.hpp"
 
 struct Pos2 {
     int x;
@@ -26,6 +26,7 @@ struct Size2 {
     int h;
 };
 
+// compile and link a program, blocking (see Shader_manager for async builds)
 auto load_shaders(
     const char* vertex_file_path,
     const char* fragment_file_path) -> GLuint;
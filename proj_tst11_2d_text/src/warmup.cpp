@@ -0,0 +1,394 @@
+#include "warmup.hpp"
+
+#include "gl_loader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "logs.hpp"
+#include "program_cache.hpp"
+// no gl_intercept.hpp: the warm-up draws are not part of any frame, they must
+// not be counted, captured or recorded as seen (the state is restored after)
+
+namespace {
+    constexpr const char* file_header {"warmup 1"};
+    constexpr GLsizei target_size {4}; // pixels per side
+    constexpr GLsizei vertices {3};
+
+    struct Entry {
+        warmup::Combination combination;
+        bool keep; // drawn or warmed up this run, saved for the next
+    };
+
+    // by their line in the file, which also keeps the file sorted
+    std::map<std::string, Entry> entries;
+    bool dirty {false};
+    bool record_draws {false};
+
+    /* one combination per line:
+     *     <key> <mode> <blend> <src> <dst> <depth> <func> <cull> <attrib>...
+     * with each attrib as index:size:type:normalized:stride */
+    auto to_line(const warmup::Combination& c) -> std::string
+    {
+        char buf[128];
+        snprintf(
+            buf, sizeof(buf), "%016" PRIx64 " 0x%x %d 0x%x 0x%x %d 0x%x %d",
+            c.program, c.mode, c.blend, c.blend_func[0], c.blend_func[1],
+            c.depth_test, c.depth_func, c.cull_face);
+        std::string line {buf};
+        for (const auto& a : c.attribs) {
+            snprintf(
+                buf, sizeof(buf), " %u:%d:0x%x:%d:%d",
+                a.index, a.size, a.type, a.normalized, a.stride);
+            line += buf;
+        }
+        return line;
+    }
+
+    auto from_line(const std::string& line, warmup::Combination& c) -> bool
+    {
+        std::istringstream in(line);
+        std::string key;
+        unsigned blend, depth_test, cull_face;
+        in >> key >> std::hex >> c.mode >> blend >> c.blend_func[0]
+            >> c.blend_func[1] >> depth_test >> c.depth_func >> cull_face;
+        if (!in || key.size() != 16) {
+            return false;
+        }
+        c.program = std::strtoull(key.c_str(), nullptr, 16);
+        c.blend = blend != 0;
+        c.depth_test = depth_test != 0;
+        c.cull_face = cull_face != 0;
+
+        c.attribs.clear();
+        for (std::string word; in >> word;) {
+            warmup::Attrib a {};
+            int normalized {0};
+            if (sscanf(
+                    word.c_str(), "%u:%d:%x:%d:%d",
+                    &a.index, &a.size, &a.type, &normalized, &a.stride) != 5) {
+                return false;
+            }
+            a.normalized = normalized != 0 ? GL_TRUE : GL_FALSE;
+            c.attribs.push_back(a);
+        }
+        return c.program != 0;
+    }
+
+    // bytes three vertices can read from a buffer bound at offset 0
+    auto scratch_size() -> GLsizeiptr
+    {
+        constexpr GLsizei max_component {8}; // a double
+        GLsizeiptr size {0};
+        for (const auto& [line, entry] : entries) {
+            for (const auto& a : entry.combination.attribs) {
+                const GLsizei element {a.size * max_component};
+                const GLsizei stride {a.stride != 0 ? a.stride : element};
+                size = std::max<GLsizeiptr>(
+                    size, (vertices - 1) * stride + element);
+            }
+        }
+        return size;
+    }
+
+    auto set_cap(GLenum cap, bool enabled) -> void
+    {
+        if (enabled) {
+            glEnable(cap);
+        } else {
+            glDisable(cap);
+        }
+    }
+
+    auto draw(const warmup::Combination& c, GLuint program) -> void
+    {
+        glUseProgram(program);
+        set_cap(GL_BLEND, c.blend);
+        glBlendFunc(c.blend_func[0], c.blend_func[1]);
+        set_cap(GL_DEPTH_TEST, c.depth_test);
+        glDepthFunc(c.depth_func);
+        set_cap(GL_CULL_FACE, c.cull_face);
+        for (const auto& a : c.attribs) {
+            glEnableVertexAttribArray(a.index);
+            glVertexAttribPointer(
+                a.index, a.size, a.type, a.normalized, a.stride, nullptr);
+        }
+
+        glDrawArrays(c.mode, 0, vertices);
+
+        for (const auto& a : c.attribs) {
+            glDisableVertexAttribArray(a.index);
+        }
+    }
+
+    // the GL state run() touches outside of its own objects
+    struct Saved_state {
+        GLint read_framebuffer;
+        GLint draw_framebuffer;
+        std::array<GLint, 4> viewport;
+        GLint program;
+        GLint vertex_array;
+        GLint array_buffer;
+        GLboolean blend;
+        GLint blend_src;
+        GLint blend_dst;
+        GLboolean depth_test;
+        GLint depth_func;
+        GLboolean cull_face;
+
+        Saved_state()
+        {
+            glGetIntegerv(
+                GL_READ_FRAMEBUFFER_BINDING, &this->read_framebuffer);
+            glGetIntegerv(
+                GL_DRAW_FRAMEBUFFER_BINDING, &this->draw_framebuffer);
+            glGetIntegerv(GL_VIEWPORT, this->viewport.data());
+            glGetIntegerv(GL_CURRENT_PROGRAM, &this->program);
+            glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &this->vertex_array);
+            glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &this->array_buffer);
+            this->blend = glIsEnabled(GL_BLEND);
+            glGetIntegerv(GL_BLEND_SRC_RGB, &this->blend_src);
+            glGetIntegerv(GL_BLEND_DST_RGB, &this->blend_dst);
+            this->depth_test = glIsEnabled(GL_DEPTH_TEST);
+            glGetIntegerv(GL_DEPTH_FUNC, &this->depth_func);
+            this->cull_face = glIsEnabled(GL_CULL_FACE);
+        }
+
+        auto restore() const -> void
+        {
+            // run() binds its target to both
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, this->read_framebuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->draw_framebuffer);
+            glViewport(
+                this->viewport[0], this->viewport[1],
+                this->viewport[2], this->viewport[3]);
+            glUseProgram(this->program);
+            glBindVertexArray(this->vertex_array);
+            glBindBuffer(GL_ARRAY_BUFFER, this->array_buffer);
+            set_cap(GL_BLEND, this->blend == GL_TRUE);
+            glBlendFunc(this->blend_src, this->blend_dst);
+            set_cap(GL_DEPTH_TEST, this->depth_test == GL_TRUE);
+            glDepthFunc(this->depth_func);
+            set_cap(GL_CULL_FACE, this->cull_face == GL_TRUE);
+        }
+    };
+} // namespace
+
+namespace warmup {
+    auto Attrib::operator==(const Attrib& other) const -> bool
+    {
+        return this->index == other.index
+            && this->size == other.size
+            && this->type == other.type
+            && this->normalized == other.normalized
+            && this->stride == other.stride;
+    }
+
+    auto Combination::operator==(const Combination& other) const -> bool
+    {
+        return this->program == other.program
+            && this->mode == other.mode
+            && this->attribs == other.attribs
+            && this->blend == other.blend
+            && this->blend_func == other.blend_func
+            && this->depth_test == other.depth_test
+            && this->depth_func == other.depth_func
+            && this->cull_face == other.cull_face;
+    }
+
+    auto load() -> unsigned
+    {
+        std::ifstream file(path, std::ios::in);
+        if (!file.is_open()) {
+            DBG(1, "no warm-up list at ", path);
+            return 0;
+        }
+
+        std::string line;
+        if (!std::getline(file, line) || line != file_header) {
+            logs::err("unknown warm-up list format in ", path, ", ignoring it");
+            dirty = true;
+            return 0;
+        }
+
+        while (std::getline(file, line)) {
+            Combination c;
+            if (!from_line(line, c)) {
+                logs::err("bad line in ", path, ": ", line);
+                dirty = true;
+                continue;
+            }
+            entries.emplace(line, Entry{c, false});
+        }
+        DBG(1, "warm-up list: ", entries.size(), " combinations");
+        return static_cast<unsigned>(entries.size());
+    }
+
+    auto run() -> unsigned
+    {
+        if (entries.empty()) {
+            return 0;
+        }
+        const auto start {std::chrono::steady_clock::now()};
+        const Saved_state saved;
+
+        // same sample count as the window, drivers specialise on that too
+        GLint samples {0};
+        glGetIntegerv(GL_SAMPLES, &samples);
+
+        GLuint target {0};
+        std::array<GLuint, 2> renderbuffers {}; // colour, depth
+        glGenFramebuffers(1, &target);
+        glGenRenderbuffers(2, renderbuffers.data());
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorageMultisample(
+            GL_RENDERBUFFER, samples, GL_RGBA8, target_size, target_size);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorageMultisample(
+            GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24,
+            target_size, target_size);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        glFramebufferRenderbuffer(
+            GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+            renderbuffers[0]);
+        glFramebufferRenderbuffer(
+            GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+            renderbuffers[1]);
+
+        unsigned drawn {0};
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            logs::err("warm-up target is incomplete, skipping the warm-up");
+        } else {
+            glViewport(0, 0, target_size, target_size);
+
+            // attributes read zeros, only the layout matters
+            GLuint vertex_array {0};
+            GLuint buffer {0};
+            glGenVertexArrays(1, &vertex_array);
+            glBindVertexArray(vertex_array);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            const std::vector<char> zeros(scratch_size());
+            glBufferData(
+                GL_ARRAY_BUFFER, zeros.size(), zeros.data(), GL_STATIC_DRAW);
+
+            for (auto& [line, entry] : entries) {
+                const GLuint program {
+                    program_cache::program_of(entry.combination.program)};
+                if (program == 0) {
+                    continue; // not built this run
+                }
+                draw(entry.combination, program);
+                entry.keep = true;
+                ++drawn;
+            }
+
+            // the driver does its work now rather than on the first frame
+            glFinish();
+
+            glDeleteBuffers(1, &buffer);
+            glDeleteVertexArrays(1, &vertex_array);
+        }
+
+        saved.restore();
+        glDeleteFramebuffers(1, &target);
+        glDeleteRenderbuffers(2, renderbuffers.data());
+
+        if (drawn != entries.size()) {
+            dirty = true; // the others are dropped
+        }
+
+        const double ms {std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count()};
+        logs::info(
+            "warmed up ", drawn, " of ", entries.size(),
+            " draw combinations in ", ms, "ms");
+        bench::set("warmup", "combinations", drawn);
+        bench::set("warmup", "ms", ms);
+        return drawn;
+    }
+
+    auto record(bool on) -> void
+    {
+        record_draws = on;
+    }
+
+    auto recording() -> bool
+    {
+        return record_draws;
+    }
+
+    auto seen(const Combination& combination) -> void
+    {
+        if (combination.program == 0) {
+            return; // not a program the cache knows, no key to save it under
+        }
+        auto [it, added] {entries.emplace(
+            to_line(combination), Entry{combination, true})};
+        if (added || !it->second.keep) {
+            it->second.keep = true;
+            dirty = true;
+            DBG(2, "new draw combination: ", it->first);
+        }
+    }
+
+    auto save() -> bool
+    {
+        if (!dirty) {
+            return true;
+        }
+
+        const std::filesystem::path file_path {path};
+        std::error_code ec;
+        std::filesystem::create_directories(file_path.parent_path(), ec);
+        if (ec) {
+            logs::err(
+                "can not create ", file_path.parent_path().string(), ": ",
+                ec.message());
+            return false;
+        }
+
+        // written under a temporary name and renamed, like the program cache
+        const std::string tmp_path {file_path.string() + ".tmp"};
+        std::ofstream file(tmp_path, std::ios::out);
+        if (!file.is_open()) {
+            logs::err("can not open ", tmp_path, " for writing");
+            return false;
+        }
+        file << file_header << '\n';
+        unsigned count {0};
+        for (const auto& [line, entry] : entries) {
+            if (entry.keep) {
+                file << line << '\n';
+                ++count;
+            }
+        }
+        file.close();
+        if (!file) {
+            logs::err("could not write ", tmp_path);
+            std::filesystem::remove(tmp_path, ec);
+            return false;
+        }
+
+        std::filesystem::rename(tmp_path, file_path, ec);
+        if (ec) {
+            logs::err("could not move ", tmp_path, ": ", ec.message());
+            return false;
+        }
+
+        DBG(1, "warm-up list saved: ", count, " combinations");
+        dirty = false;
+        return true;
+    }
+} // namespace warmup
@@ -0,0 +1,79 @@
+#ifndef SRC_WARMUP_HPP_
+#define SRC_WARMUP_HPP_
+
+/*******************************************************************************
+ * Warm-up pass for draw state combinations, run while loading.
+ *
+ * Drivers tend to finish compiling a program, or build a variant of it for the
+ * vertex layout and blend/depth state it is used with, only when it is first
+ * drawn with that state, so the first frame that draws something new takes a
+ * spike. run() draws every combination earlier runs used once, three vertices
+ * into a tiny offscreen target, and waits for the GPU to be done with them
+ * before the first real frame.
+ *
+ * The combinations are recorded by the interception layer (gl_intercept.hpp)
+ * as it sees draws, in debug and capture builds and only while record() is on
+ * (`--record-warmup`), the lookups are not free; release builds only replay
+ * the list. Programs are identified by their program
+ * cache key (see program_cache.hpp), which stays the same across runs as long
+ * as the sources and the driver do. save() writes what was drawn this run and
+ * what was warmed up, entries of programs that were not built are dropped.
+ *
+ *     warmup::load();
+ *     warmup::run(); // all programs linked
+ *     ... frames ...
+ *     warmup::save();
+ ******************************************************************************/
+
+#include "gl_loader.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace warmup {
+    constexpr const char* path {"cache/warmup.txt"};
+
+    struct Attrib {
+        GLuint index;
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+        GLsizei stride;
+
+        auto operator==(const Attrib& other) const -> bool;
+    };
+
+    // everything a draw is specialised on apart from data and uniforms
+    struct Combination {
+        uint64_t program {0}; // program cache key
+        GLenum mode {GL_TRIANGLES};
+        std::vector<Attrib> attribs; // the enabled ones, by index
+        bool blend {false};
+        std::array<GLenum, 2> blend_func {GL_ONE, GL_ZERO};
+        bool depth_test {false};
+        GLenum depth_func {GL_LESS};
+        bool cull_face {false};
+
+        auto operator==(const Combination& other) const -> bool;
+    };
+
+    // read the combinations of earlier runs, returns how many there are
+    auto load() -> unsigned;
+
+    // draw each loaded combination whose program was built in this run,
+    // needs all programs linked, leaves the GL state as it was
+    auto run() -> unsigned;
+
+    // whether the interception layer passes draws to seen(), off by default
+    auto record(bool on) -> void;
+    auto recording() -> bool;
+
+    // note a combination used by a real draw
+    auto seen(const Combination& combination) -> void;
+
+    // write the list for the next run if it changed
+    auto save() -> bool;
+} // namespace warmup
+
+#endif // SRC_WARMUP_HPP_